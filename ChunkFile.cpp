@@ -0,0 +1,77 @@
+#include "ChunkFile.hpp"
+
+#include <cstring>
+#include <stdexcept>
+
+ChunkFile::ChunkFile(char const *begin, char const *end, std::string const &name_) : name(name_) {
+	assert(begin <= end);
+	char const *at = begin;
+	while (at != end) {
+		if (size_t(end - at) < 8) {
+			throw std::runtime_error("Trailing data after last chunk in '" + name + "'");
+		}
+		Chunk chunk;
+		std::memcpy(chunk.magic, at, 4);
+		std::memcpy(&chunk.size, at + 4, 4);
+		if (size_t(end - at) - 8 < chunk.size) {
+			throw std::runtime_error("Chunk '" + chunk.get_magic() + "' in '" + name + "' runs past the end of the file");
+		}
+		chunk.data = at + 8;
+		at = chunk.data + chunk.size;
+		chunks.emplace_back(chunk);
+	}
+}
+
+ChunkFile::Chunk const *ChunkFile::find(std::string const &magic) const {
+	assert(magic.size() == 4);
+	for (auto const &chunk : chunks) {
+		if (std::memcmp(chunk.magic, magic.data(), 4) == 0) return &chunk;
+	}
+	return nullptr;
+}
+
+ChunkFile::Chunk const &ChunkFile::get(std::string const &magic) const {
+	Chunk const *chunk = find(magic);
+	if (!chunk) {
+		throw std::runtime_error("Missing chunk '" + magic + "' in '" + name + "'");
+	}
+	return *chunk;
+}
+
+bool ChunkFile::verify() const {
+	Chunk const *crc = find("crc0");
+	if (!crc) return false;
+	std::vector< uint32_t > crcs;
+	read("crc0", &crcs);
+	size_t count = crc - &chunks[0];
+	if (crcs.size() != count) {
+		throw std::runtime_error("Chunk checksums in '" + name + "' don't match the number of chunks");
+	}
+	for (size_t i = 0; i < count; ++i) {
+		if (chunk_crc32(chunks[i].data, chunks[i].size) != crcs[i]) {
+			throw std::runtime_error("Checksum mismatch for chunk '" + chunks[i].get_magic() + "' in '" + name + "'");
+		}
+	}
+	return true;
+}
+
+uint32_t chunk_crc32(char const *data, size_t size) {
+	static struct Table {
+		uint32_t entries[256];
+		Table() {
+			for (uint32_t i = 0; i < 256; ++i) {
+				uint32_t c = i;
+				for (int k = 0; k < 8; ++k) {
+					c = (c & 1) ? (0xedb88320U ^ (c >> 1)) : (c >> 1);
+				}
+				entries[i] = c;
+			}
+		}
+	} const table;
+
+	uint32_t crc = 0xffffffffU;
+	for (size_t i = 0; i < size; ++i) {
+		crc = table.entries[(crc ^ uint8_t(data[i])) & 0xff] ^ (crc >> 8);
+	}
+	return crc ^ 0xffffffffU;
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "read_chunk.hpp"
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+//"ChunkFile" indexes the chunks in a block of memory (e.g., an Asset) with one pass over their
+// headers, so they can then be looked up by magic in any order. Chunk data isn't touched until
+// it is asked for, so chunks a reader doesn't know about cost nothing (and formats can grow new ones).
+//A "crc0" chunk, if present, holds the CRC-32 of every chunk before it, in order; see verify().
+// note: will throw if the memory doesn't split exactly into chunks.
+
+struct ChunkFile {
+	ChunkFile(char const *begin, char const *end, std::string const &name);
+
+	std::string name; //for error messages
+
+	struct Chunk {
+		char magic[4];
+		char const *data = nullptr;
+		uint32_t size = 0;
+		std::string get_magic() const { return std::string(magic, 4); }
+	};
+	std::vector< Chunk > chunks; //in file order (a handful per file, so lookups just scan this)
+
+	//first chunk with the given magic (nullptr if there is none):
+	Chunk const *find(std::string const &magic) const;
+	bool has(std::string const &magic) const { return find(magic) != nullptr; }
+	//...or throw if there is none:
+	Chunk const &get(std::string const &magic) const;
+
+	//view a chunk in place (no copy):
+	// note: throws if missing, not a whole number of T's, or not aligned for T in memory.
+	template< typename T >
+	void view(std::string const &magic, ChunkView< T > *to) const;
+
+	//copy a chunk out (for chunks that may not be aligned), refusing chunks of more than max_count elements:
+	template< typename T >
+	void read(std::string const &magic, std::vector< T > *to, size_t max_count = size_t(-1)) const;
+
+	//check every chunk against the "crc0" chunk (reads all chunk data):
+	// returns false if there is no "crc0" chunk; throws if a checksum doesn't match.
+	bool verify() const;
+};
+
+//CRC-32 (as in zlib/PNG), as stored in "crc0" chunks:
+uint32_t chunk_crc32(char const *data, size_t size);
+
+template< typename T >
+void ChunkFile::view(std::string const &magic, ChunkView< T > *to) const {
+	assert(to);
+	Chunk const &chunk = get(magic);
+	if (chunk.size % sizeof(T) != 0) {
+		throw std::runtime_error("Size of chunk '" + magic + "' in '" + name + "' not divisible by element size");
+	}
+	if (reinterpret_cast< uintptr_t >(chunk.data) % alignof(T) != 0) {
+		throw std::runtime_error("Chunk '" + magic + "' in '" + name + "' is not aligned for in-place access");
+	}
+	to->ptr = reinterpret_cast< T const * >(chunk.data);
+	to->count = chunk.size / sizeof(T);
+}
+
+template< typename T >
+void ChunkFile::read(std::string const &magic, std::vector< T > *to, size_t max_count) const {
+	assert(to);
+	Chunk const &chunk = get(magic);
+	if (chunk.size % sizeof(T) != 0) {
+		throw std::runtime_error("Size of chunk '" + magic + "' in '" + name + "' not divisible by element size");
+	}
+	if (chunk.size / sizeof(T) > max_count) {
+		throw std::runtime_error("Chunk '" + magic + "' in '" + name + "' has more than " + std::to_string(max_count) + " elements");
+	}
+	to->resize(chunk.size / sizeof(T));
+	if (chunk.size) std::memcpy(to->data(), chunk.data, chunk.size);
+}
@@ -0,0 +1,43 @@
+#include "DynamicResolution.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+bool DynamicResolution::update(PassTimers const &timers) {
+	if (budget_ms <= 0.0f) {
+		bool changed = (scale != 1.0f);
+		scale = 1.0f;
+		samples = 0;
+		return changed;
+	}
+
+	//only frames drawn at the current scale say anything about it:
+	uint32_t measured = timers.frame_gpu_measured;
+	if (measured == -1U || measured == last_measured || int32_t(measured - changed_frame) < 0) return false;
+	last_measured = measured;
+	if (samples == 0) smooth_ms = timers.frame_gpu_ms;
+	else smooth_ms += 0.25f * (timers.frame_gpu_ms - smooth_ms);
+	samples += 1;
+
+	//(most of the frame is per-pixel work, so time goes roughly with area, i.e., scale squared)
+	float target = scale;
+	if (samples >= 3 && smooth_ms > budget_ms) {
+		target = scale * std::sqrt(0.9f * budget_ms / smooth_ms);
+	} else if (samples >= 30 && smooth_ms < 0.7f * budget_ms && scale < 1.0f) {
+		target = std::min(scale + 0.05f, scale * std::sqrt(0.9f * budget_ms / smooth_ms));
+	}
+	//(quantized, so small changes in timing don't reallocate anything or shift the image)
+	target = std::round(target * 40.0f) / 40.0f;
+	target = std::max(min_scale, std::min(1.0f, target));
+	if (target == scale) return false;
+
+	scale = target;
+	changed_frame = timers.frame; //(the frame about to be drawn, since update() comes before its passes)
+	samples = 0;
+	return true;
+}
+
+glm::uvec2 DynamicResolution::region(glm::uvec2 const &size) const {
+	if (scale >= 1.0f) return size;
+	return glm::max(glm::uvec2(1), glm::uvec2(glm::round(glm::vec2(size) * scale)));
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "PassTimers.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+
+//"DynamicResolution" picks how much of the render targets to draw into, so that the GPU time of
+// a frame (as measured by PassTimers) stays under a budget; the rendered region is upscaled when
+// it is copied to the screen. e.g.:
+//   resolution.budget_ms = 14.0f;
+//   ...every frame: if (resolution.update(timers)) { /* scale changed */ }
+//   glm::uvec2 region = resolution.region(size);
+//The scale drops as soon as frames are over budget, and climbs back slowly (in small steps) once
+// they are comfortably under, so it doesn't oscillate; it only reacts to frames drawn after the last change.
+
+struct DynamicResolution {
+	float budget_ms = 0.0f; //GPU ms per frame to stay under (0 = off: always full resolution)
+	float min_scale = 0.5f; //smallest fraction of the output size (per axis) to render
+
+	float scale = 1.0f; //current fraction of the output size (per axis)
+
+	//look at the latest measured frame; returns true if 'scale' changed:
+	bool update(PassTimers const &timers);
+	//size of the region to render for an output of 'size' (at least 1x1):
+	glm::uvec2 region(glm::uvec2 const &size) const;
+
+	//internals:
+	uint32_t changed_frame = 0; //PassTimers frame the current scale was first used in
+	uint32_t samples = 0; //measured frames since then
+	uint32_t last_measured = -1U; //PassTimers frame of the last measurement used
+	float smooth_ms = 0.0f; //smoothed GPU time of those frames
+};
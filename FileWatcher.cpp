@@ -0,0 +1,110 @@
+#include "FileWatcher.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <cerrno>
+#else
+#include <sys/types.h>
+#include <sys/stat.h>
+#endif
+
+static std::string directory_of(std::string const &path) {
+	size_t slash = path.find_last_of("/\\");
+	if (slash == std::string::npos) return ".";
+	return path.substr(0, slash);
+}
+
+#ifdef __linux__
+
+FileWatcher::FileWatcher() {
+	fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (fd == -1) {
+		std::cerr << "WARNING: inotify unavailable; files won't be watched." << std::endl;
+	}
+}
+
+FileWatcher::~FileWatcher() {
+	if (fd != -1) close(fd);
+}
+
+void FileWatcher::watch(std::string const &path) {
+	paths.emplace_back(path);
+	if (fd == -1) return;
+	//watch the directory rather than the file, so files replaced by rename (or created later) are seen:
+	// (only finished writes count, so a half-written file is never reported)
+	std::string dir = directory_of(path);
+	for (auto const &d : directories) {
+		if (d.second == dir) return;
+	}
+	int wd = inotify_add_watch(fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+	if (wd == -1) {
+		std::cerr << "WARNING: can't watch directory '" << dir << "'." << std::endl;
+		return;
+	}
+	directories[wd] = dir;
+}
+
+std::vector< std::string > FileWatcher::poll() {
+	std::vector< std::string > changed;
+	if (fd == -1) return changed;
+
+	alignas(inotify_event) char buffer[4096];
+	while (true) {
+		ssize_t got = read(fd, buffer, sizeof(buffer));
+		if (got <= 0) break; //(EAGAIN: nothing more right now)
+		for (char *at = buffer; at < buffer + got; ) {
+			inotify_event const *event = reinterpret_cast< inotify_event const * >(at);
+			at += sizeof(inotify_event) + event->len;
+			auto d = directories.find(event->wd);
+			if (d == directories.end() || event->len == 0) continue;
+			std::string path = d->second + "/" + event->name;
+			if (std::find(paths.begin(), paths.end(), path) == paths.end()) continue;
+			if (std::find(changed.begin(), changed.end(), path) == changed.end()) {
+				changed.emplace_back(path);
+			}
+		}
+	}
+	return changed;
+}
+
+#else
+
+static std::time_t modification_time(std::string const &path) {
+	struct stat info;
+	if (stat(path.c_str(), &info) != 0) return 0;
+	return info.st_mtime;
+}
+
+FileWatcher::FileWatcher() {
+}
+
+FileWatcher::~FileWatcher() {
+}
+
+void FileWatcher::watch(std::string const &path) {
+	paths.emplace_back(path);
+	modified[path] = modification_time(path);
+}
+
+std::vector< std::string > FileWatcher::poll() {
+	std::vector< std::string > changed;
+	//(stat-ing every frame would be wasteful; once a second is plenty for edits by hand)
+	std::time_t now = std::time(nullptr);
+	if (now == last_check) return changed;
+	last_check = now;
+	for (auto &m : modified) {
+		std::time_t time = modification_time(m.first);
+		if (time != m.second) {
+			m.second = time;
+			if (time != 0) changed.emplace_back(m.first);
+		}
+	}
+	return changed;
+}
+
+#endif
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <ctime>
+
+//"FileWatcher" notices when files are rewritten (e.g., re-exported from blender):
+// on Linux it uses inotify on the files' directories; elsewhere it checks modification times.
+// note: files don't need to exist yet when watched.
+
+struct FileWatcher {
+	FileWatcher();
+	~FileWatcher();
+	FileWatcher(FileWatcher const &) = delete;
+	FileWatcher &operator=(FileWatcher const &) = delete;
+
+	void watch(std::string const &path);
+
+	//paths (as passed to watch()) changed since the last call; doesn't block:
+	// (a file written in several steps may show up in more than one call)
+	std::vector< std::string > poll();
+
+	//internals:
+	#ifdef __linux__
+	int fd = -1; //inotify instance
+	std::map< int, std::string > directories; //watch descriptor -> directory
+	#else
+	std::map< std::string, std::time_t > modified; //path -> last seen modification time
+	std::time_t last_check = 0;
+	#endif
+	std::vector< std::string > paths;
+};
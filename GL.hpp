@@ -12,3 +12,6 @@
 #define GL_GLEXT_PROTOTYPES 1
 #include "glcorearb.h"
 #endif
+
+//GL calls that change state are routed through GLCapture's recorder (see GLCapture.hpp):
+#include "GLCapture.hpp"
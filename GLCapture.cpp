@@ -0,0 +1,259 @@
+//(the recorder itself makes real GL calls, which must not be recorded)
+#define GL_CAPTURE_NO_WRAPPERS
+#include "GL.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <unordered_map>
+#include <vector>
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+
+bool GLCapture::recording_flag = false;
+
+namespace {
+	//capture state (only touched on the GL thread):
+	std::vector< char > stream; //"cmd0" chunk being built
+	uint32_t frame_count = 0;
+	uint32_t window_width = 0, window_height = 0;
+	std::string gl_strings; //vendor, renderer, version (each followed by '\0')
+
+	std::unordered_map< GLsync, uint32_t > syncs;
+	uint32_t next_sync_id = 1;
+	std::map< GLenum, GLuint > bound_buffers; //target -> buffer
+	GLint unpack_alignment = 4, pack_alignment = 4;
+	struct Mapping {
+		char *ptr = nullptr;
+		int64_t offset = 0;
+		int64_t length = 0;
+		GLbitfield access = 0;
+	};
+	std::map< GLuint, Mapping > mappings; //buffer -> current mapping
+
+	//bytes in an image of this size, given rows padded to 'alignment':
+	size_t image_size(GLsizei width, GLsizei height, GLenum format, GLenum type, GLint alignment) {
+		size_t components = 4;
+		if (format == GL_RED || format == GL_RED_INTEGER || format == GL_DEPTH_COMPONENT || format == GL_STENCIL_INDEX
+			|| format == GL_DEPTH_STENCIL) components = 1;
+		else if (format == GL_RG || format == GL_RG_INTEGER) components = 2;
+		else if (format == GL_RGB || format == GL_BGR || format == GL_RGB_INTEGER) components = 3;
+		size_t pixel = components;
+		if (type == GL_UNSIGNED_SHORT || type == GL_SHORT || type == GL_HALF_FLOAT) pixel = 2 * components;
+		else if (type == GL_UNSIGNED_INT || type == GL_INT || type == GL_FLOAT) pixel = 4 * components;
+		else if (type == GL_UNSIGNED_SHORT_5_6_5 || type == GL_UNSIGNED_SHORT_4_4_4_4 || type == GL_UNSIGNED_SHORT_5_5_5_1) pixel = 2;
+		else if (type == GL_UNSIGNED_INT_8_8_8_8 || type == GL_UNSIGNED_INT_8_8_8_8_REV || type == GL_UNSIGNED_INT_2_10_10_10_REV
+			|| type == GL_UNSIGNED_INT_24_8 || type == GL_UNSIGNED_INT_10F_11F_11F_REV) pixel = 4;
+		if (width <= 0 || height <= 0) return 0;
+		size_t row = pixel * size_t(width);
+		size_t padded = (row + size_t(alignment) - 1) / size_t(alignment) * size_t(alignment);
+		return padded * size_t(height - 1) + row;
+	}
+
+	void write_chunk(std::ostream &to, char const *magic, void const *data, size_t size) {
+		if (size > 0xffffffffUL) {
+			throw std::runtime_error("Capture chunk '" + std::string(magic, 4) + "' is over 4GB; capture fewer frames.");
+		}
+		uint32_t size32 = uint32_t(size);
+		to.write(magic, 4);
+		to.write(reinterpret_cast< char const * >(&size32), 4);
+		to.write(reinterpret_cast< char const * >(data), size);
+	}
+}
+
+char const *GLCapture::call_name(Call call) {
+	static char const *names[] = {
+		#define GL_CAPTURE_NAME(NAME) #NAME,
+		GL_CAPTURE_CALLS(GL_CAPTURE_NAME)
+		#undef GL_CAPTURE_NAME
+	};
+	static_assert(sizeof(names) / sizeof(names[0]) == size_t(Call::Count), "every call has a name");
+	return (call < Call::Count ? names[size_t(call)] : "(unknown)");
+}
+
+void GLCapture::start(uint32_t window_width_, uint32_t window_height_) {
+	#if !GL_CAPTURE
+	std::cerr << "WARNING: built with GL_CAPTURE=0, so nothing will be captured." << std::endl;
+	return;
+	#endif
+	stream.clear();
+	stream.reserve(64 << 20);
+	frame_count = 0;
+	window_width = window_width_;
+	window_height = window_height_;
+	gl_strings.clear();
+	for (GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+		GLubyte const *str = glGetString(name);
+		gl_strings += (str ? reinterpret_cast< char const * >(str) : "");
+		gl_strings += '\0';
+	}
+	syncs.clear();
+	next_sync_id = 1;
+	bound_buffers.clear();
+	unpack_alignment = pack_alignment = 4;
+	mappings.clear();
+	recording_flag = true;
+}
+
+void GLCapture::end_frame() {
+	if (!recording_flag) return;
+	record(Call::Frame);
+	frame_count += 1;
+}
+
+uint32_t GLCapture::frames() {
+	return frame_count;
+}
+
+bool GLCapture::stop(std::string const &filename) {
+	recording_flag = false;
+
+	//"cap0" header: version, frames, window width, window height
+	uint32_t header[4] = {1, frame_count, window_width, window_height};
+	std::ofstream out(filename, std::ios::binary);
+	try {
+		write_chunk(out, "cap0", header, sizeof(header));
+		write_chunk(out, "str0", gl_strings.data(), gl_strings.size());
+		write_chunk(out, "cmd0", stream.data(), stream.size());
+	} catch (std::exception const &e) {
+		std::cerr << "WARNING: can't write capture: " << e.what() << std::endl;
+		return false;
+	}
+	if (!out) {
+		std::cerr << "WARNING: can't write capture to '" << filename << "'." << std::endl;
+		return false;
+	}
+	std::cout << "Wrote " << frame_count << " frames of GL calls (" << stream.size() / 1024 << "kB) to '" << filename << "'." << std::endl;
+	std::vector< char >().swap(stream);
+	return true;
+}
+
+void GLCapture::put_bytes(void const *data, size_t size) {
+	char const *bytes = reinterpret_cast< char const * >(data);
+	stream.insert(stream.end(), bytes, bytes + size);
+}
+
+void GLCapture::put_blob(void const *data, size_t size) {
+	put(uint8_t(data ? 1 : 0));
+	if (data) {
+		put(uint64_t(size));
+		put_bytes(data, size);
+	}
+}
+
+uint32_t GLCapture::sync_id(GLsync sync) {
+	auto f = syncs.find(sync);
+	return (f != syncs.end() ? f->second : 0);
+}
+
+uint32_t GLCapture::new_sync_id(GLsync sync) {
+	uint32_t id = next_sync_id++;
+	syncs[sync] = id;
+	return id;
+}
+
+void GLCapture::record_DeleteSync(GLsync sync) {
+	record(Call::DeleteSync, sync_id(sync));
+	syncs.erase(sync); //(the driver may hand out the same pointer again)
+}
+
+void GLCapture::record_BindBuffer(GLenum target, GLuint buffer) {
+	bound_buffers[target] = buffer;
+	record(Call::BindBuffer, target, buffer);
+}
+
+void GLCapture::record_PixelStorei(GLenum pname, GLint param) {
+	if (pname == GL_UNPACK_ALIGNMENT) unpack_alignment = param;
+	if (pname == GL_PACK_ALIGNMENT) pack_alignment = param;
+	record(Call::PixelStorei, pname, param);
+}
+
+void GLCapture::record_TexImage(Call call, GLenum target, GLint level, GLint internalformat_or_x, GLint y,
+	GLsizei width, GLsizei height, GLenum format, GLenum type, void const *pixels) {
+	record(call, target, level, internalformat_or_x, y, width, height, format, type);
+	put_blob(pixels, image_size(width, height, format, type, unpack_alignment));
+}
+
+void GLCapture::record_GetTexImage(GLenum target, GLint level, GLenum format, GLenum type) {
+	GLint width = 0, height = 0;
+	glGetTexLevelParameteriv(target, level, GL_TEXTURE_WIDTH, &width);
+	glGetTexLevelParameteriv(target, level, GL_TEXTURE_HEIGHT, &height);
+	record(Call::GetTexImage, target, level, format, type, uint64_t(image_size(width, height, format, type, pack_alignment)));
+}
+
+void GLCapture::record_ReadPixels(GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, void const *pixels) {
+	//into a pixel pack buffer, 'pixels' is an offset (which the replay needs); otherwise just the size is kept:
+	bool packed = (bound_buffers[GL_PIXEL_PACK_BUFFER] != 0);
+	record(Call::ReadPixels, x, y, width, height, format, type, uint8_t(packed ? 1 : 0),
+		uint64_t(packed ? reinterpret_cast< uintptr_t >(pixels) : image_size(width, height, format, type, pack_alignment)));
+}
+
+void GLCapture::record_ShaderSource(GLuint shader, GLsizei count, GLchar const *const *string, GLint const *length) {
+	std::string source;
+	for (GLsizei i = 0; i < count; ++i) {
+		if (length && length[i] >= 0) source.append(string[i], size_t(length[i]));
+		else source.append(string[i]);
+	}
+	record(Call::ShaderSource, shader);
+	put_blob(source.data(), source.size());
+}
+
+void GLCapture::record_LinkProgram(GLuint program) {
+	//the replaying driver may pick different attribute locations, so they are stored (and bound before linking):
+	GLint count = 0, max_length = 0;
+	glGetProgramiv(program, GL_ACTIVE_ATTRIBUTES, &count);
+	glGetProgramiv(program, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &max_length);
+	std::vector< std::pair< GLint, std::string > > attribs;
+	std::vector< GLchar > name(size_t(std::max(max_length, 1)));
+	for (GLint i = 0; i < count; ++i) {
+		GLsizei length = 0;
+		GLint size = 0;
+		GLenum type = 0;
+		glGetActiveAttrib(program, GLuint(i), GLsizei(name.size()), &length, &size, &type, name.data());
+		std::string str(name.data(), size_t(length));
+		GLint location = glGetAttribLocation(program, str.c_str());
+		if (location >= 0) attribs.emplace_back(location, str); //(built-ins like gl_VertexID have none)
+	}
+	record(Call::LinkProgram, program, uint32_t(attribs.size()));
+	for (auto const &a : attribs) {
+		put(a.first);
+		put_blob(a.second.data(), a.second.size());
+	}
+}
+
+void GLCapture::record_MapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access, void *ptr) {
+	Mapping &m = mappings[bound_buffers[target]];
+	m.ptr = reinterpret_cast< char * >(ptr);
+	m.offset = int64_t(offset);
+	m.length = int64_t(length);
+	m.access = access;
+	record(Call::MapBufferRange, target, int64_t(offset), int64_t(length), access);
+}
+
+void GLCapture::record_UnmapBuffer(GLenum target) {
+	GLuint buffer = bound_buffers[target];
+	auto f = mappings.find(buffer);
+	record(Call::UnmapBuffer, target);
+	//whatever was written through a non-persistent mapping is uploaded at unmap:
+	// (persistent mappings report their writes as they happen; see mapped_write)
+	if (f != mappings.end() && f->second.ptr && (f->second.access & GL_MAP_WRITE_BIT) && !(f->second.access & GL_MAP_PERSISTENT_BIT)) {
+		put_blob(f->second.ptr, size_t(f->second.length));
+	} else {
+		put_blob(nullptr, 0);
+	}
+	if (f != mappings.end()) mappings.erase(f);
+}
+
+void GLCapture::mapped_write(GLuint buffer, GLintptr offset, GLsizeiptr size) {
+	if (!recording_flag) return;
+	auto f = mappings.find(buffer);
+	if (f == mappings.end() || !f->second.ptr) {
+		std::cerr << "WARNING: GLCapture::mapped_write() on a buffer that isn't mapped; replay will be missing that data." << std::endl;
+		return;
+	}
+	assert(int64_t(offset) >= f->second.offset && int64_t(offset + size) <= f->second.offset + f->second.length);
+	record(Call::MappedWrite, buffer, int64_t(offset));
+	put_blob(f->second.ptr + (int64_t(offset) - f->second.offset), size_t(size));
+}
@@ -0,0 +1,541 @@
+#pragma once
+
+//"GLCapture" records the GL command stream -- every call that changes GL state or waits on the GPU,
+// with its arguments and any data it uploads -- so it can be replayed by glreplay.cpp without the game:
+//   GLCapture::start(window_width, window_height); //right after making the context
+//   ...every frame: draw(); GLCapture::end_frame();
+//   GLCapture::stop("frames.glcap");
+//A capture is replayed from an empty context, so it has to start before any GL object is made.
+//Calls are recorded by wrappers that GL.hpp substitutes for the real functions (e.g., glDrawArrays
+// becomes capture_glDrawArrays); while not recording, a wrapper costs one extra branch.
+//Pure queries (glGetIntegerv, glGetError, ...) aren't recorded; neither are writes through persistently
+// mapped pointers, which make no GL calls -- code that does that reports them with mapped_write().
+//Building with -DGL_CAPTURE=0 removes the wrappers.
+// note: GL calls are expected on one thread (the one with the context).
+
+#ifndef GL_CAPTURE
+#define GL_CAPTURE 1
+#endif
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+namespace GLCapture {
+	//(the window size is stored so the replay can make a default framebuffer the same size)
+	void start(uint32_t window_width, uint32_t window_height);
+	inline bool recording();
+	//mark the end of a frame (replays are timed per frame):
+	void end_frame();
+	uint32_t frames(); //frames ended since start()
+	//stop recording and write everything recorded since start() to 'filename':
+	// returns false (after a warning) if the file can't be written.
+	bool stop(std::string const &filename);
+
+	//the CPU wrote [offset, offset+size) of 'buffer' through a persistent mapping:
+	void mapped_write(GLuint buffer, GLintptr offset, GLsizeiptr size);
+
+	//every recorded call (the capture file stores these numbers, so only ever append):
+	#define GL_CAPTURE_CALLS(X) \
+		X(Frame) X(MappedWrite) \
+		X(ActiveTexture) X(AttachShader) X(BeginQuery) X(BindBuffer) X(BindBufferBase) X(BindFramebuffer) \
+		X(BindTexture) X(BindVertexArray) X(BlendEquation) X(BlendFunc) X(BufferData) X(BufferStorage) \
+		X(BufferSubData) X(Clear) X(ClearBufferfv) X(ClearColor) X(ClientWaitSync) X(CompileShader) \
+		X(CreateProgram) X(CreateShader) X(DeleteBuffers) X(DeleteProgram) X(DeleteQueries) X(DeleteShader) \
+		X(DeleteSync) X(DeleteTextures) X(Disable) X(DrawArrays) X(DrawArraysInstanced) X(DrawBuffers) \
+		X(DrawElements) X(DrawElementsInstanced) X(Enable) X(EnableVertexAttribArray) X(EndQuery) X(FenceSync) \
+		X(Finish) X(FramebufferTexture2D) X(GenBuffers) X(GenFramebuffers) X(GenQueries) X(GenTextures) \
+		X(GenVertexArrays) X(GenerateMipmap) X(GetBufferSubData) X(GetQueryObjectiv) X(GetQueryObjectui64v) \
+		X(GetTexImage) X(GetUniformBlockIndex) X(GetUniformLocation) X(LinkProgram) X(MapBufferRange) \
+		X(MultiDrawArraysIndirect) X(MultiDrawElementsIndirect) X(PixelStorei) X(ShaderSource) X(TexBuffer) \
+		X(TexImage2D) X(TexParameteri) X(TexSubImage2D) X(Uniform1f) X(Uniform1fv) X(Uniform1i) X(Uniform4fv) \
+		X(UniformBlockBinding) X(UniformMatrix3fv) X(UniformMatrix4fv) X(UniformMatrix4x3fv) X(UnmapBuffer) \
+		X(UseProgram) X(VertexAttribDivisor) X(VertexAttribIPointer) X(VertexAttribPointer) X(Viewport) \
+		X(Uniform2f) X(ReadPixels)
+
+	enum class Call : uint16_t {
+		#define GL_CAPTURE_ENUM(NAME) NAME,
+		GL_CAPTURE_CALLS(GL_CAPTURE_ENUM)
+		#undef GL_CAPTURE_ENUM
+		Count
+	};
+	char const *call_name(Call call);
+
+	//internals (used by the wrappers below):
+	extern bool recording_flag;
+	void put_bytes(void const *data, size_t size);
+	inline void put() { }
+	template< typename T, typename... Rest >
+	inline void put(T const &value, Rest const &... rest) {
+		put_bytes(&value, sizeof(value));
+		put(rest...);
+	}
+	template< typename... Args >
+	inline void record(Call call, Args const &... args) {
+		put(uint16_t(call), args...);
+	}
+	void put_blob(void const *data, size_t size); //(nullptr data is stored as "no data")
+	uint32_t sync_id(GLsync sync); //syncs are stored as small numbers
+	uint32_t new_sync_id(GLsync sync);
+	void record_DeleteSync(GLsync sync);
+	void record_BindBuffer(GLenum target, GLuint buffer);
+	void record_PixelStorei(GLenum pname, GLint param);
+	void record_TexImage(Call call, GLenum target, GLint level, GLint internalformat_or_x, GLint y,
+		GLsizei width, GLsizei height, GLenum format, GLenum type, void const *pixels);
+	void record_GetTexImage(GLenum target, GLint level, GLenum format, GLenum type);
+	void record_ReadPixels(GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, void const *pixels);
+	void record_ShaderSource(GLuint shader, GLsizei count, GLchar const *const *string, GLint const *length);
+	void record_LinkProgram(GLuint program);
+	void record_MapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access, void *ptr);
+	void record_UnmapBuffer(GLenum target);
+}
+
+inline bool GLCapture::recording() {
+	return recording_flag;
+}
+
+#if GL_CAPTURE && !defined(GL_CAPTURE_NO_WRAPPERS)
+
+//---- wrappers ----
+//(each calls the real function, then records the call; pointers into bound buffers are stored as offsets)
+
+#define GL_CAPTURE_RECORD(...) if (GLCapture::recording()) GLCapture::record(__VA_ARGS__)
+#define GL_CAPTURE_NAMES(CALL, n, names) if (GLCapture::recording()) { \
+		GLCapture::record(GLCapture::Call::CALL, n); GLCapture::put_bytes(names, sizeof(GLuint) * size_t(n)); }
+
+inline void capture_glActiveTexture(GLenum texture) {
+	glActiveTexture(texture);
+	GL_CAPTURE_RECORD(GLCapture::Call::ActiveTexture, texture);
+}
+inline void capture_glAttachShader(GLuint program, GLuint shader) {
+	glAttachShader(program, shader);
+	GL_CAPTURE_RECORD(GLCapture::Call::AttachShader, program, shader);
+}
+inline void capture_glBeginQuery(GLenum target, GLuint id) {
+	glBeginQuery(target, id);
+	GL_CAPTURE_RECORD(GLCapture::Call::BeginQuery, target, id);
+}
+inline void capture_glBindBuffer(GLenum target, GLuint buffer) {
+	glBindBuffer(target, buffer);
+	if (GLCapture::recording()) GLCapture::record_BindBuffer(target, buffer);
+}
+inline void capture_glBindBufferBase(GLenum target, GLuint index, GLuint buffer) {
+	glBindBufferBase(target, index, buffer);
+	GL_CAPTURE_RECORD(GLCapture::Call::BindBufferBase, target, index, buffer);
+}
+inline void capture_glBindFramebuffer(GLenum target, GLuint framebuffer) {
+	glBindFramebuffer(target, framebuffer);
+	GL_CAPTURE_RECORD(GLCapture::Call::BindFramebuffer, target, framebuffer);
+}
+inline void capture_glBindTexture(GLenum target, GLuint texture) {
+	glBindTexture(target, texture);
+	GL_CAPTURE_RECORD(GLCapture::Call::BindTexture, target, texture);
+}
+inline void capture_glBindVertexArray(GLuint array) {
+	glBindVertexArray(array);
+	GL_CAPTURE_RECORD(GLCapture::Call::BindVertexArray, array);
+}
+inline void capture_glBlendEquation(GLenum mode) {
+	glBlendEquation(mode);
+	GL_CAPTURE_RECORD(GLCapture::Call::BlendEquation, mode);
+}
+inline void capture_glBlendFunc(GLenum sfactor, GLenum dfactor) {
+	glBlendFunc(sfactor, dfactor);
+	GL_CAPTURE_RECORD(GLCapture::Call::BlendFunc, sfactor, dfactor);
+}
+inline void capture_glBufferData(GLenum target, GLsizeiptr size, void const *data, GLenum usage) {
+	glBufferData(target, size, data, usage);
+	if (GLCapture::recording()) {
+		GLCapture::record(GLCapture::Call::BufferData, target, int64_t(size), usage);
+		GLCapture::put_blob(data, size_t(size));
+	}
+}
+inline void capture_glBufferStorage(GLenum target, GLsizeiptr size, void const *data, GLbitfield flags) {
+	glBufferStorage(target, size, data, flags);
+	if (GLCapture::recording()) {
+		GLCapture::record(GLCapture::Call::BufferStorage, target, int64_t(size), flags);
+		GLCapture::put_blob(data, size_t(size));
+	}
+}
+inline void capture_glBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, void const *data) {
+	glBufferSubData(target, offset, size, data);
+	if (GLCapture::recording()) {
+		GLCapture::record(GLCapture::Call::BufferSubData, target, int64_t(offset), int64_t(size));
+		GLCapture::put_blob(data, size_t(size));
+	}
+}
+inline void capture_glClear(GLbitfield mask) {
+	glClear(mask);
+	GL_CAPTURE_RECORD(GLCapture::Call::Clear, mask);
+}
+inline void capture_glClearBufferfv(GLenum buffer, GLint drawbuffer, GLfloat const *value) {
+	glClearBufferfv(buffer, drawbuffer, value);
+	if (GLCapture::recording()) {
+		GLCapture::record(GLCapture::Call::ClearBufferfv, buffer, drawbuffer);
+		GLCapture::put_bytes(value, sizeof(GLfloat) * (buffer == GL_COLOR ? 4 : 1));
+	}
+}
+inline void capture_glClearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha) {
+	glClearColor(red, green, blue, alpha);
+	GL_CAPTURE_RECORD(GLCapture::Call::ClearColor, red, green, blue, alpha);
+}
+inline GLenum capture_glClientWaitSync(GLsync sync, GLbitfield flags, GLuint64 timeout) {
+	GLenum ret = glClientWaitSync(sync, flags, timeout);
+	GL_CAPTURE_RECORD(GLCapture::Call::ClientWaitSync, GLCapture::sync_id(sync), flags, timeout);
+	return ret;
+}
+inline void capture_glCompileShader(GLuint shader) {
+	glCompileShader(shader);
+	GL_CAPTURE_RECORD(GLCapture::Call::CompileShader, shader);
+}
+inline GLuint capture_glCreateProgram() {
+	GLuint ret = glCreateProgram();
+	GL_CAPTURE_RECORD(GLCapture::Call::CreateProgram, ret);
+	return ret;
+}
+inline GLuint capture_glCreateShader(GLenum type) {
+	GLuint ret = glCreateShader(type);
+	GL_CAPTURE_RECORD(GLCapture::Call::CreateShader, type, ret);
+	return ret;
+}
+inline void capture_glDeleteBuffers(GLsizei n, GLuint const *buffers) {
+	glDeleteBuffers(n, buffers);
+	GL_CAPTURE_NAMES(DeleteBuffers, n, buffers);
+}
+inline void capture_glDeleteProgram(GLuint program) {
+	glDeleteProgram(program);
+	GL_CAPTURE_RECORD(GLCapture::Call::DeleteProgram, program);
+}
+inline void capture_glDeleteQueries(GLsizei n, GLuint const *ids) {
+	glDeleteQueries(n, ids);
+	GL_CAPTURE_NAMES(DeleteQueries, n, ids);
+}
+inline void capture_glDeleteShader(GLuint shader) {
+	glDeleteShader(shader);
+	GL_CAPTURE_RECORD(GLCapture::Call::DeleteShader, shader);
+}
+inline void capture_glDeleteSync(GLsync sync) {
+	glDeleteSync(sync);
+	if (GLCapture::recording()) GLCapture::record_DeleteSync(sync);
+}
+inline void capture_glDeleteTextures(GLsizei n, GLuint const *textures) {
+	glDeleteTextures(n, textures);
+	GL_CAPTURE_NAMES(DeleteTextures, n, textures);
+}
+inline void capture_glDisable(GLenum cap) {
+	glDisable(cap);
+	GL_CAPTURE_RECORD(GLCapture::Call::Disable, cap);
+}
+inline void capture_glDrawArrays(GLenum mode, GLint first, GLsizei count) {
+	glDrawArrays(mode, first, count);
+	GL_CAPTURE_RECORD(GLCapture::Call::DrawArrays, mode, first, count);
+}
+inline void capture_glDrawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instancecount) {
+	glDrawArraysInstanced(mode, first, count, instancecount);
+	GL_CAPTURE_RECORD(GLCapture::Call::DrawArraysInstanced, mode, first, count, instancecount);
+}
+inline void capture_glDrawBuffers(GLsizei n, GLenum const *bufs) {
+	glDrawBuffers(n, bufs);
+	if (GLCapture::recording()) {
+		GLCapture::record(GLCapture::Call::DrawBuffers, n);
+		GLCapture::put_bytes(bufs, sizeof(GLenum) * size_t(n));
+	}
+}
+inline void capture_glDrawElements(GLenum mode, GLsizei count, GLenum type, void const *indices) {
+	glDrawElements(mode, count, type, indices);
+	GL_CAPTURE_RECORD(GLCapture::Call::DrawElements, mode, count, type, int64_t(reinterpret_cast< intptr_t >(indices)));
+}
+inline void capture_glDrawElementsInstanced(GLenum mode, GLsizei count, GLenum type, void const *indices, GLsizei instancecount) {
+	glDrawElementsInstanced(mode, count, type, indices, instancecount);
+	GL_CAPTURE_RECORD(GLCapture::Call::DrawElementsInstanced, mode, count, type, int64_t(reinterpret_cast< intptr_t >(indices)), instancecount);
+}
+inline void capture_glEnable(GLenum cap) {
+	glEnable(cap);
+	GL_CAPTURE_RECORD(GLCapture::Call::Enable, cap);
+}
+inline void capture_glEnableVertexAttribArray(GLuint index) {
+	glEnableVertexAttribArray(index);
+	GL_CAPTURE_RECORD(GLCapture::Call::EnableVertexAttribArray, index);
+}
+inline void capture_glEndQuery(GLenum target) {
+	glEndQuery(target);
+	GL_CAPTURE_RECORD(GLCapture::Call::EndQuery, target);
+}
+inline GLsync capture_glFenceSync(GLenum condition, GLbitfield flags) {
+	GLsync ret = glFenceSync(condition, flags);
+	GL_CAPTURE_RECORD(GLCapture::Call::FenceSync, condition, flags, GLCapture::new_sync_id(ret));
+	return ret;
+}
+inline void capture_glFinish() {
+	glFinish();
+	GL_CAPTURE_RECORD(GLCapture::Call::Finish);
+}
+inline void capture_glFramebufferTexture2D(GLenum target, GLenum attachment, GLenum textarget, GLuint texture, GLint level) {
+	glFramebufferTexture2D(target, attachment, textarget, texture, level);
+	GL_CAPTURE_RECORD(GLCapture::Call::FramebufferTexture2D, target, attachment, textarget, texture, level);
+}
+inline void capture_glGenBuffers(GLsizei n, GLuint *buffers) {
+	glGenBuffers(n, buffers);
+	GL_CAPTURE_NAMES(GenBuffers, n, buffers);
+}
+inline void capture_glGenFramebuffers(GLsizei n, GLuint *framebuffers) {
+	glGenFramebuffers(n, framebuffers);
+	GL_CAPTURE_NAMES(GenFramebuffers, n, framebuffers);
+}
+inline void capture_glGenQueries(GLsizei n, GLuint *ids) {
+	glGenQueries(n, ids);
+	GL_CAPTURE_NAMES(GenQueries, n, ids);
+}
+inline void capture_glGenTextures(GLsizei n, GLuint *textures) {
+	glGenTextures(n, textures);
+	GL_CAPTURE_NAMES(GenTextures, n, textures);
+}
+inline void capture_glGenVertexArrays(GLsizei n, GLuint *arrays) {
+	glGenVertexArrays(n, arrays);
+	GL_CAPTURE_NAMES(GenVertexArrays, n, arrays);
+}
+inline void capture_glGenerateMipmap(GLenum target) {
+	glGenerateMipmap(target);
+	GL_CAPTURE_RECORD(GLCapture::Call::GenerateMipmap, target);
+}
+inline void capture_glGetBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, void *data) {
+	glGetBufferSubData(target, offset, size, data);
+	GL_CAPTURE_RECORD(GLCapture::Call::GetBufferSubData, target, int64_t(offset), int64_t(size));
+}
+inline void capture_glGetQueryObjectiv(GLuint id, GLenum pname, GLint *params) {
+	glGetQueryObjectiv(id, pname, params);
+	GL_CAPTURE_RECORD(GLCapture::Call::GetQueryObjectiv, id, pname);
+}
+inline void capture_glGetQueryObjectui64v(GLuint id, GLenum pname, GLuint64 *params) {
+	glGetQueryObjectui64v(id, pname, params);
+	GL_CAPTURE_RECORD(GLCapture::Call::GetQueryObjectui64v, id, pname);
+}
+inline void capture_glGetTexImage(GLenum target, GLint level, GLenum format, GLenum type, void *pixels) {
+	glGetTexImage(target, level, format, type, pixels);
+	if (GLCapture::recording()) GLCapture::record_GetTexImage(target, level, format, type);
+}
+inline GLuint capture_glGetUniformBlockIndex(GLuint program, GLchar const *uniformBlockName) {
+	GLuint ret = glGetUniformBlockIndex(program, uniformBlockName);
+	if (GLCapture::recording()) {
+		GLCapture::record(GLCapture::Call::GetUniformBlockIndex, program, ret);
+		GLCapture::put_blob(uniformBlockName, std::char_traits< char >::length(uniformBlockName) + 1);
+	}
+	return ret;
+}
+inline GLint capture_glGetUniformLocation(GLuint program, GLchar const *name) {
+	GLint ret = glGetUniformLocation(program, name);
+	if (GLCapture::recording()) {
+		GLCapture::record(GLCapture::Call::GetUniformLocation, program, ret);
+		GLCapture::put_blob(name, std::char_traits< char >::length(name) + 1);
+	}
+	return ret;
+}
+inline void capture_glLinkProgram(GLuint program) {
+	glLinkProgram(program);
+	if (GLCapture::recording()) GLCapture::record_LinkProgram(program);
+}
+inline void *capture_glMapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access) {
+	void *ret = glMapBufferRange(target, offset, length, access);
+	if (GLCapture::recording()) GLCapture::record_MapBufferRange(target, offset, length, access, ret);
+	return ret;
+}
+inline void capture_glMultiDrawArraysIndirect(GLenum mode, void const *indirect, GLsizei drawcount, GLsizei stride) {
+	glMultiDrawArraysIndirect(mode, indirect, drawcount, stride);
+	GL_CAPTURE_RECORD(GLCapture::Call::MultiDrawArraysIndirect, mode, int64_t(reinterpret_cast< intptr_t >(indirect)), drawcount, stride);
+}
+inline void capture_glMultiDrawElementsIndirect(GLenum mode, GLenum type, void const *indirect, GLsizei drawcount, GLsizei stride) {
+	glMultiDrawElementsIndirect(mode, type, indirect, drawcount, stride);
+	GL_CAPTURE_RECORD(GLCapture::Call::MultiDrawElementsIndirect, mode, type, int64_t(reinterpret_cast< intptr_t >(indirect)), drawcount, stride);
+}
+inline void capture_glPixelStorei(GLenum pname, GLint param) {
+	glPixelStorei(pname, param);
+	if (GLCapture::recording()) GLCapture::record_PixelStorei(pname, param);
+}
+inline void capture_glReadPixels(GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, void *pixels) {
+	glReadPixels(x, y, width, height, format, type, pixels);
+	if (GLCapture::recording()) GLCapture::record_ReadPixels(x, y, width, height, format, type, pixels);
+}
+inline void capture_glShaderSource(GLuint shader, GLsizei count, GLchar const *const *string, GLint const *length) {
+	glShaderSource(shader, count, string, length);
+	if (GLCapture::recording()) GLCapture::record_ShaderSource(shader, count, string, length);
+}
+inline void capture_glTexBuffer(GLenum target, GLenum internalformat, GLuint buffer) {
+	glTexBuffer(target, internalformat, buffer);
+	GL_CAPTURE_RECORD(GLCapture::Call::TexBuffer, target, internalformat, buffer);
+}
+inline void capture_glTexImage2D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height,
+	GLint border, GLenum format, GLenum type, void const *pixels) {
+	glTexImage2D(target, level, internalformat, width, height, border, format, type, pixels);
+	if (GLCapture::recording()) {
+		GLCapture::record_TexImage(GLCapture::Call::TexImage2D, target, level, internalformat, border, width, height, format, type, pixels);
+	}
+}
+inline void capture_glTexParameteri(GLenum target, GLenum pname, GLint param) {
+	glTexParameteri(target, pname, param);
+	GL_CAPTURE_RECORD(GLCapture::Call::TexParameteri, target, pname, param);
+}
+inline void capture_glTexSubImage2D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height,
+	GLenum format, GLenum type, void const *pixels) {
+	glTexSubImage2D(target, level, xoffset, yoffset, width, height, format, type, pixels);
+	if (GLCapture::recording()) {
+		GLCapture::record_TexImage(GLCapture::Call::TexSubImage2D, target, level, xoffset, yoffset, width, height, format, type, pixels);
+	}
+}
+inline void capture_glUniform1f(GLint location, GLfloat v0) {
+	glUniform1f(location, v0);
+	GL_CAPTURE_RECORD(GLCapture::Call::Uniform1f, location, v0);
+}
+inline void capture_glUniform2f(GLint location, GLfloat v0, GLfloat v1) {
+	glUniform2f(location, v0, v1);
+	GL_CAPTURE_RECORD(GLCapture::Call::Uniform2f, location, v0, v1);
+}
+inline void capture_glUniform1fv(GLint location, GLsizei count, GLfloat const *value) {
+	glUniform1fv(location, count, value);
+	if (GLCapture::recording()) {
+		GLCapture::record(GLCapture::Call::Uniform1fv, location, count);
+		GLCapture::put_bytes(value, sizeof(GLfloat) * 1 * size_t(count));
+	}
+}
+inline void capture_glUniform1i(GLint location, GLint v0) {
+	glUniform1i(location, v0);
+	GL_CAPTURE_RECORD(GLCapture::Call::Uniform1i, location, v0);
+}
+inline void capture_glUniform4fv(GLint location, GLsizei count, GLfloat const *value) {
+	glUniform4fv(location, count, value);
+	if (GLCapture::recording()) {
+		GLCapture::record(GLCapture::Call::Uniform4fv, location, count);
+		GLCapture::put_bytes(value, sizeof(GLfloat) * 4 * size_t(count));
+	}
+}
+inline void capture_glUniformBlockBinding(GLuint program, GLuint uniformBlockIndex, GLuint uniformBlockBinding) {
+	glUniformBlockBinding(program, uniformBlockIndex, uniformBlockBinding);
+	GL_CAPTURE_RECORD(GLCapture::Call::UniformBlockBinding, program, uniformBlockIndex, uniformBlockBinding);
+}
+inline void capture_glUniformMatrix3fv(GLint location, GLsizei count, GLboolean transpose, GLfloat const *value) {
+	glUniformMatrix3fv(location, count, transpose, value);
+	if (GLCapture::recording()) {
+		GLCapture::record(GLCapture::Call::UniformMatrix3fv, location, count, transpose);
+		GLCapture::put_bytes(value, sizeof(GLfloat) * 9 * size_t(count));
+	}
+}
+inline void capture_glUniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, GLfloat const *value) {
+	glUniformMatrix4fv(location, count, transpose, value);
+	if (GLCapture::recording()) {
+		GLCapture::record(GLCapture::Call::UniformMatrix4fv, location, count, transpose);
+		GLCapture::put_bytes(value, sizeof(GLfloat) * 16 * size_t(count));
+	}
+}
+inline void capture_glUniformMatrix4x3fv(GLint location, GLsizei count, GLboolean transpose, GLfloat const *value) {
+	glUniformMatrix4x3fv(location, count, transpose, value);
+	if (GLCapture::recording()) {
+		GLCapture::record(GLCapture::Call::UniformMatrix4x3fv, location, count, transpose);
+		GLCapture::put_bytes(value, sizeof(GLfloat) * 12 * size_t(count));
+	}
+}
+inline GLboolean capture_glUnmapBuffer(GLenum target) {
+	//(recorded first, since the mapped data goes away)
+	if (GLCapture::recording()) GLCapture::record_UnmapBuffer(target);
+	return glUnmapBuffer(target);
+}
+inline void capture_glUseProgram(GLuint program) {
+	glUseProgram(program);
+	GL_CAPTURE_RECORD(GLCapture::Call::UseProgram, program);
+}
+inline void capture_glVertexAttribDivisor(GLuint index, GLuint divisor) {
+	glVertexAttribDivisor(index, divisor);
+	GL_CAPTURE_RECORD(GLCapture::Call::VertexAttribDivisor, index, divisor);
+}
+inline void capture_glVertexAttribIPointer(GLuint index, GLint size, GLenum type, GLsizei stride, void const *pointer) {
+	glVertexAttribIPointer(index, size, type, stride, pointer);
+	GL_CAPTURE_RECORD(GLCapture::Call::VertexAttribIPointer, index, size, type, stride, int64_t(reinterpret_cast< intptr_t >(pointer)));
+}
+inline void capture_glVertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, void const *pointer) {
+	glVertexAttribPointer(index, size, type, normalized, stride, pointer);
+	GL_CAPTURE_RECORD(GLCapture::Call::VertexAttribPointer, index, size, type, normalized, stride, int64_t(reinterpret_cast< intptr_t >(pointer)));
+}
+inline void capture_glViewport(GLint x, GLint y, GLsizei width, GLsizei height) {
+	glViewport(x, y, width, height);
+	GL_CAPTURE_RECORD(GLCapture::Call::Viewport, x, y, width, height);
+}
+
+#undef GL_CAPTURE_RECORD
+#undef GL_CAPTURE_NAMES
+
+#define glActiveTexture capture_glActiveTexture
+#define glAttachShader capture_glAttachShader
+#define glBeginQuery capture_glBeginQuery
+#define glBindBuffer capture_glBindBuffer
+#define glBindBufferBase capture_glBindBufferBase
+#define glBindFramebuffer capture_glBindFramebuffer
+#define glBindTexture capture_glBindTexture
+#define glBindVertexArray capture_glBindVertexArray
+#define glBlendEquation capture_glBlendEquation
+#define glBlendFunc capture_glBlendFunc
+#define glBufferData capture_glBufferData
+#define glBufferStorage capture_glBufferStorage
+#define glBufferSubData capture_glBufferSubData
+#define glClear capture_glClear
+#define glClearBufferfv capture_glClearBufferfv
+#define glClearColor capture_glClearColor
+#define glClientWaitSync capture_glClientWaitSync
+#define glCompileShader capture_glCompileShader
+#define glCreateProgram capture_glCreateProgram
+#define glCreateShader capture_glCreateShader
+#define glDeleteBuffers capture_glDeleteBuffers
+#define glDeleteProgram capture_glDeleteProgram
+#define glDeleteQueries capture_glDeleteQueries
+#define glDeleteShader capture_glDeleteShader
+#define glDeleteSync capture_glDeleteSync
+#define glDeleteTextures capture_glDeleteTextures
+#define glDisable capture_glDisable
+#define glDrawArrays capture_glDrawArrays
+#define glDrawArraysInstanced capture_glDrawArraysInstanced
+#define glDrawBuffers capture_glDrawBuffers
+#define glDrawElements capture_glDrawElements
+#define glDrawElementsInstanced capture_glDrawElementsInstanced
+#define glEnable capture_glEnable
+#define glEnableVertexAttribArray capture_glEnableVertexAttribArray
+#define glEndQuery capture_glEndQuery
+#define glFenceSync capture_glFenceSync
+#define glFinish capture_glFinish
+#define glFramebufferTexture2D capture_glFramebufferTexture2D
+#define glGenBuffers capture_glGenBuffers
+#define glGenFramebuffers capture_glGenFramebuffers
+#define glGenQueries capture_glGenQueries
+#define glGenTextures capture_glGenTextures
+#define glGenVertexArrays capture_glGenVertexArrays
+#define glGenerateMipmap capture_glGenerateMipmap
+#define glGetBufferSubData capture_glGetBufferSubData
+#define glGetQueryObjectiv capture_glGetQueryObjectiv
+#define glGetQueryObjectui64v capture_glGetQueryObjectui64v
+#define glGetTexImage capture_glGetTexImage
+#define glGetUniformBlockIndex capture_glGetUniformBlockIndex
+#define glGetUniformLocation capture_glGetUniformLocation
+#define glLinkProgram capture_glLinkProgram
+#define glMapBufferRange capture_glMapBufferRange
+#define glMultiDrawArraysIndirect capture_glMultiDrawArraysIndirect
+#define glMultiDrawElementsIndirect capture_glMultiDrawElementsIndirect
+#define glPixelStorei capture_glPixelStorei
+#define glReadPixels capture_glReadPixels
+#define glShaderSource capture_glShaderSource
+#define glTexBuffer capture_glTexBuffer
+#define glTexImage2D capture_glTexImage2D
+#define glTexParameteri capture_glTexParameteri
+#define glTexSubImage2D capture_glTexSubImage2D
+#define glUniform1f capture_glUniform1f
+#define glUniform1fv capture_glUniform1fv
+#define glUniform2f capture_glUniform2f
+#define glUniform1i capture_glUniform1i
+#define glUniform4fv capture_glUniform4fv
+#define glUniformBlockBinding capture_glUniformBlockBinding
+#define glUniformMatrix3fv capture_glUniformMatrix3fv
+#define glUniformMatrix4fv capture_glUniformMatrix4fv
+#define glUniformMatrix4x3fv capture_glUniformMatrix4x3fv
+#define glUnmapBuffer capture_glUnmapBuffer
+#define glUseProgram capture_glUseProgram
+#define glVertexAttribDivisor capture_glVertexAttribDivisor
+#define glVertexAttribIPointer capture_glVertexAttribIPointer
+#define glVertexAttribPointer capture_glVertexAttribPointer
+#define glViewport capture_glViewport
+
+#endif //GL_CAPTURE && !GL_CAPTURE_NO_WRAPPERS
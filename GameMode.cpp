@@ -3,6 +3,7 @@
 #include "MenuMode.hpp"
 #include "Load.hpp"
 #include "MeshBuffer.hpp"
+#include "Pack.hpp" //assets, from assets.pack or loose files
 #include "Scene.hpp"
 #include "gl_errors.hpp" //helper for dumpping OpenGL error messages
 #include "check_fb.hpp" //helper for checking currently bound OpenGL framebuffer
@@ -11,13 +12,20 @@
 #include "compile_program.hpp" //helper to compile opengl shader programs
 #include "draw_text.hpp" //helper to... um.. draw text
 #include "load_save_png.hpp"
+#include "load_texture.hpp"
 #include "scene_program.hpp"
 #include "depth_program.hpp"
 #include "mrt_blur_program.hpp"
 #include "surface_program.hpp"
 #include "stylize_program.hpp"
+#include "downsample_program.hpp"
 #include "http-tweak/tweak.hpp"
 #include "parameters.hpp"
+#include "Profiler.hpp"
+#include "Resources.hpp"
+#include "MappedFile.hpp"
+#include "DynamicResolution.hpp"
+#include "JobSystem.hpp"
 
 #include <glm/gtc/type_ptr.hpp>
 
@@ -26,26 +34,35 @@
 #include <map>
 #include <cstddef>
 #include <random>
-#include <png.h>
 #include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <array>
+#include <functional>
 
 #ifndef TWEAK_ENABLE
 #error "http-tweak not enabled"
 #endif
 
 std::string file = "test";
-Load< MeshBuffer > meshes(LoadTagDefault, [](){
-	return new MeshBuffer(data_path(file+".pgct"));
+Load< MeshBuffer > meshes(LoadTagDefault, "meshes", {}, [](){
+	//map and read the file off the main thread:
+	Asset asset = open_asset(file+".pgct");
+	asset.touch();
+	return asset;
+}, [](Asset &asset){
+	return new MeshBuffer(asset);
 });
-Load< GLuint > meshes_for_scene_program(LoadTagDefault, [](){
+Load< GLuint > meshes_for_scene_program(LoadTagDefault, "meshes_for_scene_program", {meshes, scene_program}, [](){
 	return new GLuint(meshes->make_vao_for_program(scene_program->program));
 });
-Load< GLuint > meshes_for_depth_program(LoadTagDefault, [](){
+Load< GLuint > meshes_for_depth_program(LoadTagDefault, "meshes_for_depth_program", {meshes, depth_program}, [](){
 	return new GLuint(meshes->make_vao_for_program(depth_program->program));
 });
 
 //used for fullscreen passes:
-Load< GLuint > empty_vao(LoadTagDefault, [](){
+Load< GLuint > empty_vao(LoadTagDefault, "empty_vao", {}, [](){
 	GLuint vao = 0;
 	glGenVertexArrays(1, &vao);
 	glBindVertexArray(vao);
@@ -53,7 +70,7 @@ Load< GLuint > empty_vao(LoadTagDefault, [](){
 	return new GLuint(vao);
 });
 
-Load< GLuint > copy_program(LoadTagDefault, [](){
+Load< GLuint > copy_program(LoadTagDefault, "copy_program", {}, [](){
 	GLuint program = compile_program(
 		//this draws a triangle that covers the entire screen:
 		"#version 330\n"
@@ -69,15 +86,32 @@ Load< GLuint > copy_program(LoadTagDefault, [](){
 
 		"#version 330\n"
 		"uniform sampler2D tex;\n"
+		//when the frame was rendered smaller (see DynamicResolution), only [0,region) of tex holds it:
+		"uniform vec2 scale; //render pixels per screen pixel\n"
+		"uniform vec2 region;\n"
 		"out vec4 fragColor;\n"
 		"void main() {\n"
-		"	fragColor = texelFetch(tex, ivec2(gl_FragCoord.xy), 0);\n"
+		"	if (scale == vec2(1.0)) {\n"
+		"		fragColor = texelFetch(tex, ivec2(gl_FragCoord.xy), 0);\n"
+		"		return;\n"
+		"	}\n"
+		//bilinear upscale, by hand, so samples are clamped to the region (and targets can stay GL_NEAREST):
+		"	vec2 at = gl_FragCoord.xy * scale - 0.5;\n"
+		"	ivec2 i = ivec2(floor(at));\n"
+		"	vec2 f = at - floor(at);\n"
+		"	ivec2 hi = ivec2(region) - 1;\n"
+		"	vec4 a = texelFetch(tex, clamp(i, ivec2(0), hi), 0);\n"
+		"	vec4 b = texelFetch(tex, clamp(i + ivec2(1,0), ivec2(0), hi), 0);\n"
+		"	vec4 c = texelFetch(tex, clamp(i + ivec2(0,1), ivec2(0), hi), 0);\n"
+		"	vec4 d = texelFetch(tex, clamp(i + ivec2(1,1), ivec2(0), hi), 0);\n"
+		"	fragColor = mix(mix(a, b, f.x), mix(c, d, f.x), f.y);\n"
 		"}\n"
 	);
 
 	glUseProgram(program);
 
 	glUniform1i(glGetUniformLocation(program, "tex"), 0);
+	glUniform2f(glGetUniformLocation(program, "scale"), 1.0f, 1.0f);
 
 	glUseProgram(0);
 
@@ -85,37 +119,27 @@ Load< GLuint > copy_program(LoadTagDefault, [](){
 });
 
 
-GLuint load_texture(std::string const &filename) {
-	glm::uvec2 size;
-	std::vector< glm::u8vec4 > data;
-	load_png(filename, &size, &data, LowerLeftOrigin);
-
-	GLuint tex = 0;
-	glGenTextures(1, &tex);
-	glBindTexture(GL_TEXTURE_2D, tex);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, size.x, size.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, data.data());
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-	glGenerateMipmap(GL_TEXTURE_2D);
-	glBindTexture(GL_TEXTURE_2D, 0);
-	GL_ERRORS();
-
-	return tex;
-}
+//textures are read (CPU stage) and then uploaded (GL stage); see load_texture.hpp:
 
 //texture for the platform in the test scene
-Load< GLuint > grid_tex(LoadTagDefault, [](){
-	return new GLuint(load_texture(data_path("textures/grid.png")));
+Load< GLuint > grid_tex(LoadTagDefault, "grid_tex", {}, [](){
+	return load_texture_data("textures/grid");
+}, [](TextureData &data){
+	GLuint tex = upload_texture(data);
+	Resources::track_texture(tex, "GameMode", "grid_tex");
+	return new GLuint(tex);
 });
 
 //watercolor paper texture
-Load< GLuint > paper_tex(LoadTagDefault, [](){
-	return new GLuint(load_texture(data_path("textures/paper.png")));
+Load< GLuint > paper_tex(LoadTagDefault, "paper_tex", {}, [](){
+	return load_texture_data("textures/paper");
+}, [](TextureData &data){
+	GLuint tex = upload_texture(data);
+	Resources::track_texture(tex, "GameMode", "paper_tex");
+	return new GLuint(tex);
 });
 
-Load< GLuint > white_tex(LoadTagDefault, [](){
+Load< GLuint > white_tex(LoadTagDefault, "white_tex", {}, [](){
 	GLuint tex = 0;
 	glGenTextures(1, &tex);
 	glBindTexture(GL_TEXTURE_2D, tex);
@@ -126,6 +150,7 @@ Load< GLuint > white_tex(LoadTagDefault, [](){
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 	glBindTexture(GL_TEXTURE_2D, 0);
+	Resources::track_texture(tex, "GameMode", "white_tex");
 
 	return new GLuint(tex);
 });
@@ -148,6 +173,16 @@ enum Stages{
 //Other globals
 bool surfaced = false; //so surface shader is only called once and when resizing
 bool pic_mode = false;
+std::string timers_csv; //if set, per-pass timings are logged here (see PassTimers)
+float frame_budget_ms = 0.0f; //if set, render resolution drops to keep GPU frame time under this (see DynamicResolution)
+uint32_t ssaa = 1; //passes render at this multiple of the output size, which read_screen() filters down
+bool ssaa_lanczos = false; //filter for that: Lanczos-3 if set, else box
+glm::uvec2 poster_size = glm::uvec2(0,0); //if set, pic_mode renders a picture this big, in tiles (see write_tiled_png)
+uint32_t poster_tile = 1024; //size of those tiles, not counting their aprons
+glm::vec2 sequence_range = glm::vec2(0.0f); //if end > start, renders frames over [start,end) of elapsed time and quits (see write_sequence)
+float sequence_fps = 24.0f; //frames per second of elapsed time, for that
+std::string sequence_out; //"-": Y4M on stdout; "*.y4m": a Y4M file; else PNGs named this-00000.png, ... (default: renders/filename)
+std::string trace_json = "trace.json"; //where 'P' (and exit, if recording) writes profiler zones
 int width, height;
 GLuint screen_tex;
 
@@ -175,16 +210,35 @@ float w19[19] = {0.046142f, 0.045858f, 0.045018f, 0.043651f, 0.041807f, 0.03955f
 float w20[20] = {0.042028f, 0.041819f, 0.041197f, 0.040181f, 0.0388f, 0.037094f, 0.03511f, 0.032903f, 0.030527f, 0.028041f, 0.025502f, 0.022962f, 0.02047f, 0.018066f, 0.015787f, 0.013657f, 0.011698f, 0.00992f, 0.008329f, 0.006923f};
 float* weight_arrays[] = {w1, w2, w3, w4, w5, w6, w7, w8, w9, w10, w11, w12, w13, w14, w15, w16, w17, w18, w19,w20};
 
+//mesh each scene object draws (so objects can be re-pointed when the mesh file is reloaded):
+std::map< Scene::Object *, std::string > object_meshes;
+
+static void set_object_mesh(Scene::Object *obj, std::string const &m) {
+	MeshBuffer::Mesh const &mesh = meshes->lookup(m);
+	for (auto type : {Scene::Object::ProgramTypeDefault, Scene::Object::ProgramTypeShadow}) {
+		obj->programs[type].start = mesh.start;
+		obj->programs[type].count = mesh.count;
+		obj->programs[type].index_type = meshes->index_type;
+		obj->programs[type].position_offset = mesh.position_offset;
+		obj->programs[type].position_scale = mesh.position_scale;
+	}
+	object_meshes[obj] = m;
+}
+
 //Initial scene loading setup stuff
-Load< Scene > scene(LoadTagDefault, [](){
+Load< Scene > scene(LoadTagDefault, "scene", {meshes, meshes_for_scene_program, meshes_for_depth_program, scene_program, depth_program, grid_tex, white_tex}, [](){
 	Scene *ret = new Scene;
 	//pre-build some program info (material) blocks to assign to each object:
 	Scene::Object::ProgramInfo scene_program_info;
 	scene_program_info.program = scene_program->program;
 	scene_program_info.vao = *meshes_for_scene_program;
-	scene_program_info.mvp_mat4  = scene_program->object_to_clip_mat4;
-	scene_program_info.mv_mat4x3 = scene_program->object_to_light_mat4x3;
-	scene_program_info.itmv_mat3 = scene_program->normal_to_light_mat3;
+	scene_program_info.instance_base_int = scene_program->instance_base_int;
+	scene_program_info.object_index_attrib = scene_program->object_index_attrib;
+
+	//quantized meshes need their normals decoded in the vertex shader:
+	glUseProgram(scene_program->program);
+	glUniform1i(scene_program->octahedral_normals_bool, meshes->quantized ? GL_TRUE : GL_FALSE);
+	glUseProgram(0);
 
 	Scene::Object::ProgramInfo depth_program_info;
 	depth_program_info.program = depth_program->program;
@@ -192,7 +246,7 @@ Load< Scene > scene(LoadTagDefault, [](){
 	depth_program_info.mvp_mat4  = depth_program->object_to_clip_mat4;
 
 	//load transform hierarchy:
-	ret->load(data_path(file+".scene"), [&](Scene &s, Scene::Transform *t, std::string const &m){
+	ret->load(open_asset(file+".scene"), [&](Scene &s, Scene::Transform *t, std::string const &m){
 		Scene::Object *obj = s.new_object(t);
 
 		obj->programs[Scene::Object::ProgramTypeDefault] = scene_program_info;
@@ -204,12 +258,7 @@ Load< Scene > scene(LoadTagDefault, [](){
 
 		obj->programs[Scene::Object::ProgramTypeShadow] = depth_program_info;
 
-		MeshBuffer::Mesh const &mesh = meshes->lookup(m);
-		obj->programs[Scene::Object::ProgramTypeDefault].start = mesh.start;
-		obj->programs[Scene::Object::ProgramTypeDefault].count = mesh.count;
-
-		obj->programs[Scene::Object::ProgramTypeShadow].start = mesh.start;
-		obj->programs[Scene::Object::ProgramTypeShadow].count = mesh.count;
+		set_object_mesh(obj, m);
 	});
 
 	//look up camera parent transform:
@@ -250,9 +299,26 @@ Load< Scene > scene(LoadTagDefault, [](){
 });
 
 GameMode::GameMode() {
+	if (!timers_csv.empty()) timers.log_to(timers_csv);
+	resolution.budget_ms = frame_budget_ms;
+
+	//edits to these (e.g., re-exporting from blender, re-baking a texture) show up without a restart:
+	// (the loose files are watched, even when a pack is mounted)
+	watcher.watch(data_path(file + ".pgct"));
+	watcher.watch(data_path(file + ".scene"));
+	for (std::string name : {"textures/grid", "textures/paper"}) {
+		watcher.watch(data_path(name + ".png"));
+		watcher.watch(data_path(name + ".tex"));
+	}
+
+	if (Pack const *pack = mounted_pack()) {
+		Resources::track_host(pack, pack->file->size, "Pack", pack->filename + " (mapped)");
+	}
 }
 
 GameMode::~GameMode() {
+	timers.report(std::cout);
+	Resources::report(std::cout);
 }
 
 bool GameMode::handle_event(SDL_Event const &evt, glm::uvec2 const &window_size) {
@@ -284,6 +350,16 @@ bool GameMode::handle_event(SDL_Event const &evt, glm::uvec2 const &window_size)
         }else if(evt.key.keysym.scancode == SDL_SCANCODE_D){
             glm::vec3 step = 0.5f * directions[0];
             camera->transform->position+=step;
+        }else if(evt.key.keysym.scancode == SDL_SCANCODE_T){
+            show_timers = !show_timers;
+        }else if(evt.key.keysym.scancode == SDL_SCANCODE_P){
+            //first press starts recording CPU zones, later presses write what has been recorded so far:
+            if(!Profiler::recording()){
+                Profiler::set_recording(true);
+                std::cout<<"Recording profiler zones; press P again to write '"<<trace_json<<"'."<<std::endl;
+            }else{
+                Profiler::write_trace(trace_json);
+            }
         }
 
 
@@ -310,51 +386,95 @@ bool GameMode::handle_event(SDL_Event const &evt, glm::uvec2 const &window_size)
 	return false;
 }
 
-void GameMode::write_png(const char *filename){
-    FILE *output = fopen(filename, "wb");
-    if(!output) return;
-    png_structp png = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
-    if (!png) return;
-    png_infop info = png_create_info_struct(png);
-    if(!info) return;
-    if(setjmp(png_jmpbuf(png))) return;
-    png_init_io(png, output);
-    png_set_IHDR(png, info, width, height, 8,
-            PNG_COLOR_TYPE_RGBA, PNG_INTERLACE_NONE,
-            PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
-    png_write_info(png, info);
+void GameMode::reload(std::string const &path) {
+	auto ends_with = [&path](std::string const &suffix) {
+		return path.size() >= suffix.size() && path.substr(path.size() - suffix.size()) == suffix;
+	};
 
-    glBindTexture(GL_TEXTURE_2D, screen_tex);
-    std::vector<GLfloat> pixels(width*height*4, 0.0f);
-    glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_FLOAT, pixels.data());
-    png_bytep row = (png_bytep)malloc(sizeof(png_byte)*width*4);
-    for(int y = height-1; y >= 0; y--) {
-        for(int x = 0; x<width; x++){
-            row[x*4] = glm::clamp(int32_t(pixels[(x+y*width)*4]*255), 0, 255);
-            row[x*4+1] = glm::clamp(int32_t(pixels[(x+y*width)*4+1]*255), 0, 255);
-            row[x*4+2] = glm::clamp(int32_t(pixels[(x+y*width)*4+2]*255), 0, 255);
-            row[x*4+3] = glm::clamp(int32_t(pixels[(x+y*width)*4+3]*255), 0, 255);
-        }
-        png_write_row(png, row);
-    }
-    png_write_end(png, NULL);
-
-    free(row);
-    fclose(output);
-    std::cout<<"done writing out to "<<filename<<std::endl;
+	if (ends_with(".pgct")) {
+		//changed blocks go into the same buffers, so vaos stay valid; objects are re-pointed at their (maybe moved) meshes:
+		size_t uploaded = const_cast< MeshBuffer & >(*meshes).reload(open_file_asset(path));
+		for (auto const &om : object_meshes) {
+			set_object_mesh(om.first, om.second);
+		}
+		std::cout << "Reloaded '" << path << "' (" << uploaded << " bytes uploaded)." << std::endl;
+
+	} else if (ends_with(".scene")) {
+		//read the new file into a scratch scene, then copy what changed onto the matching (by name) transforms:
+		Scene fresh;
+		std::map< std::string, std::string > fresh_meshes; //transform name -> mesh name
+		fresh.load(open_file_asset(path), [&](Scene &, Scene::Transform *t, std::string const &m){
+			fresh_meshes[t->name] = m;
+		});
+		std::map< std::string, Scene::Transform * > fresh_transforms;
+		for (Scene::Transform *t = fresh.first_transform; t != nullptr; t = t->alloc_next) {
+			fresh_transforms[t->name] = t;
+		}
+		uint32_t missing = 0;
+		for (Scene::Transform *t = scene->first_transform; t != nullptr; t = t->alloc_next) {
+			auto f = fresh_transforms.find(t->name);
+			if (f == fresh_transforms.end()) {
+				++missing;
+				continue;
+			}
+			Scene::Transform const *from = f->second;
+			fresh_transforms.erase(f);
+			if (t == camera_parent_transform || t == camera->transform) continue; //(being flown around)
+			t->position = from->position;
+			t->rotation = from->rotation;
+			t->scale = from->scale;
+		}
+		for (Scene::Object *obj = scene->first_object; obj != nullptr; obj = obj->alloc_next) {
+			auto f = fresh_meshes.find(obj->transform->name);
+			if (f != fresh_meshes.end() && f->second != object_meshes[obj]) {
+				set_object_mesh(obj, f->second);
+			}
+		}
+		//(new transforms would need new objects and programs set up; that's a restart)
+		if (missing || !fresh_transforms.empty()) {
+			std::cerr << "WARNING: '" << path << "' added or removed transforms; restart to see those." << std::endl;
+		}
+		std::cout << "Reloaded '" << path << "'." << std::endl;
+
+	} else if (path.find("textures/grid.") != std::string::npos || path.find("textures/paper.") != std::string::npos) {
+		bool paper = (path.find("textures/paper.") != std::string::npos);
+		GLuint tex = (paper ? *paper_tex : *grid_tex);
+		std::vector< char > &shadow = texture_shadows[tex];
+		size_t uploaded = reload_texture(tex, load_texture_data(open_file_asset(path)), &shadow);
+		Resources::track_texture(tex, "GameMode", paper ? "paper_tex" : "grid_tex"); //(size may have changed)
+		Resources::track_host(&shadow, shadow.size(), "GameMode", paper ? "paper_tex reload copy" : "grid_tex reload copy");
+		if (paper) surfaced = false; //the surface pass reads the paper texture
+		std::cout << "Reloaded '" << path << "' (" << uploaded << " bytes uploaded)." << std::endl;
+	}
 }
 
 void GameMode::update(float elapsed) {
+	for (auto const &path : watcher.poll()) {
+		//a bad file (e.g., half-exported) is reported and the old data kept:
+		try {
+			reload(path);
+		} catch (std::exception const &e) {
+			std::cerr << "WARNING: failed to reload '" << path << "': " << e.what() << std::endl;
+		}
+	}
+
 	camera_parent_transform->rotation = glm::normalize(camera_rot);
         //glm::angleAxis(camera_spin, glm::vec3(0.0f, 0.0f, 1.0f));
     Parameters::elapsed_time+=elapsed;
-    TWEAK_SYNC();
+    {
+        PROFILE_ZONE("TWEAK_SYNC");
+        TWEAK_SYNC();
+    }
 }
 
 //GameMode will render to some offscreen framebuffer(s).
 //This code allocates and resizes them as needed:
 struct Textures {
 	glm::uvec2 size = glm::uvec2(0,0); //remember the size of the framebuffer
+	glm::uvec2 region = glm::uvec2(0,0); //passes render to [0,region) (smaller than size when scaled; see DynamicResolution)
+	glm::uvec2 output = glm::uvec2(0,0); //size of the picture being made (size is a multiple of this when supersampling)
+	//rendered pixels per output pixel (radii and the like that are in output pixels get multiplied by this):
+	glm::vec2 scale() const { return glm::vec2(region) / glm::vec2(output); }
 
     GLuint control_tex = 0;
 	GLuint color_tex = 0;
@@ -375,7 +495,7 @@ struct Textures {
             width = size.x;
             height = size.y;
             surfaced = false;
-            auto alloc_tex = [this](GLuint *tex, GLint internalformat, GLint format){
+            auto alloc_tex = [this](GLuint *tex, GLint internalformat, GLint format, char const *purpose){
                 if (*tex == 0) glGenTextures(1, tex);
 	    		glBindTexture(GL_TEXTURE_2D, *tex);
 		    	glTexImage2D(GL_TEXTURE_2D, 0, internalformat, size.x,
@@ -385,25 +505,189 @@ struct Textures {
 	    		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
 		    	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 			    glBindTexture(GL_TEXTURE_2D, 0);
+                Resources::track_texture(*tex, "Textures", purpose);
             };
 
-            alloc_tex(&control_tex, GL_RGBA32F, GL_RGBA);
-            alloc_tex(&color_tex, GL_RGBA8, GL_RGBA);
-            alloc_tex(&depth_tex, GL_DEPTH_COMPONENT24, GL_DEPTH_COMPONENT);
-            alloc_tex(&blurred_tex, GL_RGBA32F, GL_RGBA);
-            alloc_tex(&blur_temp_tex, GL_RGBA32F, GL_RGBA);
-            alloc_tex(&bleed_temp_tex, GL_RGBA32F, GL_RGBA);
-            alloc_tex(&control_temp_tex, GL_RGBA32F, GL_RGBA);
-            alloc_tex(&final_control_tex, GL_RGBA32F, GL_RGBA);
-            alloc_tex(&bleeded_tex, GL_RGBA32F, GL_RGBA);
-            alloc_tex(&surface_tex, GL_RGBA8, GL_RGBA);
-            alloc_tex(&final_tex, GL_RGBA8, GL_RGBA);
+            alloc_tex(&control_tex, GL_RGBA32F, GL_RGBA, "control_tex");
+            alloc_tex(&color_tex, GL_RGBA8, GL_RGBA, "color_tex");
+            alloc_tex(&depth_tex, GL_DEPTH_COMPONENT24, GL_DEPTH_COMPONENT, "depth_tex");
+            alloc_tex(&blurred_tex, GL_RGBA32F, GL_RGBA, "blurred_tex");
+            alloc_tex(&blur_temp_tex, GL_RGBA32F, GL_RGBA, "blur_temp_tex");
+            alloc_tex(&bleed_temp_tex, GL_RGBA32F, GL_RGBA, "bleed_temp_tex");
+            alloc_tex(&control_temp_tex, GL_RGBA32F, GL_RGBA, "control_temp_tex");
+            alloc_tex(&final_control_tex, GL_RGBA32F, GL_RGBA, "final_control_tex");
+            alloc_tex(&bleeded_tex, GL_RGBA32F, GL_RGBA, "bleeded_tex");
+            alloc_tex(&surface_tex, GL_RGBA8, GL_RGBA, "surface_tex");
+            alloc_tex(&final_tex, GL_RGBA8, GL_RGBA, "final_tex");
 			GL_ERRORS();
 		}
 
 	}
 } textures;
 
+//when a picture is drawn in tiles (see write_tiled_png), the textures hold a window into it:
+struct Tile {
+	glm::uvec2 picture = glm::uvec2(0,0); //size of the whole picture, in output pixels (0,0 when not tiling)
+	glm::ivec2 origin = glm::ivec2(0,0); //output pixel of the picture at the lower left of the textures
+	//size of the whole picture (or, when not tiling, of the textures):
+	glm::uvec2 view() const { return (picture == glm::uvec2(0,0) ? textures.output : picture); }
+} tile;
+
+//supersampling factor for an output of 'size': 'ssaa', lowered until the targets fit in a texture
+static uint32_t supersample_for(glm::uvec2 const &size){
+    GLint max_size = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_size);
+    uint32_t factor = glm::clamp(ssaa, 1U, 4U);
+    while(factor > 1 && std::max(size.x, size.y) * factor > uint32_t(max_size)) factor -= 1;
+    if(factor != ssaa){
+        std::cerr << "WARNING: supersampling " << size.x << "x" << size.y << " at " << factor << "x, not "
+            << ssaa << "x (limit is 4x, and " << max_size << " pixels per side)." << std::endl;
+    }
+    return factor;
+}
+
+//textures for downsample(), below:
+static GLuint alloc_downsample_tex(GLint internalformat, glm::uvec2 const &size, char const *purpose){
+    GLuint tex = 0;
+    glGenTextures(1, &tex);
+    glBindTexture(GL_TEXTURE_2D, tex);
+    glTexImage2D(GL_TEXTURE_2D, 0, internalformat, size.x, size.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    Resources::track_texture(tex, "downsample", purpose);
+    return tex;
+}
+
+static void free_downsample_tex(GLuint *tex){
+    Resources::forget_texture(*tex);
+    glDeleteTextures(1, tex);
+    *tex = 0;
+}
+
+//filters [0,from) of 'tex' down to 'to' on the GPU, separably: x into 'narrowed_tex' (to.x by from.y, float,
+//so Lanczos overshoot survives to the second pass), then y into 'out_tex' (to, RGBA8)
+static void downsample(GLuint tex, glm::uvec2 const &from, glm::uvec2 const &to, GLuint narrowed_tex, GLuint out_tex){
+    static GLuint fb = 0;
+    if(fb==0) glGenFramebuffers(1, &fb);
+    glBindFramebuffer(GL_FRAMEBUFFER, fb);
+    GLenum bufs[1] = {GL_COLOR_ATTACHMENT0};
+    glDrawBuffers(1, bufs);
+    glDisable(GL_BLEND);
+    glDisable(GL_DEPTH_TEST);
+    glUseProgram(downsample_program->program);
+    glUniform1i(downsample_program->lanczos, ssaa_lanczos ? 1 : 0);
+    glBindVertexArray(*empty_vao);
+    glActiveTexture(GL_TEXTURE0);
+
+    auto pass = [&](GLuint src, GLuint dst, glm::uvec2 const &dst_size, int axis){
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, dst, 0);
+        check_fb();
+        glViewport(0, 0, dst_size.x, dst_size.y);
+        glBindTexture(GL_TEXTURE_2D, src);
+        glUniform2f(downsample_program->axis, axis == 0 ? 1.0f : 0.0f, axis == 1 ? 1.0f : 0.0f);
+        glUniform1f(downsample_program->factor, from[axis] / float(to[axis]));
+        glUniform1i(downsample_program->source_size, int(from[axis]));
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+    };
+    pass(tex, narrowed_tex, glm::uvec2(to.x, from.y), 0);
+    pass(narrowed_tex, out_tex, to, 1);
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindVertexArray(0);
+    glUseProgram(0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+//downsample()s 'tex' and reads back only the result -- so a supersampled render never has to be
+//copied off the GPU at full size
+static void read_downsampled(GLuint tex, glm::uvec2 const &from, glm::uvec2 const &to,
+        std::vector< glm::u8vec4 > *data_){
+    PROFILE_ZONE("read_downsampled");
+    assert(data_);
+    auto &data = *data_;
+
+    GLuint narrowed_tex = alloc_downsample_tex(GL_RGBA32F, glm::uvec2(to.x, from.y), "narrowed_tex");
+    GLuint out_tex = alloc_downsample_tex(GL_RGBA8, to, "out_tex");
+    downsample(tex, from, to, narrowed_tex, out_tex);
+
+    glBindTexture(GL_TEXTURE_2D, out_tex);
+    data.resize(to.x * to.y);
+    glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, data.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    free_downsample_tex(&narrowed_tex);
+    free_downsample_tex(&out_tex);
+    GL_ERRORS();
+}
+
+//a Y4M frame (header, then 4:2:0 planes, BT.601 studio range) of 'size' pixels with lower-left origin:
+static void encode_y4m_frame(glm::uvec2 const &size, glm::u8vec4 const *pixels, std::vector< uint8_t > *out_){
+    assert(out_);
+    auto &out = *out_;
+    glm::uvec2 half = (size + glm::uvec2(1)) / 2U;
+    char const header[] = "FRAME\n";
+    size_t header_size = sizeof(header) - 1;
+    out.resize(header_size + size.x * size.y + 2 * half.x * half.y);
+    std::memcpy(out.data(), header, header_size);
+    uint8_t *y_plane = out.data() + header_size;
+    uint8_t *u_plane = y_plane + size.x * size.y;
+    uint8_t *v_plane = u_plane + half.x * half.y;
+    //(Y4M rows go top to bottom)
+    auto at = [&](uint32_t x, uint32_t y) -> glm::vec3 {
+        x = std::min(x, size.x - 1);
+        y = std::min(y, size.y - 1);
+        return glm::vec3(pixels[(size.y - 1 - y) * size.x + x]);
+    };
+    for(uint32_t y = 0; y < size.y; ++y){
+        for(uint32_t x = 0; x < size.x; ++x){
+            glm::vec3 c = at(x, y);
+            y_plane[y * size.x + x] = uint8_t(16.5f + 0.256788f * c.r + 0.504129f * c.g + 0.097906f * c.b);
+        }
+    }
+    //(chroma from the average of each 2x2 block; JPEG siting)
+    for(uint32_t y = 0; y < half.y; ++y){
+        for(uint32_t x = 0; x < half.x; ++x){
+            glm::vec3 c = 0.25f * (at(2*x, 2*y) + at(2*x+1, 2*y) + at(2*x, 2*y+1) + at(2*x+1, 2*y+1));
+            u_plane[y * half.x + x] = uint8_t(128.5f - 0.148223f * c.r - 0.290993f * c.g + 0.439216f * c.b);
+            v_plane[y * half.x + x] = uint8_t(128.5f + 0.439216f * c.r - 0.367788f * c.g - 0.071427f * c.b);
+        }
+    }
+}
+
+void GameMode::write_png(const char *filename){
+    PROFILE_ZONE("GameMode::write_png");
+    glm::uvec2 size;
+    std::vector< glm::u8vec4 > pixels;
+    read_screen(&size, &pixels);
+    save_png(filename, size, pixels.data(), LowerLeftOrigin);
+    std::cout<<"done writing out to "<<filename<<std::endl;
+}
+
+void GameMode::read_screen(glm::uvec2 *size_, std::vector< glm::u8vec4 > *data_){
+    assert(size_);
+    assert(data_);
+    auto &size = *size_;
+    auto &data = *data_;
+    if(supersample > 1){
+        read_downsampled(screen_tex, textures.region, textures.output, &data);
+        size = textures.output;
+        return;
+    }
+    size = glm::uvec2(width, height);
+
+    glBindTexture(GL_TEXTURE_2D, screen_tex);
+    std::vector<GLfloat> pixels(width*height*4, 0.0f);
+    glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_FLOAT, pixels.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
+    data.resize(width*height);
+    for(size_t i = 0; i<data.size(); i++){
+        for(int c = 0; c<4; c++){
+            data[i][c] = glm::clamp(int32_t(pixels[i*4+c]*255), 0, 255);
+        }
+    }
+}
+
 //renders the color texture, control texture, and depth buffer.
 void GameMode::draw_scene(GLuint* color_tex_, GLuint* control_tex_,
                         GLuint* depth_tex_){
@@ -446,8 +730,13 @@ void GameMode::draw_scene(GLuint* color_tex_, GLuint* control_tex_,
 
 	//Draw scene to off-screen framebuffer:
 	glBindFramebuffer(GL_FRAMEBUFFER, fb);
-	glViewport(0,0, textures.size.x, textures.size.y);
-	camera->aspect = textures.size.x / float(textures.size.y);
+	glViewport(0,0, textures.region.x, textures.region.y);
+    glm::vec2 view = glm::vec2(tile.view());
+	camera->aspect = view.x / view.y;
+    //(the part of the view the textures hold; all of it unless tiling)
+    glm::vec2 lo = glm::vec2(tile.origin) / view * 2.0f - 1.0f;
+    glm::vec2 hi = glm::vec2(tile.origin + glm::ivec2(textures.output)) / view * 2.0f - 1.0f;
+    camera->window = glm::vec4(lo, hi);
 
     GLfloat white[4] = {1.0f, 1.0f, 1.0f, 1.0f};
     GLfloat black[4] = {0.0f, 0.5f, 0.0f, 0.0f};
@@ -463,22 +752,27 @@ void GameMode::draw_scene(GLuint* color_tex_, GLuint* control_tex_,
 
 	glUseProgram(scene_program->program);
 
-	glUniform3fv(scene_program->sun_color_vec3, 1, glm::value_ptr(glm::vec3(0.5f, 0.5f, 0.5f)));
-	glUniform3fv(scene_program->sun_direction_vec3, 1, glm::value_ptr(glm::normalize(glm::vec3(0.5f, 0.3f, 1.f))));
-	glUniform3fv(scene_program->sky_color_vec3, 1, glm::value_ptr(glm::vec3(0.2f, 0.2f, 0.2f)));
-	glUniform3fv(scene_program->sky_direction_vec3, 1, glm::value_ptr(glm::vec3(0.0f, 0.0f, 1.0f)));
-    glUniform1f(scene_program->time, Parameters::elapsed_time);
-    glUniform1f(scene_program->speed,  Parameters::speed);
-    glUniform1f(scene_program->frequency,  Parameters::frequency);
-    glUniform1f(scene_program->tremor_amount,  Parameters::tremor_amount);
+	SceneProgram::Frame frame;
+	frame.sun_color = glm::vec3(0.5f, 0.5f, 0.5f);
+	frame.sun_direction = glm::normalize(glm::vec3(0.5f, 0.3f, 1.f));
+	frame.sky_color = glm::vec3(0.2f, 0.2f, 0.2f);
+	frame.sky_direction = glm::vec3(0.0f, 0.0f, 1.0f);
+    frame.time = Parameters::elapsed_time;
+    frame.speed = Parameters::speed;
+    frame.frequency = Parameters::frequency;
+    frame.tremor_amount = Parameters::tremor_amount;
     //view coords go from -1 to 1, so thats 2.0/# of pixels
-    glUniform2fv(scene_program->clip_units_per_pixel, 1,
-        glm::value_ptr(glm::vec2(2.f/textures.size.x, 2.f/textures.size.y)));
-    glUniform3fv(scene_program->viewPos, 1,
-            glm::value_ptr(camera->transform->make_local_to_world()));
-    glUniform1f(scene_program->dA, Parameters::dA);
-    glUniform1f(scene_program->cangiante_variable, Parameters::cangiante_variable);
-    glUniform1f(scene_program->dilution_variable,Parameters::dilution_variable);
+    // (output pixels, not rendered ones, so tremors are the same size in the picture at any render scale)
+    // (and of the whole view, so they are the same size in every tile)
+    frame.clip_units_per_pixel = 2.0f / view;
+    frame.window_scale = 2.0f / (hi - lo);
+    frame.window_offset = -(hi + lo) / (hi - lo);
+    //(this was always uploaded as the first three floats of the camera's local-to-world matrix)
+    frame.viewPos = glm::vec3(camera->transform->make_local_to_world()[0]);
+    frame.dA = Parameters::dA;
+    frame.cangiante_variable = Parameters::cangiante_variable;
+    frame.dilution_variable = Parameters::dilution_variable;
+    scene_program->set_frame(frame);
     scene->draw(camera);
     //restoring things turned off for debug view
     Parameters::dA = dA0;
@@ -487,14 +781,31 @@ void GameMode::draw_scene(GLuint* color_tex_, GLuint* control_tex_,
     Parameters::speed = speed0;
 }
 
-//copies weights into the array that'll be passed as an uniform
-void GameMode::get_weights(){
-    if(Parameters::blur_amount>0 && Parameters::blur_amount<=20){
-        auto to_copy = weight_arrays[Parameters::blur_amount-1];
-        for(int i = 0; i<Parameters::blur_amount; i++){
+//copies weights into the array that'll be passed as an uniform, for the blur
+//radius scaled to rendered pixels; returns that radius
+int GameMode::get_weights(float scale){
+    int blur_amount = Parameters::blur_amount;
+    if(blur_amount<=0 || blur_amount>20) return blur_amount;
+    if(scale <= 1.0f){
+        //(fewer rendered pixels: the kernel for the smaller radius)
+        blur_amount = glm::clamp(int(std::round(blur_amount*scale)), 1, 20);
+        auto to_copy = weight_arrays[blur_amount-1];
+        for(int i = 0; i<blur_amount; i++){
             weights[i] = to_copy[i];
         }
+        return blur_amount;
     }
+    //(supersampling: the same kernel, stretched over more taps)
+    auto from = weight_arrays[blur_amount-1];
+    int taps = std::min(int(std::round(blur_amount*scale)), int(MaxBlurTaps));
+    for(int i = 0; i<taps; i++){
+        float x = i/scale;
+        int x0 = int(x);
+        float a = from[x0];
+        float b = (x0+1 < blur_amount ? from[x0+1] : 0.0f);
+        weights[i] = (a + (b-a)*(x-x0))/scale;
+    }
+    return taps;
 }
 
 //shader that does a horizontal pass and a vertical pass of gaussian blur and
@@ -536,17 +847,26 @@ void GameMode::draw_mrt_blur(GLuint color_tex, GLuint control_tex,
 
     //set glViewport
 	glBindFramebuffer(GL_FRAMEBUFFER, fb);
-	glViewport(0,0, textures.size.x, textures.size.y);
+	glViewport(0,0, textures.region.x, textures.region.y);
 	camera->aspect = textures.size.x / float(textures.size.y);
 
     GLfloat black[4] = {0.0f, 0.0f, 0.0f, 1.0f};
     glClearBufferfv(GL_COLOR, 0, black);
     glClearBufferfv(GL_COLOR, 1, black);
+    //(the vertical pass reads past the edge of a scaled region; don't let it see an older, larger frame)
+    if(textures.region != textures.size) glClearBufferfv(GL_COLOR, 2, black);
+
+    //radii are in rendered pixels, so they follow the render scale:
+    float scale = textures.scale().x;
+    int blur_amount = get_weights(scale);
+    int bleed_radius = glm::clamp(int(std::round(20.0f * scale)), 1, int(MaxBlurTaps));
 
 	//set up basic OpenGL state:
 	glEnable(GL_DEPTH_TEST);
 	glDisable(GL_BLEND);
 
+    timers.begin("blur h");
+
     //read from unblurred color_tex for both gaussian and bilateral blur
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_2D, color_tex);
@@ -559,11 +879,13 @@ void GameMode::draw_mrt_blur(GLuint color_tex, GLuint control_tex,
 
     glUseProgram(mrt_blurH_program->program);
     glUniform1f(mrt_blurH_program->depth_threshold, Parameters::depth_threshold);
-    glUniform1i(mrt_blurH_program->blur_amount, Parameters::blur_amount);
-    get_weights();
-    glUniform1fv(mrt_blurH_program->weights, 20, weights);
+    glUniform1i(mrt_blurH_program->blur_amount, blur_amount);
+    glUniform1i(mrt_blurH_program->bleed_radius, bleed_radius);
+    glUniform1fv(mrt_blurH_program->weights, MaxBlurTaps, weights);
     glDrawArrays(GL_TRIANGLES, 0, 3);
+    timers.end();
 
+    timers.begin("blur v");
     static GLuint fb2 = 0;
     if(fb2==0) glGenFramebuffers(1, &fb2);
     glBindFramebuffer(GL_FRAMEBUFFER, fb2);
@@ -591,9 +913,11 @@ void GameMode::draw_mrt_blur(GLuint color_tex, GLuint control_tex,
 
     glUseProgram(mrt_blurV_program->program);
     glUniform1f(mrt_blurV_program->depth_threshold, Parameters::depth_threshold);
-    glUniform1i(mrt_blurV_program->blur_amount,Parameters:: blur_amount);
-    glUniform1fv(mrt_blurV_program->weights, 20, weights);
+    glUniform1i(mrt_blurV_program->blur_amount, blur_amount);
+    glUniform1i(mrt_blurV_program->bleed_radius, bleed_radius);
+    glUniform1fv(mrt_blurV_program->weights, MaxBlurTaps, weights);
     glDrawArrays(GL_TRIANGLES, 0, 3);
+    timers.end();
 
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_2D, 0);
@@ -625,7 +949,7 @@ void GameMode::draw_surface(GLuint paper_tex, GLuint* surface_tex_){
 
     //set glViewport
 	glBindFramebuffer(GL_FRAMEBUFFER, fb);
-	glViewport(0,0, textures.size.x, textures.size.y);
+	glViewport(0,0, textures.region.x, textures.region.y);
 	camera->aspect = textures.size.x / float(textures.size.y);
 
     GLfloat black[4] = {0.0f, 0.0f, 0.0f, 0.0f};
@@ -641,6 +965,8 @@ void GameMode::draw_surface(GLuint paper_tex, GLuint* surface_tex_){
     glBindTexture(GL_TEXTURE_2D, paper_tex);
 
 	glUseProgram(surface_program->program);
+    glUniform2f(surface_program->render_scale, textures.scale().x, textures.scale().y);
+    glUniform2f(surface_program->paper_offset, float(tile.origin.x), float(tile.origin.y));
     glDrawArrays(GL_TRIANGLES, 0, 3);
 
     glActiveTexture(GL_TEXTURE0);
@@ -666,7 +992,7 @@ void GameMode::draw_stylization(GLuint color_tex, GLuint final_control_tex,
 
     //set glViewport
 	glBindFramebuffer(GL_FRAMEBUFFER, fb);
-	glViewport(0,0, textures.size.x, textures.size.y);
+	glViewport(0,0, textures.region.x, textures.region.y);
 	camera->aspect = textures.size.x / float(textures.size.y);
 
     GLfloat black[4] = {0.0f, 0.0f, 0.0f, 0.0f};
@@ -707,45 +1033,291 @@ void GameMode::draw_stylization(GLuint color_tex, GLuint final_control_tex,
     glBindTexture(GL_TEXTURE_2D, 0);
 }
 
-//main draw function that calls the functions that call the other shaders
-void GameMode::draw(glm::uvec2 const &drawable_size) {
-	textures.allocate(drawable_size);
+//runs the passes (scene through stylize) for a picture of 'output_size', and picks screen_tex
+void GameMode::render(glm::uvec2 const &output_size) {
+    if(textures.output != output_size){
+        textures.output = output_size;
+        supersample = supersample_for(output_size);
+    }
+	textures.allocate(output_size * supersample);
+    //(saved pictures are always full resolution)
+    if(pic_mode) resolution.budget_ms = 0.0f;
+    resolution.update(timers);
+    if(textures.region != resolution.region(textures.size)){
+        textures.region = resolution.region(textures.size);
+        surfaced = false; //(paper is drawn at the render scale)
+    }
 
+    timers.begin("scene");
     draw_scene(&textures.color_tex, &textures.control_tex, &textures.depth_tex);
+    timers.end();
+    //(times "blur h" and "blur v" separately)
     draw_mrt_blur(textures.color_tex, textures.control_tex, textures.depth_tex,
                 &textures.blur_temp_tex, &textures.bleed_temp_tex,
                 &textures.control_temp_tex, &textures.final_control_tex,
                 &textures.blurred_tex, &textures.bleeded_tex);
 
     //only needs to be updated when resized since it doesn't change
-    if(!surfaced)
+    if(!surfaced){
+        timers.begin("surface");
         draw_surface(*paper_tex, &textures.surface_tex);
+        timers.end();
+    }
+    timers.begin("stylize");
     draw_stylization(textures.color_tex, textures.final_control_tex,
             textures.surface_tex, textures.blurred_tex, textures.bleeded_tex,
             &textures.final_tex);
+    timers.end();
 
-	//Copy scene from color buffer to screen, performing post-processing effects:
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
-	glActiveTexture(GL_TEXTURE0);
-    if(Parameters::show == FINAL){ //show different parts of pipeline for debug use
-    	glBindTexture(GL_TEXTURE_2D, textures.final_tex);
+    //show different parts of pipeline for debug use
+    if(Parameters::show == FINAL){
         screen_tex = textures.final_tex;
     }else if(Parameters::show == CONTROL_COLORS){
-        glBindTexture(GL_TEXTURE_2D, textures.control_tex);
         screen_tex = textures.control_tex;
     }else if(Parameters::show == GAUSSIAN_BLUR){
-        glBindTexture(GL_TEXTURE_2D, textures.blurred_tex);
         screen_tex = textures.blurred_tex;
     }else if(Parameters::show == BILATERAL_BLUR){
-        glBindTexture(GL_TEXTURE_2D, textures.bleeded_tex);
         screen_tex = textures.bleeded_tex;
     }else if(Parameters::show == SURFACE){
-        glBindTexture(GL_TEXTURE_2D, textures.surface_tex);
         screen_tex = textures.surface_tex;
     }else{
-        glBindTexture(GL_TEXTURE_2D, textures.color_tex);
         screen_tex = textures.color_tex;
     }
+}
+
+//renders a picture of 'size' as tiles of (at most) 'tile_size' pixels, each with an apron wide enough
+//for every pass that reads neighboring pixels, and writes the middles of the tiles a row at a time,
+//so memory (GPU and host) depends on the tile size and picture width, not the whole picture
+void GameMode::write_tiled_png(const char *filename, glm::uvec2 const &size, uint32_t tile_size){
+    PROFILE_ZONE("GameMode::write_tiled_png");
+    //apron: bleeding (two 20 pixel passes, h then v), blur, and a pixel for paper distortion:
+    int blur_amount = glm::clamp(int(Parameters::blur_amount), 0, 20);
+    uint32_t apron = 41 + uint32_t(blur_amount) + 1;
+    GLint max_size = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_size);
+    tile_size = glm::clamp(tile_size, 16U, uint32_t(max_size) - 2 * apron);
+    glm::uvec2 tiles = (size + glm::uvec2(tile_size - 1)) / tile_size;
+    std::cout << "Rendering " << size.x << "x" << size.y << " in " << tiles.x << "x" << tiles.y << " tiles of "
+        << tile_size << " (plus " << apron << " pixel aprons)." << std::endl;
+
+    PNGWriter png(filename, size);
+    std::vector< glm::u8vec4 > band(size.x * tile_size); //one row of tiles, lower-left origin
+    Resources::track_host(band.data(), band.size() * sizeof(glm::u8vec4), "GameMode", "tiled picture band");
+    std::vector< glm::u8vec4 > pixels;
+
+    tile.picture = size;
+    //(rows of tiles go top to bottom, since that is the order PNG rows are written in)
+    for(uint32_t row = 0; row < tiles.y; ++row){
+        int32_t y0 = int32_t(size.y) - int32_t((row + 1) * tile_size); //(negative in the last row, if it is short)
+        uint32_t band_y = uint32_t(std::max(y0, 0));
+        uint32_t band_rows = size.y - row * tile_size - band_y;
+        for(uint32_t col = 0; col < tiles.x; ++col){
+            int32_t x0 = int32_t(col * tile_size);
+            uint32_t columns = std::min(tile_size, size.x - uint32_t(x0));
+            tile.origin = glm::ivec2(x0, y0) - int32_t(apron);
+            surfaced = false; //(paper lines up with the tile)
+            render(glm::uvec2(tile_size + 2 * apron));
+            glm::uvec2 read_size;
+            read_screen(&read_size, &pixels);
+            timers.end_frame(); //(every tile is timed like a frame)
+
+            //copy the middle of the tile into the band:
+            for(uint32_t y = 0; y < band_rows; ++y){
+                uint32_t from_y = band_y + y - uint32_t(tile.origin.y);
+                glm::u8vec4 const *from = pixels.data() + from_y * read_size.x + apron;
+                std::copy(from, from + columns, band.data() + y * size.x + x0);
+            }
+        }
+        png.write_rows(band.data(), band_rows, LowerLeftOrigin);
+    }
+    png.finish();
+
+    Resources::forget_host(band.data());
+    tile = Tile();
+    textures.output = glm::uvec2(0,0); //(so the next draw() sizes everything for the screen again)
+    surfaced = false;
+    std::cout<<"done writing out to "<<filename<<std::endl;
+}
+
+//renders frames of 'size' at a fixed timestep over sequence_range and writes them to sequence_out:
+//each frame is read back into a pixel pack buffer that is only mapped after the next frame is drawn,
+//and is encoded on worker threads (Y4M frames are written here, in order, once encoded)
+void GameMode::write_sequence(glm::uvec2 const &size){
+    PROFILE_ZONE("GameMode::write_sequence");
+    uint32_t count = uint32_t(std::max(1.0f, std::round((sequence_range.y - sequence_range.x) * sequence_fps)));
+    std::string out = (sequence_out.empty() ? "renders/" + Parameters::filename : sequence_out);
+    bool y4m = (out == "-" || (out.size() > 4 && out.substr(out.size() - 4) == ".y4m"));
+    FILE *y4m_file = nullptr;
+    if(y4m){
+        y4m_file = (out == "-" ? stdout : std::fopen(out.c_str(), "wb"));
+        if(!y4m_file) throw std::runtime_error("Failed to open '" + out + "' for writing.");
+        std::fprintf(y4m_file, "YUV4MPEG2 W%u H%u F%u:1000 Ip A1:1 C420jpeg\n", size.x, size.y,
+            uint32_t(std::round(sequence_fps * 1000.0f)));
+    }
+    std::cout << "Rendering " << count << " frames of " << size.x << "x" << size.y << " at " << sequence_fps
+        << " fps (time " << sequence_range.x << " to " << sequence_range.y << ") to '" << out << "'." << std::endl;
+
+    resolution.budget_ms = 0.0f; //(every frame full resolution)
+
+    //readback ring; frame i is read into readbacks[i % 2], and mapped after frame i+1 is drawn:
+    struct Readback {
+        GLuint buffer = 0;
+        GLsync fence = nullptr;
+        uint32_t frame = -1U;
+    };
+    std::array< Readback, 2 > readbacks;
+    size_t bytes = size.x * size.y * sizeof(glm::u8vec4);
+    for(auto &rb : readbacks){
+        glGenBuffers(1, &rb.buffer);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, rb.buffer);
+        glBufferData(GL_PIXEL_PACK_BUFFER, bytes, NULL, GL_STREAM_READ);
+        Resources::track_buffer(rb.buffer, "GameMode", "sequence readback");
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    //frames being encoded (a few per thread, so workers stay busy while the GPU renders):
+    struct Encode {
+        std::vector< glm::u8vec4 > pixels;
+        std::vector< uint8_t > y4m; //(encoded frame, for writing in order)
+        JobSystem::Group group;
+        uint32_t frame = -1U;
+    };
+    JobSystem &jobs = JobSystem::shared();
+    std::vector< Encode > encodes(2 * jobs.thread_count());
+    auto finish_encode = [&](Encode &e){
+        jobs.wait(e.group);
+        if(y4m && e.frame != -1U) std::fwrite(e.y4m.data(), 1, e.y4m.size(), y4m_file);
+        e.frame = -1U;
+    };
+
+    GLuint narrowed_tex = 0, out_tex = 0; //(for downsample(), when supersampling)
+
+    //release everything on the way out, however it's left -- in particular, an exception from collect()
+    //must not unwind 'encodes' while jobs still refer to it:
+    struct Teardown {
+        std::function< void() > fn;
+        ~Teardown(){ fn(); }
+    } teardown{[&](){
+        for(auto &e : encodes){
+            try{
+                jobs.wait(e.group);
+            }catch(std::exception const &ex){
+                std::cerr << "WARNING: encoding frame " << e.frame << " failed: " << ex.what() << std::endl;
+            }
+        }
+        if(y4m_file && y4m_file != stdout) std::fclose(y4m_file);
+        else if(y4m_file) std::fflush(y4m_file);
+        for(auto &rb : readbacks){
+            if(rb.fence) glDeleteSync(rb.fence);
+            Resources::forget_buffer(rb.buffer);
+            glDeleteBuffers(1, &rb.buffer);
+        }
+        if(out_tex){
+            free_downsample_tex(&narrowed_tex);
+            free_downsample_tex(&out_tex);
+        }
+        GL_ERRORS();
+    }};
+
+    auto collect = [&](Readback &rb){
+        PROFILE_ZONE("collect");
+        GLenum status = GL_TIMEOUT_EXPIRED;
+        while(status == GL_TIMEOUT_EXPIRED) status = glClientWaitSync(rb.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ULL);
+        glDeleteSync(rb.fence);
+        rb.fence = nullptr;
+
+        Encode &e = encodes[rb.frame % encodes.size()];
+        finish_encode(e);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, rb.buffer);
+        void const *mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, bytes, GL_MAP_READ_BIT);
+        if(!mapped) throw std::runtime_error("Failed to map sequence readback buffer.");
+        e.pixels.resize(size.x * size.y);
+        std::memcpy(e.pixels.data(), mapped, bytes);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        e.frame = rb.frame;
+        rb.frame = -1U;
+
+        if(y4m){
+            jobs.run(e.group, [&e, size](){
+                encode_y4m_frame(size, e.pixels.data(), &e.y4m);
+            });
+        }else{
+            char number[16];
+            std::snprintf(number, sizeof(number), "-%05u.png", e.frame);
+            std::string filename = out + number;
+            jobs.run(e.group, [&e, size, filename](){
+                save_png(filename, size, e.pixels.data(), LowerLeftOrigin);
+            });
+        }
+    };
+
+    static GLuint fb = 0;
+    if(fb==0) glGenFramebuffers(1, &fb);
+
+    auto before = std::chrono::high_resolution_clock::now();
+    for(uint32_t i = 0; i < count; ++i){
+        Parameters::elapsed_time = sequence_range.x + i / sequence_fps;
+        render(size);
+
+        GLuint tex = screen_tex;
+        if(supersample > 1){
+            if(out_tex == 0){
+                narrowed_tex = alloc_downsample_tex(GL_RGBA32F, glm::uvec2(size.x, textures.region.y), "narrowed_tex");
+                out_tex = alloc_downsample_tex(GL_RGBA8, size, "out_tex");
+            }
+            downsample(screen_tex, textures.region, size, narrowed_tex, out_tex);
+            tex = out_tex;
+        }
+
+        Readback &rb = readbacks[i % readbacks.size()];
+        assert(rb.frame == -1U);
+        glBindFramebuffer(GL_FRAMEBUFFER, fb);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, tex, 0);
+        check_fb();
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, rb.buffer);
+        glReadPixels(0, 0, size.x, size.y, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        rb.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        rb.frame = i;
+        timers.end_frame();
+
+        //(the previous frame, which the GPU has likely finished while this one was being drawn)
+        if(i > 0) collect(readbacks[(i - 1) % readbacks.size()]);
+    }
+    collect(readbacks[(count - 1) % readbacks.size()]);
+    //(in frame order, so Y4M frames are written in order)
+    for(uint32_t i = 0; i < encodes.size(); ++i){
+        uint32_t frame = count + i;
+        finish_encode(encodes[frame % encodes.size()]);
+    }
+    float seconds = std::chrono::duration< float >(std::chrono::high_resolution_clock::now() - before).count();
+    std::cout << "Wrote " << count << " frames in " << seconds << " s (" << count / seconds << " fps)." << std::endl;
+}
+
+//main draw function that calls the functions that call the other shaders
+void GameMode::draw(glm::uvec2 const &drawable_size) {
+    if(sequence_range.y > sequence_range.x){
+        write_sequence(drawable_size);
+        Mode::set_current(nullptr);
+        return;
+    }
+    if(pic_mode && poster_size != glm::uvec2(0,0)){
+        std::string filename = "renders/"+Parameters::filename+".png";
+        write_tiled_png(filename.c_str(), poster_size, poster_tile);
+        Mode::set_current(nullptr);
+        return;
+    }
+
+    render(drawable_size);
+
+    timers.begin("copy");
+
+	//Copy scene from color buffer to screen, performing post-processing effects:
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, screen_tex);
 
     if(pic_mode){
         std::string filename = "renders/"+Parameters::filename+".png";
@@ -755,7 +1327,14 @@ void GameMode::draw(glm::uvec2 const &drawable_size) {
 
     glDisable(GL_BLEND);
     glDisable(GL_DEPTH_TEST);
+	glViewport(0, 0, drawable_size.x, drawable_size.y);
 	glUseProgram(*copy_program);
+	{ //upscale if the passes rendered a smaller region:
+		static GLint scale = glGetUniformLocation(*copy_program, "scale");
+		static GLint region = glGetUniformLocation(*copy_program, "region");
+		glUniform2f(scale, textures.region.x / float(drawable_size.x), textures.region.y / float(drawable_size.y));
+		glUniform2f(region, float(textures.region.x), float(textures.region.y));
+	}
 	glBindVertexArray(*empty_vao);
 
 	glDrawArrays(GL_TRIANGLES, 0, 3);
@@ -763,6 +1342,34 @@ void GameMode::draw(glm::uvec2 const &drawable_size) {
 	glUseProgram(0);
 	glActiveTexture(GL_TEXTURE0);
 	glBindTexture(GL_TEXTURE_2D, 0);
+    timers.end();
+
+    if(show_timers){
+        //top left, in draw_text's [-aspect,aspect]x[-1,1] coordinates:
+        float aspect = drawable_size.x / float(drawable_size.y);
+        float height = 0.04f;
+        float y = 1.0f - 1.5f * height;
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        for (auto const &line : timers.overlay()) {
+            draw_text(line, glm::vec2(-aspect + 0.5f * height, y), height, glm::vec4(1.0f, 1.0f, 0.0f, 1.0f));
+            y -= 1.5f * height;
+        }
+        if (resolution.budget_ms > 0.0f) {
+            char buffer[64];
+            std::snprintf(buffer, sizeof(buffer), "RES %.3f %uX%u BUDGET %.1f", resolution.scale,
+                textures.region.x, textures.region.y, resolution.budget_ms);
+            draw_text(buffer, glm::vec2(-aspect + 0.5f * height, y), height, glm::vec4(1.0f, 1.0f, 0.0f, 1.0f));
+            y -= 1.5f * height;
+        }
+        y -= 1.5f * height;
+        for (auto const &line : Resources::overlay()) {
+            draw_text(line, glm::vec2(-aspect + 0.5f * height, y), height, glm::vec4(1.0f, 1.0f, 0.0f, 1.0f));
+            y -= 1.5f * height;
+        }
+        glDisable(GL_BLEND);
+    }
+    timers.end_frame();
     GL_ERRORS();
 }
 
@@ -4,6 +4,9 @@
 #include "Load.hpp"
 
 #include "MeshBuffer.hpp"
+#include "FileWatcher.hpp"
+#include "PassTimers.hpp"
+#include "DynamicResolution.hpp"
 #include "GL.hpp"
 
 #include <SDL.h>
@@ -14,6 +17,7 @@
 
 
 #include <vector>
+#include <map>
 #include <string>
 
 // The 'GameMode' mode is the main gameplay mode:
@@ -32,7 +36,8 @@ struct GameMode : public Mode {
 
 	//draw is called after update:
 	virtual void draw(glm::uvec2 const &drawable_size) override;
-    void get_weights();
+    void render(glm::uvec2 const &output_size);
+    int get_weights(float scale);
     void draw_scene(GLuint* control_tex_, GLuint* color_tex_,
             GLuint* depth_tex_);
     void draw_mrt_blur(GLuint color_tex, GLuint control_tex, GLuint depth_tex,
@@ -44,10 +49,34 @@ struct GameMode : public Mode {
                         GLuint surface_tex, GLuint blurred_tex,
                         GLuint bleeded_tex, GLuint* final_tex_);
     void write_png(const char *filename);
+    //the texture most recently copied to the screen (as chosen by Parameters::show), lower-left origin:
+    // (when supersampling, it is filtered down to the output size on the GPU first)
+    void read_screen(glm::uvec2 *size, std::vector< glm::u8vec4 > *data);
+    //render a picture too big for one set of textures in tiles, streaming it to a PNG (see main's -poster):
+    void write_tiled_png(const char *filename, glm::uvec2 const &size, uint32_t tile_size);
+    //render and write out an animation over a range of elapsed time (see main's -sequence):
+    void write_sequence(glm::uvec2 const &size);
+
+	//GPU and CPU time of each pass in draw(); 'T' toggles an on-screen summary:
+	PassTimers timers;
+	bool show_timers = false;
+
+	//fraction of the output size the scene and blur passes render, chosen to hold a GPU frame-time
+	// budget (off unless 'frame_budget_ms' is set; see main's -frame-budget):
+	DynamicResolution resolution;
+	//multiple of the output size the passes render at (the 'ssaa' setting, lowered if that won't fit in a texture):
+	uint32_t supersample = 1;
+
+	//source files of loaded assets; when one changes, update() re-reads it in place:
+	FileWatcher watcher;
+	void reload(std::string const &path);
+	std::map< GLuint, std::vector< char > > texture_shadows; //level data each texture was last reloaded with (see reload_texture)
 
     glm::quat camera_rot =  glm::angleAxis(glm::radians(0.0f),
             glm::vec3(1.0f, 0.0f, 0.0f));
     float yaw = 0.0;
     float pitch = 0.0;
-    float weights[20];
+    //blur taps per side, at most (20, times the largest supersampling factor; matches mrt_blur_program.cpp):
+    enum : int { MaxBlurTaps = 80 };
+    float weights[MaxBlurTaps];
 };
@@ -0,0 +1,44 @@
+#include "HeadlessGL.hpp"
+
+#include "GL.hpp"
+
+#include <stdexcept>
+#include <string>
+
+HeadlessGL::HeadlessGL(uint32_t width, uint32_t height) {
+	SDL_Init(SDL_INIT_VIDEO);
+	SDL_GL_ResetAttributes();
+	SDL_GL_SetAttribute(SDL_GL_RED_SIZE, 8);
+	SDL_GL_SetAttribute(SDL_GL_GREEN_SIZE, 8);
+	SDL_GL_SetAttribute(SDL_GL_BLUE_SIZE, 8);
+	SDL_GL_SetAttribute(SDL_GL_ALPHA_SIZE, 8);
+	SDL_GL_SetAttribute(SDL_GL_DEPTH_SIZE, 24);
+	SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
+
+	//(everything is drawn to framebuffer objects, so the window itself can be tiny)
+	window = SDL_CreateWindow("headless", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, int(width), int(height),
+		SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN);
+	if (!window) {
+		throw std::runtime_error(std::string("Can't create hidden window: ") + SDL_GetError());
+	}
+	context = SDL_GL_CreateContext(window);
+	if (!context) {
+		SDL_DestroyWindow(window);
+		throw std::runtime_error(std::string("Can't create OpenGL 3.3 context: ") + SDL_GetError());
+	}
+
+	#ifdef _WIN32
+	init_gl_shims();
+	#endif
+
+	SDL_GL_SetSwapInterval(0);
+}
+
+HeadlessGL::~HeadlessGL() {
+	SDL_GL_DeleteContext(context);
+	SDL_DestroyWindow(window);
+	SDL_Quit();
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <SDL.h>
+
+#include <cstdint>
+
+//"HeadlessGL" makes an OpenGL 3.3 core context on a small hidden window, for tools that
+// render offscreen with the game's code (e.g., bench.cpp, golden.cpp) or replay it (glreplay.cpp):
+// note: will throw if a context can't be made.
+
+struct HeadlessGL {
+	HeadlessGL(uint32_t width = 64, uint32_t height = 64); //(window size)
+	~HeadlessGL();
+	HeadlessGL(HeadlessGL const &) = delete;
+
+	SDL_Window *window = nullptr;
+	SDL_GLContext context = nullptr;
+};
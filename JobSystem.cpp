@@ -0,0 +1,137 @@
+#include "JobSystem.hpp"
+#include "Profiler.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+namespace {
+	thread_local uint32_t current_thread_index = 0;
+}
+
+uint32_t JobSystem::default_worker_count() {
+	uint32_t hw = std::thread::hardware_concurrency();
+	return (hw > 1 ? hw - 1 : 0);
+}
+
+uint32_t JobSystem::thread_index() {
+	return current_thread_index;
+}
+
+JobSystem &JobSystem::shared() {
+	static JobSystem jobs;
+	return jobs;
+}
+
+JobSystem::JobSystem(uint32_t worker_count) {
+	for (uint32_t i = 0; i < worker_count + 1; ++i) {
+		queues.emplace_back(new Queue);
+	}
+	for (uint32_t i = 0; i < worker_count; ++i) {
+		workers.emplace_back([this,i](){
+			current_thread_index = i + 1;
+			#if PROFILER
+			Profiler::set_thread_name("worker " + std::to_string(current_thread_index));
+			#endif
+			while (true) {
+				if (run_one(current_thread_index)) continue;
+				std::unique_lock< std::mutex > lock(sleep_mutex);
+				wake.wait(lock, [this](){ return quit || queued.load() > 0; });
+				if (quit) break;
+			}
+		});
+	}
+}
+
+JobSystem::~JobSystem() {
+	{
+		std::unique_lock< std::mutex > lock(sleep_mutex);
+		quit = true;
+	}
+	wake.notify_all();
+	for (auto &w : workers) {
+		w.join();
+	}
+}
+
+void JobSystem::run(Group &group, Job const &job) {
+	group.pending += 1;
+	if (workers.empty()) {
+		//no workers, so just do it now:
+		run_job(job, group);
+		return;
+	}
+	Queue &queue = *queues[thread_index()];
+	{
+		std::unique_lock< std::mutex > lock(queue.mutex);
+		queue.jobs.emplace_back(job, &group);
+	}
+	queued += 1;
+	{ //(taking the lock makes sure a worker can't miss the wakeup between checking 'queued' and sleeping)
+		std::unique_lock< std::mutex > lock(sleep_mutex);
+	}
+	wake.notify_one();
+}
+
+bool JobSystem::run_one(uint32_t self) {
+	std::pair< Job, Group * > job;
+	bool found = false;
+	{ //newest job from own queue:
+		Queue &queue = *queues[self];
+		std::unique_lock< std::mutex > lock(queue.mutex);
+		if (!queue.jobs.empty()) {
+			job = std::move(queue.jobs.back());
+			queue.jobs.pop_back();
+			found = true;
+		}
+	}
+	//...or oldest job from someone else's:
+	for (uint32_t i = 1; !found && i < queues.size(); ++i) {
+		Queue &queue = *queues[(self + i) % queues.size()];
+		std::unique_lock< std::mutex > lock(queue.mutex);
+		if (!queue.jobs.empty()) {
+			job = std::move(queue.jobs.front());
+			queue.jobs.pop_front();
+			found = true;
+		}
+	}
+	if (!found) return false;
+
+	queued -= 1;
+	run_job(job.first, *job.second);
+	return true;
+}
+
+void JobSystem::run_job(Job const &job, Group &group) {
+	try {
+		job();
+	} catch (...) {
+		//(an exception escaping a worker would terminate; hand it to whoever waits on the group instead)
+		std::unique_lock< std::mutex > lock(group.error_mutex);
+		if (!group.error) group.error = std::current_exception();
+	}
+	group.pending -= 1;
+}
+
+void JobSystem::wait(Group &group) {
+	while (group.pending.load() > 0) {
+		if (!run_one(thread_index())) {
+			std::this_thread::yield();
+		}
+	}
+	std::exception_ptr error;
+	{
+		std::unique_lock< std::mutex > lock(group.error_mutex);
+		std::swap(error, group.error);
+	}
+	if (error) std::rethrow_exception(error);
+}
+
+void JobSystem::parallel_for(uint32_t count, uint32_t grain, std::function< void(uint32_t, uint32_t) > const &fn) {
+	grain = std::max(grain, 1U);
+	Group group;
+	for (uint32_t begin = 0; begin < count; begin += grain) {
+		uint32_t end = std::min(count, begin + grain);
+		run(group, [&fn,begin,end](){ fn(begin, end); });
+	}
+	wait(group);
+}
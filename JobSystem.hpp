@@ -0,0 +1,69 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//"JobSystem" runs small CPU tasks on a pool of worker threads.
+// Every thread (workers, plus slot 0 for whoever else submits jobs) has its own
+// queue; a thread runs jobs from the back of its own queue and, when that is
+// empty, steals from the front of the others'. Threads waiting on a Group help
+// out by running jobs instead of blocking.
+// NOTE: jobs must not make OpenGL calls -- the context belongs to the main thread.
+
+struct JobSystem {
+	typedef std::function< void() > Job;
+
+	//a Group tracks a set of jobs so they can be waited on together;
+	// if any of them throws, wait() rethrows the first exception once they have all finished:
+	struct Group {
+		std::atomic< uint32_t > pending{0};
+		std::mutex error_mutex;
+		std::exception_ptr error;
+	};
+
+	//'workers' defaults to one less than the number of hardware threads:
+	explicit JobSystem(uint32_t workers = default_worker_count());
+	~JobSystem();
+	JobSystem(JobSystem const &) = delete;
+
+	//queue a job as part of 'group':
+	void run(Group &group, Job const &job);
+	//run jobs until everything in 'group' is finished (rethrows the first exception a job threw):
+	void wait(Group &group);
+
+	//call fn(begin, end) over [0,count) in chunks of about 'grain' and wait for all of them:
+	void parallel_for(uint32_t count, uint32_t grain, std::function< void(uint32_t begin, uint32_t end) > const &fn);
+
+	//number of threads that may run jobs (workers + the submitting thread):
+	uint32_t thread_count() const { return uint32_t(workers.size()) + 1; }
+	//index of the calling thread in [0, thread_count()): 0 for non-worker threads:
+	static uint32_t thread_index();
+
+	static uint32_t default_worker_count();
+
+	//the JobSystem used by the rest of the code (created on first use):
+	static JobSystem &shared();
+
+	//internals:
+	struct Queue {
+		std::mutex mutex;
+		std::deque< std::pair< Job, Group * > > jobs;
+	};
+	std::vector< std::unique_ptr< Queue > > queues; //one per thread
+	std::vector< std::thread > workers;
+
+	std::mutex sleep_mutex;
+	std::condition_variable wake;
+	std::atomic< uint32_t > queued{0}; //jobs sitting in queues
+	bool quit = false;
+
+	bool run_one(uint32_t self); //run one job (own queue first, then steal); returns false if there was nothing to do
+	static void run_job(Job const &job, Group &group); //run 'job', keeping any exception in 'group'
+};
@@ -1,28 +1,312 @@
 #include "Load.hpp"
+#include "JobSystem.hpp"
+#include "Profiler.hpp"
 
-#include <array>
-#include <list>
+#include <atomic>
 #include <cassert>
+#include <chrono>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <list>
+#include <map>
+#include <mutex>
+#include <set>
+#include <sstream>
+
+thread_local uint32_t load_stage_depth = 0;
 
 namespace {
-	std::array< std::list< std::function< void() > >, LoadTagCount > &get_load_lists() {
-		static std::array< std::list< std::function< void() > >, LoadTagCount > load_lists;
-		return load_lists;
+	//marks the calling thread as running a load stage for as long as it exists:
+	struct LoadStageScope {
+		LoadStageScope() { ++load_stage_depth; }
+		~LoadStageScope() { --load_stage_depth; }
+	};
+
+	struct LoadEntry {
+		void const *key = nullptr; //Load< T > that added this (nullptr for unnamed loads)
+		LoadTag tag = LoadTagDefault;
+		std::string name;
+		std::function< void() > cpu; //(optional) run on a worker thread
+		std::function< void() > gl; //run on the main thread
+		std::vector< void const * > after; //keys of loads whose GL stage must finish first
+		bool ordered = false; //unnamed loads wait for everything added before them in the same or earlier tags
+		LoadStatus *status = nullptr; //flags in the Load< T >
+		std::once_flag once; //(for lazy loads)
+
+		//filled in by call_load_functions():
+		std::vector< LoadEntry const * > waits_for;
+		std::atomic< bool > cpu_done{false};
+		std::exception_ptr cpu_error;
+		bool done = false;
+		double cpu_ms = 0.0;
+		double gl_ms = 0.0;
+		double ready_ms = 0.0; //time since start of call_load_functions() when GL stage finished
+	};
+
+	//(a list, so entries never move)
+	std::list< LoadEntry > &get_load_entries() {
+		static std::list< LoadEntry > load_entries;
+		return load_entries;
+	}
+
+	//LoadTagLazy loads (kept until they run, which may be never):
+	std::list< LoadEntry > &get_lazy_entries() {
+		static std::list< LoadEntry > lazy_entries;
+		return lazy_entries;
+	}
+	LoadEntry *find_lazy_entry(void const *key) {
+		for (auto &entry : get_lazy_entries()) {
+			if (entry.key == key) return &entry;
+		}
+		return nullptr;
+	}
+
+	//every load ever added, for report_unused_loads() and for lazy loads checking their dependencies:
+	struct LoadRecord {
+		std::string name;
+		bool lazy = false;
+		LoadStatus const *status = nullptr;
+	};
+	std::map< void const *, LoadRecord > &get_load_records() {
+		static std::map< void const *, LoadRecord > load_records;
+		return load_records;
+	}
+
+	LoadEntry &new_entry(void const *key, LoadTag tag, std::string const &name, LoadStatus *status) {
+		assert(tag < LoadTagCount);
+		assert(key);
+		auto &entries = (tag == LoadTagLazy ? get_lazy_entries() : get_load_entries());
+		entries.emplace_back();
+		LoadEntry &entry = entries.back();
+		entry.key = key;
+		entry.tag = tag;
+		entry.name = name;
+		entry.status = status;
+
+		LoadRecord &record = get_load_records()[key];
+		record.name = name;
+		record.lazy = (tag == LoadTagLazy);
+		record.status = status;
+		return entry;
+	}
+
+	typedef std::chrono::high_resolution_clock Clock;
+	double ms_since(Clock::time_point const &before) {
+		return std::chrono::duration< double, std::milli >(Clock::now() - before).count();
 	}
 }
 
-void add_load_function(LoadTag tag, std::function< void() > const &fn) {
-	auto &load_lists = get_load_lists();
-	assert(tag < load_lists.size());
-	load_lists[tag].emplace_back(fn);
+void add_load_function(void const *key, LoadTag tag, std::function< void() > const &fn, LoadStatus *status) {
+	LoadEntry &entry = new_entry(key, tag, "(unnamed #" + std::to_string(get_load_records().size() + 1) + ")", status);
+	entry.gl = fn;
+	entry.ordered = true;
+}
+
+void add_load_function(void const *key, LoadTag tag, std::string const &name,
+	std::function< void() > const &cpu, std::function< void() > const &gl,
+	std::vector< void const * > const &after, LoadStatus *status) {
+	LoadEntry &entry = new_entry(key, tag, name, status);
+	entry.cpu = cpu;
+	entry.gl = gl;
+	entry.after = after;
 }
 
 void call_load_functions() {
-	auto &load_lists = get_load_lists();
-	for (auto &fn_list : load_lists) {
-		while (!fn_list.empty()) {
-			(*fn_list.begin())(); //call first function in the list
-			fn_list.pop_front(); //remove from list
+	PROFILE_ZONE("call_load_functions");
+	auto &entries = get_load_entries();
+	Clock::time_point start = Clock::now();
+
+	//resolve dependencies:
+	std::map< void const *, LoadEntry const * > by_key;
+	for (auto const &entry : entries) {
+		if (entry.key) by_key[entry.key] = &entry;
+	}
+	for (auto &entry : entries) {
+		//a lazy dependency will be loaded when this load's GL stage uses it, so wait for what *it* depends on:
+		std::set< void const * > visited;
+		std::function< void(void const *) > wait_for = [&](void const *key) {
+			if (!visited.insert(key).second) return;
+			if (LoadEntry const *lazy = find_lazy_entry(key)) {
+				for (void const *k : lazy->after) wait_for(k);
+				return;
+			}
+			auto f = by_key.find(key);
+			if (f == by_key.end()) {
+				throw std::runtime_error("Load '" + entry.name + "' depends on a load that was never added.");
+			}
+			entry.waits_for.emplace_back(f->second);
+		};
+		for (void const *key : entry.after) {
+			wait_for(key);
+		}
+		if (entry.ordered) {
+			for (auto const &other : entries) {
+				if (&other == &entry) break;
+				if (other.tag <= entry.tag) entry.waits_for.emplace_back(&other);
+			}
+			for (auto const &other : entries) {
+				if (other.tag < entry.tag) entry.waits_for.emplace_back(&other);
+			}
+		}
+	}
+
+	//start all CPU stages:
+	JobSystem &jobs = JobSystem::shared();
+	JobSystem::Group cpu_stages;
+	for (auto &entry : entries) {
+		if (!entry.cpu) {
+			entry.cpu_done = true;
+			continue;
+		}
+		LoadEntry *e = &entry;
+		jobs.run(cpu_stages, [e](){
+			PROFILE_ZONE_DYNAMIC(Profiler::intern("load " + e->name + " (cpu)"));
+			Clock::time_point before = Clock::now();
+			try {
+				LoadStageScope scope;
+				e->cpu();
+			} catch (...) {
+				e->cpu_error = std::current_exception();
+			}
+			e->cpu_ms = ms_since(before);
+			e->cpu_done = true;
+		});
+	}
+
+	//run GL stages as they become ready:
+	size_t remaining = entries.size();
+	while (remaining) {
+		bool progressed = false;
+		for (auto &entry : entries) {
+			if (entry.done || !entry.cpu_done) continue;
+			bool ready = true;
+			for (auto w : entry.waits_for) {
+				if (!w->done) {
+					ready = false;
+					break;
+				}
+			}
+			if (!ready) continue;
+
+			if (entry.cpu_error) {
+				jobs.wait(cpu_stages); //(don't leave jobs running against a half-loaded program)
+				std::rethrow_exception(entry.cpu_error);
+			}
+			PROFILE_ZONE_DYNAMIC(Profiler::intern("load " + entry.name + " (gl)"));
+			Clock::time_point before = Clock::now();
+			{
+				LoadStageScope scope;
+				entry.gl();
+			}
+			if (entry.status) entry.status->loaded.store(true, std::memory_order_release);
+			entry.gl_ms = ms_since(before);
+			entry.ready_ms = ms_since(start);
+			entry.done = true;
+			--remaining;
+			progressed = true;
 		}
+		if (!progressed) {
+			if (cpu_stages.pending.load() == 0) {
+				//nothing is ready and nothing is running, so something is waiting on itself:
+				std::string names;
+				for (auto const &entry : entries) {
+					if (!entry.done) names += " '" + entry.name + "'";
+				}
+				throw std::runtime_error("Loads can't finish because of a dependency cycle among:" + names);
+			}
+			//help out with CPU stages while waiting:
+			if (!jobs.run_one(JobSystem::thread_index())) {
+				std::this_thread::yield();
+			}
+		}
+	}
+	jobs.wait(cpu_stages);
+
+	//report:
+	double total_ms = ms_since(start);
+	double cpu_total = 0.0, gl_total = 0.0;
+	for (auto const &entry : entries) {
+		cpu_total += entry.cpu_ms;
+		gl_total += entry.gl_ms;
+	}
+	std::ostringstream report; //(so as not to change std::cout's formatting)
+	report << "Loaded " << entries.size() << " assets in " << std::fixed << std::setprecision(1) << total_ms << " ms"
+		<< " (CPU stages " << cpu_total << " ms on " << jobs.thread_count() << " threads, GL stages " << gl_total << " ms):\n";
+	report << "    cpu ms     gl ms  ready at  name\n";
+	for (auto const &entry : entries) {
+		report
+			<< std::setw(10) << entry.cpu_ms
+			<< std::setw(10) << entry.gl_ms
+			<< std::setw(10) << entry.ready_ms
+			<< "  " << entry.name << '\n';
+	}
+	std::cout << report.str();
+	std::cout.flush();
+
+	entries.clear();
+}
+
+void run_lazy_load(void const *key) {
+	LoadEntry *entry = find_lazy_entry(key);
+	if (!entry) {
+		throw std::runtime_error("Lazy load was never added.");
+	}
+	std::call_once(entry->once, [entry](){
+		PROFILE_ZONE_DYNAMIC(Profiler::intern("lazy load " + entry->name));
+		for (void const *dep : entry->after) {
+			if (find_lazy_entry(dep)) {
+				run_lazy_load(dep);
+				continue;
+			}
+			auto f = get_load_records().find(dep);
+			if (f == get_load_records().end()) {
+				throw std::runtime_error("Load '" + entry->name + "' depends on a load that was never added.");
+			}
+			if (!f->second.status->loaded.load(std::memory_order_acquire)) {
+				throw std::runtime_error("Lazy load '" + entry->name + "' was used before '" + f->second.name + "' finished loading (before call_load_functions()?).");
+			}
+		}
+		Clock::time_point before = Clock::now();
+		LoadStageScope scope;
+		if (entry->cpu) entry->cpu();
+		entry->cpu_ms = ms_since(before);
+		before = Clock::now();
+		entry->gl();
+		entry->gl_ms = ms_since(before);
+		entry->status->loaded.store(true, std::memory_order_release);
+
+		std::ostringstream report; //(so as not to change std::cout's formatting)
+		report << "Lazily loaded '" << entry->name << "' in " << std::fixed << std::setprecision(1)
+			<< entry->cpu_ms + entry->gl_ms << " ms (CPU stage " << entry->cpu_ms << " ms, GL stage " << entry->gl_ms << " ms).\n";
+		std::cout << report.str();
+		std::cout.flush();
+
+		//(the stage functions aren't needed anymore; the entry itself stays, since other threads may be waiting on 'once')
+		entry->cpu = nullptr;
+		entry->gl = nullptr;
+	});
+}
+
+void report_unused_loads() {
+	std::string unused;
+	uint32_t unused_count = 0;
+	uint32_t never_needed = 0;
+	for (auto const &kv : get_load_records()) {
+		LoadRecord const &record = kv.second;
+		if (!record.status) continue;
+		bool loaded = record.status->loaded.load(std::memory_order_acquire);
+		if (loaded && !record.status->used.load(std::memory_order_relaxed)) {
+			unused += " '" + record.name + "'";
+			if (record.status->used_by_loads.load(std::memory_order_relaxed)) unused += " (only by other loads)";
+			++unused_count;
+		}
+		if (record.lazy && !loaded) ++never_needed;
+	}
+	if (unused_count) {
+		std::cout << unused_count << " loads finished but were never used (outside of loading):" << unused << std::endl;
+	}
+	if (never_needed) {
+		std::cout << never_needed << " lazy loads were never needed." << std::endl;
 	}
 }
@@ -21,38 +21,148 @@
  * These functions are grouped by 'tags', which allow some sequencing of calls.
  * (particularly, this is useful for loading large data blobs [e.g. "Meshes"] before looking up individual elements within them.)
  *
+ * Loads can instead be given a name and an explicit list of the loads they use,
+ * and split into a CPU stage (file I/O, decoding, parsing) and a GL stage (uploads, compiles):
+ *
+ * Load< GLuint > paper_tex(LoadTagDefault, "paper.png", {}, []() {
+ *     return load_texture_data("paper.png"); //CPU stage: runs on a worker thread
+ * }, [](TextureData &data) {
+ *     return new GLuint(upload_texture(data)); //GL stage: runs on the main thread
+ * });
+ *
+ * CPU stages all start right away (so they must not use other loads); a GL stage runs
+ * once its CPU stage and every load in its list have finished. Loads without a list
+ * keep the old behavior: they run after everything added before them in the same
+ * or an earlier tag.
+ * call_load_functions() prints how long each load took.
+ *
+ * Loads tagged LoadTagLazy are skipped by call_load_functions(); instead, both of their
+ * stages run (on the calling thread, exactly once) the first time the Load is dereferenced.
+ * Use this for things only some runs need (menus, debug programs, ...). Since the GL stage runs
+ * wherever that first use is, only dereference lazy loads from the main thread.
+ * report_unused_loads() lists loads that finished but were never dereferenced outside of
+ * other loads (noting the ones that other loads did use).
+ *
  */
 
+#include <atomic>
+#include <cstdint>
 #include <functional>
 #include <stdexcept>
+#include <string>
+#include <vector>
+#include <memory>
+#include <initializer_list>
+#include <type_traits>
 
 enum LoadTag : uint32_t {
 	LoadTagInit = 0, //used for loading mesh and texture blobs before main
 	LoadTagDefault = 1,
 	LoadTagLate = 2,
-	LoadTagCount = 3
+	LoadTagLazy = 3, //not loaded until first used
+	LoadTagCount = 4
+};
+
+//per-load flags, shared between a Load< T > and the loading code:
+struct LoadStatus {
+	std::atomic< bool > loaded{false}; //GL stage has finished (stored with release, so 'value' is safe to read after an acquire)
+	std::atomic< bool > used{false}; //dereferenced at least once, outside of any load's stages
+	std::atomic< bool > used_by_loads{false}; //dereferenced by another load's CPU or GL stage
 };
 
-void add_load_function(LoadTag tag, std::function< void() > const &fn);
+//nonzero while the calling thread is running a load's CPU or GL stage:
+// (so dereferences made while loading aren't mistaken for the program using a load)
+extern thread_local uint32_t load_stage_depth;
+
+//GL-stage-only load function, run after everything added before it with the same or an earlier tag:
+// ('key' identifies the load, as below)
+void add_load_function(void const *key, LoadTag tag, std::function< void() > const &fn, LoadStatus *status);
+
+//named load with (optional) CPU stage; 'key' identifies it in other loads' 'after' lists:
+void add_load_function(void const *key, LoadTag tag, std::string const &name,
+	std::function< void() > const &cpu, std::function< void() > const &gl,
+	std::vector< void const * > const &after, LoadStatus *status);
+
 void call_load_functions(); //called by main() after GL context created.
 
+//run a LoadTagLazy load (and any lazy loads it depends on), if it hasn't run yet:
+// (called by Load< T > on first use; thread-safe)
+void run_lazy_load(void const *key);
+
+//print the loads that finished but were never dereferenced outside of other loads' stages
+// (and how many lazy loads were never needed):
+void report_unused_loads(); //called by main() before exit.
+
+template< typename T >
+struct Load;
+
+//refers to a Load in another load's 'after' list:
+// (it's fine for the Load to not be constructed yet -- only its address is used)
+struct LoadDependency {
+	template< typename T >
+	LoadDependency(Load< T > const &load) : key(&load) { }
+	void const *key;
+};
+
 template< typename T >
 struct Load {
 	//Constructing a Load< T > adds the passed function to the list of functions to call:
-	Load( LoadTag tag, const std::function< T const *() > &load_fn ) : value(nullptr) {
-		add_load_function(tag, [this,load_fn](){
+	Load( LoadTag tag, const std::function< T const *() > &load_fn ) : value(nullptr), lazy(tag == LoadTagLazy) {
+		add_load_function(this, tag, [this,load_fn](){
 			this->value = load_fn();
 			if (!(this->value)) {
 				throw std::runtime_error("Loading failed.");
 			}
-		});
+		}, &status);
+	}
+
+	//Named, GL stage only, run after the loads in 'after':
+	Load( LoadTag tag, std::string const &name, std::initializer_list< LoadDependency > after, const std::function< T const *() > &load_fn ) : value(nullptr), lazy(tag == LoadTagLazy) {
+		add_load_function(this, tag, name, nullptr, [this,name,load_fn](){
+			this->value = load_fn();
+			if (!(this->value)) {
+				throw std::runtime_error("Loading '" + name + "' failed.");
+			}
+		}, keys(after), &status);
+	}
+
+	//Named, with a CPU stage (returns some Data) and a GL stage (takes Data &, returns T const *):
+	template< typename CPUFn, typename GLFn >
+	Load( LoadTag tag, std::string const &name, std::initializer_list< LoadDependency > after, CPUFn cpu_fn, GLFn gl_fn ) : value(nullptr), lazy(tag == LoadTagLazy) {
+		typedef typename std::decay< decltype(cpu_fn()) >::type Data;
+		//data handed from the CPU stage to the GL stage:
+		auto data = std::make_shared< std::unique_ptr< Data > >();
+		add_load_function(this, tag, name, [data,cpu_fn](){
+			data->reset(new Data(cpu_fn()));
+		}, [this,name,data,gl_fn](){
+			this->value = gl_fn(**data);
+			data->reset();
+			if (!(this->value)) {
+				throw std::runtime_error("Loading '" + name + "' failed.");
+			}
+		}, keys(after), &status);
 	}
 
 	//Make a "Load< T >" behave like a "T const *":
+	// (for lazy loads, 'bool' only says whether it has loaded yet; '*' and '->' load it)
 	explicit operator bool() { return value != nullptr; }
-	T const &operator*() { return *value; }
-	T const *operator->() { return value; }
+	T const &operator*() { return *get(); }
+	T const *operator->() { return get(); }
+
+	T const *get() {
+		std::atomic< bool > &used = (load_stage_depth ? status.used_by_loads : status.used);
+		if (!used.load(std::memory_order_relaxed)) used.store(true, std::memory_order_relaxed);
+		if (lazy && !status.loaded.load(std::memory_order_acquire)) run_lazy_load(this);
+		return value;
+	}
 
 	T const *value;
-};
+	bool const lazy;
+	LoadStatus status;
 
+	static std::vector< void const * > keys(std::initializer_list< LoadDependency > after) {
+		std::vector< void const * > ret;
+		for (auto const &d : after) ret.emplace_back(d.key);
+		return ret;
+	}
+};
@@ -0,0 +1,95 @@
+#include "MappedFile.hpp"
+
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+void MappedFile::touch() const {
+	volatile char sink = 0;
+	for (size_t i = 0; i < size; i += 4096) {
+		sink = sink + data[i];
+	}
+	(void)sink;
+}
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(std::string const &filename, Access access) {
+	DWORD flags = FILE_ATTRIBUTE_NORMAL | (access == Once ? FILE_FLAG_SEQUENTIAL_SCAN : 0);
+	HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, flags, NULL);
+	if (file == INVALID_HANDLE_VALUE) {
+		throw std::runtime_error("Failed to open '" + filename + "' for mapping.");
+	}
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx(file, &file_size)) {
+		CloseHandle(file);
+		throw std::runtime_error("Failed to get size of '" + filename + "'.");
+	}
+	file_handle = file;
+	size = size_t(file_size.QuadPart);
+	if (size == 0) return; //(can't map an empty file)
+
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping == NULL) {
+		CloseHandle(file);
+		file_handle = nullptr;
+		throw std::runtime_error("Failed to create mapping of '" + filename + "'.");
+	}
+	mapping_handle = mapping;
+	data = reinterpret_cast< char const * >(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+	if (data == nullptr) {
+		CloseHandle(mapping);
+		CloseHandle(file);
+		mapping_handle = file_handle = nullptr;
+		throw std::runtime_error("Failed to map '" + filename + "'.");
+	}
+}
+
+MappedFile::~MappedFile() {
+	if (data) UnmapViewOfFile(data);
+	if (mapping_handle) CloseHandle(mapping_handle);
+	if (file_handle) CloseHandle(file_handle);
+}
+
+#else
+
+MappedFile::MappedFile(std::string const &filename, Access access) {
+	int fd = open(filename.c_str(), O_RDONLY);
+	if (fd == -1) {
+		throw std::runtime_error("Failed to open '" + filename + "' for mapping.");
+	}
+	struct stat info;
+	if (fstat(fd, &info) != 0) {
+		close(fd);
+		throw std::runtime_error("Failed to get size of '" + filename + "'.");
+	}
+	size = size_t(info.st_size);
+	if (size == 0) { //(can't map an empty file)
+		close(fd);
+		return;
+	}
+	void *ptr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd); //(mapping keeps the file referenced)
+	if (ptr == MAP_FAILED) {
+		throw std::runtime_error("Failed to map '" + filename + "'.");
+	}
+	//read ahead aggressively (and let pages go behind) for one-shot reads; long-lived mappings, whose
+	// pieces are read on demand, keep the default (each piece is still read in order, so some readahead helps):
+	if (access == Once) madvise(ptr, size, MADV_SEQUENTIAL);
+	data = reinterpret_cast< char const * >(ptr);
+}
+
+MappedFile::~MappedFile() {
+	if (data) munmap(const_cast< char * >(data), size);
+}
+
+#endif
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+
+//"MappedFile" maps a whole file read-only into memory:
+// (contents stay valid for the lifetime of the MappedFile)
+// note: will throw if the file can't be opened or mapped.
+
+struct MappedFile {
+	//how the contents will be read (passed on to the OS as a hint):
+	enum Access {
+		Once, //front-to-back, once, soon after mapping (e.g., a loose asset being loaded)
+		Random, //piecemeal, in any order, for as long as the file is mapped (e.g., a mounted pack)
+	};
+	MappedFile(std::string const &filename, Access access = Once);
+	~MappedFile();
+	MappedFile(MappedFile const &) = delete;
+	MappedFile &operator=(MappedFile const &) = delete;
+
+	char const *data = nullptr; //nullptr for empty files
+	size_t size = 0;
+
+	char const *begin() const { return data; }
+	char const *end() const { return data + size; }
+
+	//read every page, so that later accesses don't wait on the disk:
+	// (e.g., call from a worker thread before handing the file to the main thread)
+	void touch() const;
+
+	//internals:
+	#ifdef _WIN32
+	void *file_handle = nullptr;
+	void *mapping_handle = nullptr;
+	#endif
+};
@@ -12,7 +12,7 @@
 
 GLint fade_program_color = -1;
 
-Load< GLuint > fade_program(LoadTagInit, [](){
+Load< GLuint > fade_program(LoadTagLazy, "fade_program", {}, [](){
 	GLuint *ret = new GLuint(compile_program(
 		"#version 330\n"
 		"void main() {\n"
@@ -33,7 +33,7 @@ Load< GLuint > fade_program(LoadTagInit, [](){
 });
 
 //vao that binds nothing:
-Load< GLuint > empty_binding(LoadTagDefault, [](){
+Load< GLuint > empty_binding(LoadTagLazy, "empty_binding", {}, [](){
 	GLuint vao;
 	glGenVertexArrays(1, &vao);
 	glBindVertexArray(vao);
@@ -1,20 +1,33 @@
 #include "MeshBuffer.hpp"
-#include "read_chunk.hpp"
+#include "ChunkFile.hpp"
+#include "Pack.hpp"
+#include "Profiler.hpp"
+#include "Resources.hpp"
 
 #include <glm/glm.hpp>
 
 #include <stdexcept>
-#include <fstream>
 #include <iostream>
 #include <vector>
 #include <string>
 #include <set>
 #include <cstddef>
+#include <cassert>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
 
-MeshBuffer::MeshBuffer(std::string const &filename) {
+MeshBuffer::MeshBuffer(std::string const &filename) : MeshBuffer(open_file_asset(filename)) {
+}
+
+MeshBuffer::MeshBuffer(Asset const &file) {
+	PROFILE_ZONE("MeshBuffer::MeshBuffer");
+	std::string const &filename = file.name;
 	glGenBuffers(1, &vbo);
 
-	std::ifstream file(filename, std::ios::binary);
+	//chunks are parsed in place and vertex data is uploaded straight from the mapping:
+	// (chunks this version doesn't know about are skipped)
+	ChunkFile chunks(file.begin(), file.end(), filename);
 
 	GLuint total = 0;
 	//read + upload data chunk:
@@ -24,8 +37,9 @@ MeshBuffer::MeshBuffer(std::string const &filename) {
 		};
 		static_assert(sizeof(Vertex) == 3*4, "Vertex is packed.");
 
-		std::vector< Vertex > data;
-		read_chunk(file, "p...", &data);
+		ChunkView< Vertex > data;
+		chunks.view("p...", &data);
+		vertex_magic = "p...";
 
 		//upload data:
 		glBindBuffer(GL_ARRAY_BUFFER, vbo);
@@ -44,8 +58,9 @@ MeshBuffer::MeshBuffer(std::string const &filename) {
 		};
 		static_assert(sizeof(Vertex) == 3*4+3*4, "Vertex is packed.");
 
-		std::vector< Vertex > data;
-		read_chunk(file, "pn..", &data);
+		ChunkView< Vertex > data;
+		chunks.view("pn..", &data);
+		vertex_magic = "pn..";
 
 		//upload data:
 		glBindBuffer(GL_ARRAY_BUFFER, vbo);
@@ -66,8 +81,9 @@ MeshBuffer::MeshBuffer(std::string const &filename) {
 		};
 		static_assert(sizeof(Vertex) == 3*4+3*4+4*1, "Vertex is packed.");
 
-		std::vector< Vertex > data;
-		read_chunk(file, "pnc.", &data);
+		ChunkView< Vertex > data;
+		chunks.view("pnc.", &data);
+		vertex_magic = "pnc.";
 
 		//upload data:
 		glBindBuffer(GL_ARRAY_BUFFER, vbo);
@@ -91,8 +107,9 @@ MeshBuffer::MeshBuffer(std::string const &filename) {
 		};
 		static_assert(sizeof(Vertex) == 3*4+3*4+4*2+2*4, "Vertex is packed.");
 
-		std::vector< Vertex > data;
-		read_chunk(file, "pnct", &data);
+		ChunkView< Vertex > data;
+		chunks.view("pnct", &data);
+		vertex_magic = "pnct";
 
 		//upload data:
 		glBindBuffer(GL_ARRAY_BUFFER, vbo);
@@ -108,6 +125,39 @@ MeshBuffer::MeshBuffer(std::string const &filename) {
 		ControlColor = Attrib(4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), offsetof(Vertex, ControlColor));
 		TexCoord = Attrib(2, GL_FLOAT, GL_FALSE, sizeof(Vertex), offsetof(Vertex, TexCoord));
 
+	} else if (filename.size() >= 5 && filename.substr(filename.size()-5) == ".pgct" && chunks.has("pgcq")) {
+		//quantized pgct (written by 'index_meshes -quantize'):
+		struct Vertex {
+			int16_t Position[4]; //snorm16, in the mesh's bounding box (w is always 1)
+			int16_t GeoNormal[2]; //snorm16, octahedral-encoded
+			int16_t Normal[2]; //snorm16, octahedral-encoded
+			glm::u8vec4 Color;
+			glm::u8vec4 ControlColor;
+			uint16_t TexCoord[2]; //half float
+		};
+		static_assert(sizeof(Vertex) == 2*4+2*2+2*2+4*2+2*2, "Vertex is packed.");
+
+		ChunkView< Vertex > data;
+		chunks.view("pgcq", &data);
+		vertex_magic = "pgcq";
+
+		//upload data:
+		glBindBuffer(GL_ARRAY_BUFFER, vbo);
+		glBufferData(GL_ARRAY_BUFFER, data.size() * sizeof(Vertex), data.data(), GL_STATIC_DRAW);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+		total = GLuint(data.size()); //store total for later checks on index
+
+		//store attrib locations:
+		Position = Attrib(4, GL_SHORT, GL_TRUE, sizeof(Vertex), offsetof(Vertex, Position));
+		GeoNormal = Attrib(2, GL_SHORT, GL_TRUE, sizeof(Vertex), offsetof(Vertex, GeoNormal));
+		Normal = Attrib(2, GL_SHORT, GL_TRUE, sizeof(Vertex), offsetof(Vertex, Normal));
+		Color = Attrib(4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), offsetof(Vertex, Color));
+		ControlColor = Attrib(4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), offsetof(Vertex, ControlColor));
+		TexCoord = Attrib(2, GL_HALF_FLOAT, GL_FALSE, sizeof(Vertex), offsetof(Vertex, TexCoord));
+
+		quantized = true;
+
 	} else if (filename.size() >= 5 && filename.substr(filename.size()-5) == ".pgct") {
 		struct Vertex {
 			glm::vec3 Position;
@@ -119,8 +169,9 @@ MeshBuffer::MeshBuffer(std::string const &filename) {
 		};
 		static_assert(sizeof(Vertex) == 3*4+3*4+3*4+4*2+2*4, "Vertex is packed.");
 
-		std::vector< Vertex > data;
-		read_chunk(file, "pgct", &data);
+		ChunkView< Vertex > data;
+		chunks.view("pgct", &data);
+		vertex_magic = "pgct";
 
 		//upload data:
 		glBindBuffer(GL_ARRAY_BUFFER, vbo);
@@ -141,50 +192,220 @@ MeshBuffer::MeshBuffer(std::string const &filename) {
 		throw std::runtime_error("Unknown file type '" + filename + "'");
 	}
 
-	std::vector< char > strings;
-	read_chunk(file, "str0", &strings);
+	//indexed files also have an index chunk:
+	GLuint index_total = 0;
+	auto upload_indices = [&](auto const &indices) {
+		for (auto i : indices) {
+			if (i >= total) throw std::runtime_error("index chunk has out-of-range vertex index");
+		}
+		glGenBuffers(1, &ibo);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(indices[0]), indices.data(), GL_STATIC_DRAW);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+		index_total = GLuint(indices.size());
+	};
+	if (chunks.has("i16.")) {
+		ChunkView< uint16_t > indices;
+		chunks.view("i16.", &indices);
+		upload_indices(indices);
+		index_type = GL_UNSIGNED_SHORT;
+	} else if (chunks.has("i32.")) {
+		ChunkView< uint32_t > indices;
+		chunks.view("i32.", &indices);
+		upload_indices(indices);
+		index_type = GL_UNSIGNED_INT;
+	}
+
+	read_meshes(chunks, (index_type == GL_NONE ? total : index_total));
+
+	Resources::track_buffer(vbo, "MeshBuffer", filename + " vertices");
+	if (ibo) Resources::track_buffer(ibo, "MeshBuffer", filename + " indices");
+
+	/* //DEBUG:
+	std::cout << "File '" << filename << "' contained meshes";
+	for (auto const &m : meshes) {
+		if (&m.second == &meshes.rbegin()->second && meshes.size() > 1) std::cout << " and";
+		std::cout << " '" << m.first << "'";
+		if (&m.second != &meshes.rbegin()->second) std::cout << ",";
+	}
+	std::cout << std::endl;
+	*/
+}
+
+void MeshBuffer::read_meshes(ChunkFile const &chunks, GLuint total) {
+	std::string const &filename = chunks.name;
 
-	{ //read index chunk, add to meshes:
+	ChunkView< char > strings;
+	chunks.view("str0", &strings);
+
+	//(everything is checked before 'meshes' changes, so a bad reload leaves it alone)
+	std::vector< std::pair< std::string, Mesh > > read;
+	std::set< std::string > found;
+	{ //read index chunk:
 		struct IndexEntry {
 			uint32_t name_begin, name_end;
 			uint32_t vertex_begin, vertex_end;
 		};
 		static_assert(sizeof(IndexEntry) == 16, "Index entry should be packed");
 
+		//(copied out, since str0 leaves it at an arbitrary alignment)
 		std::vector< IndexEntry > index;
-		read_chunk(file, "idx0", &index);
+		if (index_type == GL_NONE) {
+			chunks.read("idx0", &index);
+		} else {
+			//same layout, but vertex_begin/end are a range of indices:
+			chunks.read("idx1", &index);
+		}
+
+		struct Box {
+			float min[3], max[3];
+		};
+		static_assert(sizeof(Box) == 24, "Box should be packed");
+		std::vector< Box > boxes;
+		if (quantized) {
+			chunks.read("box0", &boxes);
+		}
 
 		for (auto const &entry : index) {
 			if (!(entry.name_begin <= entry.name_end && entry.name_end <= strings.size())) {
 				throw std::runtime_error("index entry has out-of-range name begin/end");
 			}
-			if (!(entry.vertex_begin <= entry.vertex_end && entry.vertex_end <= total)) {
+			if (!(entry.vertex_begin <= entry.vertex_end && entry.vertex_end <= total)) { //(index range, for idx1)
 				throw std::runtime_error("index entry has out-of-range vertex start/count");
 			}
-			std::string name(&strings[0] + entry.name_begin, &strings[0] + entry.name_end);
+			std::string name(strings.data() + entry.name_begin, strings.data() + entry.name_end);
 			Mesh mesh;
 			mesh.start = entry.vertex_begin;
 			mesh.count = entry.vertex_end - entry.vertex_begin;
-			bool inserted = meshes.insert(std::make_pair(name, mesh)).second;
-			if (!inserted) {
+			if (quantized) {
+				//positions are stored relative to each mesh's bounding box, listed in "box0":
+				if (boxes.size() != index.size()) {
+					throw std::runtime_error("quantized mesh file needs one bounding box per mesh");
+				}
+				Box const &box = boxes[&entry - &index[0]];
+				mesh.position_offset = 0.5f * (glm::vec3(box.max[0], box.max[1], box.max[2]) + glm::vec3(box.min[0], box.min[1], box.min[2]));
+				mesh.position_scale = 0.5f * (glm::vec3(box.max[0], box.max[1], box.max[2]) - glm::vec3(box.min[0], box.min[1], box.min[2]));
+			}
+			if (!found.insert(name).second) {
 				std::cerr << "WARNING: mesh name '" + name + "' in filename '" + filename + "' collides with existing mesh." << std::endl;
+				continue;
 			}
+			read.emplace_back(name, mesh);
 		}
 	}
 
-	if (file.peek() != EOF) {
-		std::cerr << "WARNING: trailing data in mesh file '" << filename << "'" << std::endl;
+	//add to meshes (in place, if reloading, so references stay valid):
+	for (auto const &nm : read) {
+		meshes[nm.first] = nm.second;
 	}
 
-	/* //DEBUG:
-	std::cout << "File '" << filename << "' contained meshes";
-	for (auto const &m : meshes) {
-		if (&m.second == &meshes.rbegin()->second && meshes.size() > 1) std::cout << " and";
-		std::cout << " '" << m.first << "'";
-		if (&m.second != &meshes.rbegin()->second) std::cout << ",";
+	//meshes missing from a reloaded file draw nothing (rather than whatever is in their old range now):
+	for (auto &m : meshes) {
+		if (!found.count(m.first)) {
+			std::cerr << "WARNING: mesh '" << m.first << "' is no longer in '" << filename << "'." << std::endl;
+			m.second.count = 0;
+		}
 	}
-	std::cout << std::endl;
-	*/
+}
+
+//make 'buffer' hold 'data', uploading only the blocks that differ from 'shadow' (a copy of what it
+// holds now, if not empty), and leave a copy of 'data' in 'shadow':
+// (the buffer keeps its name, so vertex array objects that use it stay valid)
+static size_t update_buffer(GLuint buffer, std::vector< char > *shadow, char const *data, size_t size) {
+	assert(shadow);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+	GLint64 old_size = 0;
+	glGetBufferParameteri64v(GL_COPY_WRITE_BUFFER, GL_BUFFER_SIZE, &old_size);
+	size_t uploaded = 0;
+	if (size_t(old_size) != size) {
+		//layout moved, so everything changes:
+		glBufferData(GL_COPY_WRITE_BUFFER, size, data, GL_STATIC_DRAW);
+		uploaded = size;
+	} else if (shadow->size() != size) {
+		//(no copy of the old contents to compare against)
+		if (size) glBufferSubData(GL_COPY_WRITE_BUFFER, 0, size, data);
+		uploaded = size;
+	} else {
+		auto upload = [&](size_t begin, size_t end) {
+			glBufferSubData(GL_COPY_WRITE_BUFFER, begin, end - begin, data + begin);
+			uploaded += end - begin;
+		};
+		//upload runs of changed blocks:
+		const size_t Block = 64 * 1024;
+		size_t run_begin = SIZE_MAX;
+		for (size_t begin = 0; begin < size; begin += Block) {
+			size_t end = std::min(size, begin + Block);
+			bool changed = (std::memcmp(shadow->data() + begin, data + begin, end - begin) != 0);
+			if (changed && run_begin == SIZE_MAX) run_begin = begin;
+			if (!changed && run_begin != SIZE_MAX) {
+				upload(run_begin, begin);
+				run_begin = SIZE_MAX;
+			}
+		}
+		if (run_begin != SIZE_MAX) upload(run_begin, size);
+	}
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	shadow->assign(data, data + size);
+	return uploaded;
+}
+
+size_t MeshBuffer::reload(Asset const &file) {
+	PROFILE_ZONE("MeshBuffer::reload");
+	std::string const &filename = file.name;
+	ChunkFile chunks(file.begin(), file.end(), filename);
+
+	//vertex array objects built by make_vao_for_program() bake in the vertex layout, so it can't change:
+	if (!chunks.has(vertex_magic)) {
+		throw std::runtime_error("Mesh file '" + filename + "' no longer has '" + vertex_magic + "' vertices; restart to load it.");
+	}
+	ChunkView< char > vertices;
+	chunks.view(vertex_magic, &vertices);
+	if (vertices.size() % Position.stride != 0) {
+		throw std::runtime_error("Mesh file '" + filename + "' has a partial vertex.");
+	}
+	GLuint total = GLuint(vertices.size() / Position.stride);
+
+	//...nor can whether there is an element buffer (it is bound in those VAOs), but its type can:
+	GLenum new_index_type = (chunks.has("i16.") ? GL_UNSIGNED_SHORT : (chunks.has("i32.") ? GL_UNSIGNED_INT : GL_NONE));
+	if ((new_index_type == GL_NONE) != (index_type == GL_NONE)) {
+		throw std::runtime_error("Mesh file '" + filename + "' changed between indexed and not; restart to load it.");
+	}
+	ChunkView< char > indices;
+	GLuint index_total = 0;
+	auto check_indices = [&](auto const &view) {
+		for (auto i : view) {
+			if (i >= total) throw std::runtime_error("index chunk has out-of-range vertex index");
+		}
+		indices.ptr = reinterpret_cast< char const * >(view.data());
+		indices.count = view.size() * sizeof(view[0]);
+		index_total = GLuint(view.size());
+	};
+	if (new_index_type == GL_UNSIGNED_SHORT) {
+		ChunkView< uint16_t > view;
+		chunks.view("i16.", &view);
+		check_indices(view);
+	} else if (new_index_type == GL_UNSIGNED_INT) {
+		ChunkView< uint32_t > view;
+		chunks.view("i32.", &view);
+		check_indices(view);
+	}
+
+	GLenum old_index_type = index_type;
+	index_type = new_index_type; //(read_meshes picks idx0/idx1 by this)
+	try {
+		read_meshes(chunks, (index_type == GL_NONE ? total : index_total));
+	} catch (...) {
+		index_type = old_index_type;
+		throw;
+	}
+
+	size_t uploaded = update_buffer(vbo, &vbo_shadow, vertices.data(), vertices.size());
+	if (ibo) uploaded += update_buffer(ibo, &ibo_shadow, indices.data(), indices.size());
+	Resources::track_buffer(vbo, "MeshBuffer", filename + " vertices");
+	if (ibo) Resources::track_buffer(ibo, "MeshBuffer", filename + " indices");
+	Resources::track_host(&vbo_shadow, vbo_shadow.size(), "MeshBuffer", filename + " vertices (reload copy)");
+	if (ibo) Resources::track_host(&ibo_shadow, ibo_shadow.size(), "MeshBuffer", filename + " indices (reload copy)");
+	return uploaded;
 }
 
 const MeshBuffer::Mesh &MeshBuffer::lookup(std::string const &name) const {
@@ -222,7 +443,10 @@ GLuint MeshBuffer::make_vao_for_program(GLuint program) const {
     bind_attribute("ControlColor", ControlColor);
 	bind_attribute("TexCoord", TexCoord);
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	//element buffer binding is part of the vao:
+	if (ibo) glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
 	glBindVertexArray(0);
+	if (ibo) glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 
 	//Check that all active attributes were bound:
 	GLint active = 0;
@@ -235,6 +459,7 @@ GLuint MeshBuffer::make_vao_for_program(GLuint program) const {
 		glGetActiveAttrib(program, i, 100, NULL, &size, &type, name);
 		name[99] = '\0';
 		GLint location = glGetAttribLocation(program, name);
+		if (std::string(name) == "ObjectIndex") continue; //per-instance attribute, set up by Scene::draw
 		if (!bound.count(GLuint(location))) {
 			throw std::runtime_error("ERROR: active attribute '" + std::string(name) + "' in program is not bound.");
 		}
@@ -1,13 +1,23 @@
 #pragma once
 
 #include "GL.hpp"
+
+#include <glm/glm.hpp>
+
 #include <map>
+#include <vector>
+
+struct Asset;
+struct ChunkFile;
 
 //"MeshBuffer" holds a collection of meshes loaded from a file
 // (note that meshes in a single collection will share a vbo/vao)
 
 struct MeshBuffer {
 	GLuint vbo = 0; //OpenGL vertex buffer object containing the meshes' data
+	GLuint ibo = 0; //OpenGL element buffer object, if the file was indexed (see index_meshes.cpp)
+	GLenum index_type = GL_NONE; //GL_UNSIGNED_SHORT or GL_UNSIGNED_INT if indexed
+	bool quantized = false; //Position is snorm16 relative to each mesh's box, normals are octahedral snorm16x2, TexCoord is half
 
 	//Attrib includes location within the vertex buffer of various attributes:
 	// (exactly the parameters to glVertexAttribPointer)
@@ -34,20 +44,39 @@ struct MeshBuffer {
 	//construct from a file:
 	// note: will throw if file fails to read.
 	MeshBuffer(std::string const &filename);
+	//construct from an asset, in a pack or not (e.g., one opened and touched off the main thread):
+	// (file type comes from the extension of asset.name)
+	MeshBuffer(Asset const &asset);
+
+	//re-read a changed file into the existing buffers (e.g., after re-exporting from blender):
+	// only blocks of vertex/index data that differ from the previous reload are uploaded (the first
+	// reload uploads everything); returns the number of bytes uploaded.
+	// buffer names, the vertex layout, and Mesh references all stay valid, so vaos built earlier still work.
+	// note: will throw (leaving everything as it was) if the file no longer fits that layout.
+	size_t reload(Asset const &asset);
 
 	//look up a particular mesh in the DB:
 	// note: will throw if mesh not found.
 	struct Mesh {
-		GLuint start = 0;
-		GLuint count = 0;
+		GLuint start = 0; //first vertex (or, if indexed, first index)
+		GLuint count = 0; //vertex (or index) count
+		//for quantized files, object-space position = position_offset + position_scale * Position:
+		glm::vec3 position_offset = glm::vec3(0.0f);
+		glm::vec3 position_scale = glm::vec3(1.0f);
 	};
 	const Mesh &lookup(std::string const &name) const;
 
-	//build a vertex array object that links this vbo to attributes to a program:
+	//build a vertex array object that links this vbo (and ibo) to attributes to a program:
 	//  will throw if program defines attributes not contained in this buffer
 	//  and warn if this buffer contains attributes not active in the program
+	//  (except 'ObjectIndex', which Scene::draw binds itself)
 	GLuint make_vao_for_program(GLuint program) const;
 
 	//internals:
 	std::map< std::string, Mesh > meshes;
+	std::string vertex_magic; //chunk the vertices were read from (fixes the layout)
+	//copies of what reload() last uploaded, to find changed blocks without reading the buffers back
+	// (empty until the first reload, so meshes that are never edited don't pay for them):
+	std::vector< char > vbo_shadow, ibo_shadow;
+	void read_meshes(ChunkFile const &chunks, GLuint total); //(total vertices, or indices if indexed)
 };
@@ -0,0 +1,127 @@
+#include "Pack.hpp"
+#include "MappedFile.hpp"
+#include "data_path.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+Pack::Pack(std::string const &filename_) : filename(filename_), file(std::make_shared< MappedFile >(filename_, MappedFile::Random)) {
+	char const *at = file->begin();
+	char const *end = file->end();
+
+	if (!peek_chunk(at, end, "pak0")) {
+		throw std::runtime_error("'" + filename + "' is not a pack file.");
+	}
+	std::vector< PackHeader > header;
+	read_chunk(&at, end, "pak0", &header);
+	if (header.size() != 1 || header[0].version != PackHeader().version) {
+		throw std::runtime_error("'" + filename + "' has an unsupported pack version.");
+	}
+	if (header[0].alignment == 0) {
+		throw std::runtime_error("'" + filename + "' has a zero alignment.");
+	}
+	read_chunk(&at, end, "toc0", &entries);
+	read_chunk(&at, end, "str0", &names);
+
+	//check the table of contents once, so lookups don't have to:
+	for (auto const &entry : entries) {
+		if (entry.name_begin > entry.name_end || entry.name_end > names.size()) {
+			throw std::runtime_error("Entry in '" + filename + "' has an out-of-range name.");
+		}
+		if (entry.offset % header[0].alignment != 0
+		 || entry.offset > file->size || entry.size > file->size - entry.offset) {
+			throw std::runtime_error("Entry '" + name(entry) + "' in '" + filename + "' is out of range.");
+		}
+		if (entry.type == PackEntry::Image) {
+			PackImage image;
+			if (entry.size < sizeof(image)) {
+				throw std::runtime_error("Image '" + name(entry) + "' in '" + filename + "' is truncated.");
+			}
+			std::memcpy(&image, file->data + entry.offset, sizeof(image));
+			if (entry.size != sizeof(image) + uint64_t(image.width) * image.height * 4) {
+				throw std::runtime_error("Image '" + name(entry) + "' in '" + filename + "' has the wrong size.");
+			}
+		} else if (entry.type != PackEntry::Raw) {
+			throw std::runtime_error("Entry '" + name(entry) + "' in '" + filename + "' has an unknown type.");
+		}
+	}
+	for (size_t i = 1; i < entries.size(); ++i) {
+		if (!(name(entries[i-1]) < name(entries[i]))) {
+			throw std::runtime_error("Entries in '" + filename + "' are not sorted by name.");
+		}
+	}
+}
+
+std::string Pack::name(PackEntry const &entry) const {
+	return std::string(names.begin() + entry.name_begin, names.begin() + entry.name_end);
+}
+
+PackEntry const *Pack::find(std::string const &name_) const {
+	auto f = std::lower_bound(entries.begin(), entries.end(), name_, [this](PackEntry const &entry, std::string const &n){
+		return name(entry) < n;
+	});
+	if (f == entries.end() || name(*f) != name_) return nullptr;
+	return f;
+}
+
+bool Pack::verify(PackEntry const &entry) const {
+	return pack_hash(file->data + entry.offset, size_t(entry.size)) == entry.hash;
+}
+
+Pack const *mounted_pack() {
+	//(function-local static, so concurrent first calls mount once)
+	static std::unique_ptr< Pack > pack = [](){
+		std::unique_ptr< Pack > ret;
+		std::string filename = data_path("assets.pack");
+		if (std::ifstream(filename, std::ios::binary)) {
+			ret.reset(new Pack(filename));
+			std::cout << "Using " << ret->entries.size() << " assets from '" << filename << "'." << std::endl;
+		}
+		return ret;
+	}();
+	return pack.get();
+}
+
+void Asset::touch() const {
+	volatile char sink = 0;
+	for (size_t i = 0; i < size; i += 4096) {
+		sink = sink + data[i];
+	}
+	(void)sink;
+}
+
+Asset open_asset(std::string const &name) {
+	if (Pack const *pack = mounted_pack()) {
+		if (PackEntry const *entry = pack->find(name)) {
+			Asset asset;
+			asset.name = name;
+			asset.data = pack->file->data + entry->offset;
+			asset.size = size_t(entry->size);
+			asset.type = entry->type;
+			asset.file = pack->file;
+			return asset;
+		}
+	}
+	Asset asset = open_file_asset(data_path(name));
+	asset.name = name;
+	return asset;
+}
+
+bool has_asset(std::string const &name) {
+	if (Pack const *pack = mounted_pack()) {
+		if (pack->find(name)) return true;
+	}
+	return bool(std::ifstream(data_path(name), std::ios::binary));
+}
+
+Asset open_file_asset(std::string const &filename) {
+	Asset asset;
+	asset.name = filename;
+	asset.file = std::make_shared< MappedFile >(filename);
+	asset.data = asset.file->data;
+	asset.size = asset.file->size;
+	return asset;
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "read_chunk.hpp"
+
+#include <memory>
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+struct MappedFile;
+
+//"Pack" is a single archive of assets (built by pack_assets.cpp), mapped once and read in place.
+//Layout:
+//  "pak0" chunk: PackHeader
+//  "toc0" chunk: PackEntry[], sorted by name
+//  "str0" chunk: entry names
+//  entry data, each starting at a multiple of PackHeader::alignment from the start of the file
+
+struct PackHeader {
+	uint32_t version = 1;
+	uint32_t alignment = 4096; //page size, so entries can be handed out as if separately mapped
+};
+static_assert(sizeof(PackHeader) == 4 + 4, "PackHeader is packed.");
+
+struct PackEntry {
+	uint32_t name_begin = 0; //name is [name_begin,name_end) in the "str0" chunk
+	uint32_t name_end = 0;
+	enum : uint32_t {
+		Raw = 0, //file contents, as-is
+		Image = 1, //pre-decoded image: PackImage header followed by width*height RGBA8 pixels, lower-left origin
+	};
+	uint32_t type = Raw;
+	uint32_t padding = 0;
+	uint64_t offset = 0; //from the start of the pack
+	uint64_t size = 0;
+	uint64_t hash = 0; //pack_hash() of the data
+};
+static_assert(sizeof(PackEntry) == 4 + 4 + 4 + 4 + 8 + 8 + 8, "PackEntry is packed.");
+
+struct PackImage {
+	uint32_t width = 0;
+	uint32_t height = 0;
+};
+static_assert(sizeof(PackImage) == 4 + 4, "PackImage is packed.");
+
+//64-bit FNV-1a, used for entry hashes:
+inline uint64_t pack_hash(char const *data, size_t size) {
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	for (size_t i = 0; i < size; ++i) {
+		hash = (hash ^ uint8_t(data[i])) * 0x100000001b3ULL;
+	}
+	return hash;
+}
+
+struct Pack {
+	//map a pack file and check its table of contents:
+	// note: will throw if the file can't be mapped or isn't a valid pack.
+	Pack(std::string const &filename);
+
+	std::string filename;
+	std::shared_ptr< MappedFile > file;
+	ChunkView< PackEntry > entries;
+	ChunkView< char > names;
+
+	//binary search for an entry by name (nullptr if not in the pack):
+	PackEntry const *find(std::string const &name) const;
+	std::string name(PackEntry const &entry) const;
+
+	//compare an entry's data against its hash (reads the whole entry):
+	bool verify(PackEntry const &entry) const;
+};
+
+//the pack at data_path("assets.pack"), mapped on first call (nullptr if there is no pack):
+// note: safe to call from worker threads (e.g., CPU stages of loads).
+Pack const *mounted_pack();
+
+//"Asset" is a read-only view of one data file, either inside the mounted pack or mapped from disk:
+struct Asset {
+	std::string name; //what the asset was opened as (e.g., "textures/grid.png")
+	char const *data = nullptr;
+	size_t size = 0;
+	uint32_t type = PackEntry::Raw; //PackEntry::Image for pre-decoded images
+	std::shared_ptr< MappedFile > file; //keeps data mapped
+
+	char const *begin() const { return data; }
+	char const *end() const { return data + size; }
+
+	//read every page, so that later accesses don't wait on the disk:
+	void touch() const;
+};
+
+//open 'name' (relative to data_path) from the mounted pack if it is there, or from a loose file otherwise:
+// note: will throw if neither exists.
+Asset open_asset(std::string const &name);
+
+//check whether open_asset(name) would find anything:
+bool has_asset(std::string const &name);
+
+//map a loose file by path, bypassing the pack:
+Asset open_file_asset(std::string const &filename);
@@ -0,0 +1,196 @@
+#include "PassTimers.hpp"
+
+#include "gl_errors.hpp"
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <cassert>
+#include <cctype>
+#include <cstdio>
+
+PassTimers::PassTimers() {
+}
+
+PassTimers::~PassTimers() {
+	for (auto &pass : passes) {
+		glDeleteQueries(Latency, pass.queries);
+	}
+}
+
+void PassTimers::begin(std::string const &name) {
+	assert(!current && "PassTimers passes can't overlap");
+
+	auto f = std::find_if(passes.begin(), passes.end(), [&name](Pass const &pass){ return pass.name == name; });
+	if (f == passes.end()) {
+		passes.emplace_back();
+		f = passes.end() - 1;
+		f->name = name;
+		glGenQueries(Latency, f->queries);
+		for (uint32_t s = 0; s < Latency; ++s) {
+			f->issued[s] = false;
+			f->cpu_ms[s] = 0.0f;
+		}
+	}
+	current = &*f;
+
+	uint32_t slot = frame % Latency;
+	if (!current->issued[slot]) frame_pending[slot] += 1;
+	current->issued[slot] = true;
+	glBeginQuery(GL_TIME_ELAPSED, current->queries[slot]);
+	cpu_begin = std::chrono::high_resolution_clock::now();
+}
+
+void PassTimers::end() {
+	assert(current && "PassTimers::end() without begin()");
+	glEndQuery(GL_TIME_ELAPSED);
+	auto cpu_end = std::chrono::high_resolution_clock::now();
+	current->cpu_ms[frame % Latency] = std::chrono::duration< float, std::milli >(cpu_end - cpu_begin).count();
+	current = nullptr;
+}
+
+void PassTimers::end_frame() {
+	assert(!current && "PassTimers::end_frame() inside a pass");
+	frame += 1;
+
+	//poll every frame still in flight, oldest first; the oldest one's slot is reused by the next frame,
+	// so its results are waited for (only stalls if the GPU is 'Latency - 1' frames behind):
+	for (uint32_t age = Latency; age >= 1; --age) {
+		for (auto &pass : passes) {
+			collect(pass, frame - age, age == Latency);
+		}
+	}
+	GL_ERRORS();
+}
+
+void PassTimers::finish() {
+	assert(!current && "PassTimers::finish() inside a pass");
+	for (uint32_t age = Latency; age >= 1; --age) {
+		for (auto &pass : passes) {
+			collect(pass, frame - age, true);
+		}
+	}
+	GL_ERRORS();
+}
+
+void PassTimers::clear() {
+	for (auto &pass : passes) {
+		pass.gpu_samples.clear();
+		pass.cpu_samples.clear();
+	}
+}
+
+void PassTimers::collect(Pass &pass, uint32_t sample_frame, bool wait) {
+	uint32_t slot = sample_frame % Latency;
+	if (!pass.issued[slot]) return; //(pass didn't run that frame, or was already collected)
+
+	if (!wait) {
+		GLint available = GL_FALSE;
+		glGetQueryObjectiv(pass.queries[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available) return; //not there yet; stays pending for a later frame
+	}
+	pass.issued[slot] = false;
+
+	GLuint64 ns = 0;
+	glGetQueryObjectui64v(pass.queries[slot], GL_QUERY_RESULT, &ns);
+	float gpu_ms = float(ns) * 1e-6f;
+	float cpu_ms = pass.cpu_ms[slot];
+
+	//once every pass of a frame has arrived, it becomes the latest measured frame:
+	assert(frame_pending[slot] > 0);
+	frame_pending_ms[slot] += gpu_ms;
+	frame_pending[slot] -= 1;
+	if (frame_pending[slot] == 0) {
+		frame_gpu_ms = frame_pending_ms[slot];
+		frame_gpu_measured = sample_frame;
+		frame_pending_ms[slot] = 0.0f;
+	}
+
+	if (pass.gpu_samples.empty()) {
+		pass.smooth_gpu_ms = gpu_ms;
+		pass.smooth_cpu_ms = cpu_ms;
+	} else {
+		pass.smooth_gpu_ms += 0.05f * (gpu_ms - pass.smooth_gpu_ms);
+		pass.smooth_cpu_ms += 0.05f * (cpu_ms - pass.smooth_cpu_ms);
+	}
+	pass.gpu_samples.emplace_back(gpu_ms);
+	pass.cpu_samples.emplace_back(cpu_ms);
+
+	if (csv.is_open()) {
+		csv << sample_frame << ',' << pass.name << ',' << gpu_ms << ',' << cpu_ms << '\n';
+		csv_rows += 1;
+		if (csv_rows >= RollRows) {
+			csv.close();
+			std::string old = csv_filename + ".1";
+			std::remove(old.c_str());
+			std::rename(csv_filename.c_str(), old.c_str());
+			open_csv();
+		}
+	}
+}
+
+void PassTimers::log_to(std::string const &filename) {
+	csv_filename = filename;
+	open_csv();
+}
+
+void PassTimers::open_csv() {
+	csv.open(csv_filename, std::ios::binary);
+	if (!csv) {
+		std::cerr << "WARNING: can't write pass timings to '" << csv_filename << "'." << std::endl;
+		return;
+	}
+	csv << "frame,pass,gpu_ms,cpu_ms\n";
+	csv_rows = 0;
+}
+
+std::vector< std::string > PassTimers::overlay() const {
+	//(the text font is upper-case only)
+	auto line = [](std::string name, float gpu_ms, float cpu_ms) {
+		for (auto &c : name) c = char(std::toupper(c));
+		char buffer[64];
+		std::snprintf(buffer, sizeof(buffer), "%-10s %6.2f %6.2f", name.c_str(), gpu_ms, cpu_ms);
+		return std::string(buffer);
+	};
+
+	std::vector< std::string > lines;
+	lines.emplace_back("PASS          GPU    CPU");
+	float total_gpu_ms = 0.0f, total_cpu_ms = 0.0f;
+	for (auto const &pass : passes) {
+		lines.emplace_back(line(pass.name, pass.smooth_gpu_ms, pass.smooth_cpu_ms));
+		total_gpu_ms += pass.smooth_gpu_ms;
+		total_cpu_ms += pass.smooth_cpu_ms;
+	}
+	lines.emplace_back(line("total", total_gpu_ms, total_cpu_ms));
+	return lines;
+}
+
+PassTimers::Summary PassTimers::summarize(std::vector< float > samples) {
+	Summary ret;
+	if (samples.empty()) return ret;
+	std::sort(samples.begin(), samples.end());
+	ret.min = samples[0];
+	ret.median = samples[samples.size() / 2];
+	double sum = 0.0;
+	for (float s : samples) sum += s;
+	ret.avg = float(sum / samples.size());
+	ret.p99 = samples[std::min(samples.size() - 1, (samples.size() * 99 + 99) / 100 - 1)];
+	return ret;
+}
+
+void PassTimers::report(std::ostream &out) const {
+	if (passes.empty()) return;
+
+	out << "Pass timings in ms (min / avg / p99):\n";
+	out << std::fixed << std::setprecision(3);
+	for (auto const &pass : passes) {
+		Summary gpu = summarize(pass.gpu_samples);
+		Summary cpu = summarize(pass.cpu_samples);
+		out << "  " << std::left << std::setw(10) << pass.name << std::right
+			<< " gpu " << std::setw(7) << gpu.min << " / " << std::setw(7) << gpu.avg << " / " << std::setw(7) << gpu.p99
+			<< "   cpu " << std::setw(7) << cpu.min << " / " << std::setw(7) << cpu.avg << " / " << std::setw(7) << cpu.p99
+			<< "   (" << pass.gpu_samples.size() << " frames)\n";
+	}
+	out << std::defaultfloat;
+	out.flush();
+}
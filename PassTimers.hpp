@@ -0,0 +1,83 @@
+#pragma once
+
+#include "GL.hpp"
+
+#include <chrono>
+#include <fstream>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+//"PassTimers" measures how long each render pass takes, both on the GPU (GL_TIME_ELAPSED queries)
+// and on the CPU (wall time spent issuing the pass).
+//Each pass has one query per frame in flight; results are polled every frame and stay pending until
+// they arrive, so a slow GPU delays samples instead of dropping them. Only when a query's slot is about
+// to be reused ('Latency' frames later) is its result waited for.
+// note: GL_TIME_ELAPSED queries can't nest, so passes must not overlap.
+
+struct PassTimers {
+	PassTimers();
+	~PassTimers();
+	PassTimers(PassTimers const &) = delete;
+
+	//bracket a pass (passes are listed in the order they are first seen):
+	void begin(std::string const &name);
+	void end();
+	//call once per frame, after the last pass; collects results from earlier frames:
+	void end_frame();
+	//wait for and collect every outstanding result (e.g., at the end of a benchmark run):
+	void finish();
+	//forget collected samples (e.g., after warming up):
+	void clear();
+
+	//append "frame,pass,gpu_ms,cpu_ms" rows to a CSV file; once it has 'RollRows' rows it is
+	// renamed to filename + ".1" (replacing the previous one) and a new file is started:
+	void log_to(std::string const &filename);
+	enum : uint32_t { RollRows = 100000 };
+
+	//one line per pass (plus a total) with recent average times, for drawing on screen:
+	std::vector< std::string > overlay() const;
+	//min / average / 99th percentile of every sample, per pass:
+	void report(std::ostream &out) const;
+
+	struct Summary {
+		float min = 0.0f, avg = 0.0f, median = 0.0f, p99 = 0.0f;
+	};
+	static Summary summarize(std::vector< float > samples);
+
+	enum : uint32_t { Latency = 4 }; //frames a query may stay pending before its result is waited for
+
+	//GPU time of every pass in the most recent frame whose results all arrived, and that frame's number
+	// (-1U until there is one; compare with 'frame' to see how old it is):
+	float frame_gpu_ms = 0.0f;
+	uint32_t frame_gpu_measured = -1U;
+
+	struct Pass {
+		std::string name;
+		GLuint queries[Latency];
+		bool issued[Latency]; //query was used in that slot's frame
+		float cpu_ms[Latency]; //CPU time from that slot's frame (paired with the query result when it arrives)
+
+		//recent averages (exponentially smoothed, for the overlay):
+		float smooth_gpu_ms = 0.0f;
+		float smooth_cpu_ms = 0.0f;
+
+		//every collected sample (for report()):
+		std::vector< float > gpu_samples;
+		std::vector< float > cpu_samples;
+	};
+	std::vector< Pass > passes;
+
+	//internals:
+	uint32_t frame = 0;
+	uint32_t frame_pending[Latency] = {}; //queries from that slot's frame not yet collected
+	float frame_pending_ms[Latency] = {}; //GPU time of the ones that were
+	Pass *current = nullptr; //pass between begin() and end()
+	std::chrono::high_resolution_clock::time_point cpu_begin;
+	std::string csv_filename;
+	std::ofstream csv;
+	uint32_t csv_rows = 0;
+	void open_csv();
+	void collect(Pass &pass, uint32_t sample_frame, bool wait); //read the query 'pass' issued in frame 'sample_frame', if any
+};
@@ -0,0 +1,146 @@
+#include "Profiler.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <vector>
+
+std::atomic< bool > Profiler::recording_flag{false};
+
+namespace {
+	struct Event {
+		char const *name;
+		uint64_t begin_ns, end_ns;
+	};
+
+	//one per thread that has recorded anything (kept after the thread exits, so its zones still get written):
+	struct Ring {
+		std::mutex mutex; //(only contended while write_trace() copies the ring)
+		std::vector< Event > events;
+		uint64_t written = 0; //total ever recorded; next goes at written % RingSize
+		uint32_t tid = 0;
+		std::string thread_name;
+	};
+
+	std::mutex &registry_mutex() {
+		static std::mutex mutex;
+		return mutex;
+	}
+	std::vector< std::shared_ptr< Ring > > &rings() {
+		static std::vector< std::shared_ptr< Ring > > rings;
+		return rings;
+	}
+
+	Ring &thread_ring() {
+		static thread_local std::shared_ptr< Ring > ring;
+		if (!ring) {
+			ring = std::make_shared< Ring >();
+			std::unique_lock< std::mutex > lock(registry_mutex());
+			ring->tid = uint32_t(rings().size()) + 1;
+			ring->thread_name = "thread " + std::to_string(ring->tid);
+			rings().emplace_back(ring);
+		}
+		return *ring;
+	}
+
+	void write_json_string(std::ostream &out, char const *str) {
+		out << '"';
+		for (char const *c = str; *c; ++c) {
+			if (*c == '"' || *c == '\\') out << '\\' << *c;
+			else if (uint8_t(*c) < 0x20) out << ' ';
+			else out << *c;
+		}
+		out << '"';
+	}
+}
+
+void Profiler::set_recording(bool recording) {
+	recording_flag.store(recording, std::memory_order_relaxed);
+}
+
+uint64_t Profiler::now_ns() {
+	static const auto epoch = std::chrono::steady_clock::now();
+	return uint64_t(std::chrono::duration_cast< std::chrono::nanoseconds >(std::chrono::steady_clock::now() - epoch).count());
+}
+
+void Profiler::record(char const *name, uint64_t begin_ns, uint64_t end_ns) {
+	Ring &ring = thread_ring();
+	std::unique_lock< std::mutex > lock(ring.mutex);
+	if (ring.events.empty()) ring.events.resize(RingSize); //(allocated on first use, so idle threads cost nothing)
+	ring.events[ring.written % RingSize] = Event{name, begin_ns, end_ns};
+	ring.written += 1;
+}
+
+void Profiler::set_thread_name(std::string const &name) {
+	Ring &ring = thread_ring();
+	std::unique_lock< std::mutex > lock(ring.mutex);
+	ring.thread_name = name;
+}
+
+char const *Profiler::intern(std::string const &name) {
+	static std::mutex mutex;
+	static std::set< std::string > names; //(set nodes never move, so c_str() stays valid)
+	std::unique_lock< std::mutex > lock(mutex);
+	return names.insert(name).first->c_str();
+}
+
+bool Profiler::write_trace(std::string const &filename) {
+	//copy the rings out first, so recording threads are only held up for a memcpy:
+	struct Copy {
+		uint32_t tid;
+		std::string thread_name;
+		std::vector< Event > events; //oldest first
+	};
+	std::vector< Copy > copies;
+	{
+		std::unique_lock< std::mutex > lock(registry_mutex());
+		for (auto const &ring : rings()) {
+			std::unique_lock< std::mutex > ring_lock(ring->mutex);
+			copies.emplace_back();
+			Copy &copy = copies.back();
+			copy.tid = ring->tid;
+			copy.thread_name = ring->thread_name;
+			uint64_t count = std::min< uint64_t >(ring->written, RingSize);
+			copy.events.reserve(count);
+			for (uint64_t i = ring->written - count; i < ring->written; ++i) {
+				copy.events.emplace_back(ring->events[i % RingSize]);
+			}
+		}
+	}
+
+	std::ofstream out(filename, std::ios::binary);
+	if (!out) {
+		std::cerr << "WARNING: can't write trace to '" << filename << "'." << std::endl;
+		return false;
+	}
+	out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	bool first = true;
+	size_t total = 0;
+	for (auto const &copy : copies) {
+		out << (first ? "" : ",\n") << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << copy.tid << ",\"args\":{\"name\":";
+		write_json_string(out, copy.thread_name.c_str());
+		out << "}}";
+		first = false;
+		for (auto const &event : copy.events) {
+			//(timestamps are in microseconds)
+			out << ",\n{\"ph\":\"X\",\"pid\":1,\"tid\":" << copy.tid
+				<< ",\"ts\":" << event.begin_ns / 1000 << '.' << (event.begin_ns % 1000) / 100
+				<< ",\"dur\":" << (event.end_ns - event.begin_ns) / 1000 << '.' << ((event.end_ns - event.begin_ns) % 1000) / 100
+				<< ",\"name\":";
+			write_json_string(out, event.name);
+			out << "}";
+		}
+		total += copy.events.size();
+	}
+	out << "\n]}\n";
+	if (!out) {
+		std::cerr << "WARNING: failed writing trace to '" << filename << "'." << std::endl;
+		return false;
+	}
+	std::cout << "Wrote " << total << " zones from " << copies.size() << " threads to '" << filename << "'." << std::endl;
+	return true;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+//"Profiler" records scoped CPU zones, e.g.:
+//   void Scene::draw(...) {
+//       PROFILE_ZONE("Scene::draw");
+//       ...
+//Each thread records into its own ring buffer (the oldest zones are overwritten once it fills),
+// and write_trace() dumps every ring as Chrome trace_event JSON (open in chrome://tracing or ui.perfetto.dev).
+//Zones are only recorded while recording is on; until then a zone costs one relaxed atomic load.
+//Building with -DPROFILER=0 compiles zones out entirely (their names aren't even evaluated).
+//For names built at runtime, PROFILE_ZONE_DYNAMIC only evaluates its argument while recording:
+//   PROFILE_ZONE_DYNAMIC(Profiler::intern("load " + name));
+
+#ifndef PROFILER
+#define PROFILER 1
+#endif
+
+namespace Profiler {
+	//start or stop recording (zones already open when recording starts aren't recorded):
+	void set_recording(bool recording);
+	inline bool recording();
+
+	//write recorded zones from all threads to 'filename'; safe to call while other threads record:
+	// returns false (after a warning) if the file can't be written.
+	bool write_trace(std::string const &filename);
+
+	//name shown for the calling thread in traces (defaults to "thread N"):
+	void set_thread_name(std::string const &name);
+
+	//a copy of 'name' that lives as long as the program, for zone names built at runtime:
+	char const *intern(std::string const &name);
+
+	//zones per thread kept in the ring:
+	enum : uint32_t { RingSize = 1 << 15 };
+
+	//internals:
+	extern std::atomic< bool > recording_flag;
+	uint64_t now_ns();
+	void record(char const *name, uint64_t begin_ns, uint64_t end_ns);
+
+	struct Zone {
+		explicit Zone(char const *name_) : name(recording() ? name_ : nullptr) {
+			if (name) begin_ns = now_ns();
+		}
+		~Zone() {
+			if (name) record(name, begin_ns, now_ns());
+		}
+		Zone(Zone const &) = delete;
+		char const *name;
+		uint64_t begin_ns = 0;
+	};
+}
+
+inline bool Profiler::recording() {
+	return recording_flag.load(std::memory_order_relaxed);
+}
+
+#if PROFILER
+#define PROFILE_ZONE_CONCAT2(A, B) A##B
+#define PROFILE_ZONE_CONCAT(A, B) PROFILE_ZONE_CONCAT2(A, B)
+#define PROFILE_ZONE(NAME) Profiler::Zone PROFILE_ZONE_CONCAT(profile_zone_, __LINE__)(NAME)
+#define PROFILE_ZONE_DYNAMIC(NAME) Profiler::Zone PROFILE_ZONE_CONCAT(profile_zone_, __LINE__)(Profiler::recording() ? (NAME) : nullptr)
+#else
+#define PROFILE_ZONE(NAME) do { } while (0)
+#define PROFILE_ZONE_DYNAMIC(NAME) do { } while (0)
+#endif
@@ -0,0 +1,204 @@
+#include "Resources.hpp"
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <cstdio>
+
+namespace {
+	enum Kind : uint8_t { Texture, Buffer, Host };
+
+	struct Entry {
+		Kind kind;
+		size_t bytes = 0;
+		std::string owner;
+		std::string purpose;
+	};
+
+	struct Registry {
+		std::mutex mutex;
+		std::map< std::pair< Kind, uintptr_t >, Entry > entries;
+		size_t gpu = 0, gpu_peak = 0;
+		size_t host = 0, host_peak = 0;
+		size_t gpu_budget = 0;
+		bool over_budget = false;
+	};
+	Registry &registry() {
+		static Registry registry;
+		return registry;
+	}
+
+	std::string megabytes(size_t bytes) {
+		char buffer[32];
+		std::snprintf(buffer, sizeof(buffer), "%.1f MB", bytes / (1024.0 * 1024.0));
+		return buffer;
+	}
+
+	void set(Kind kind, uintptr_t key, size_t bytes, std::string const &owner, std::string const &purpose) {
+		Registry &r = registry();
+		std::unique_lock< std::mutex > lock(r.mutex);
+		Entry &entry = r.entries[std::make_pair(kind, key)];
+		size_t &total = (kind == Host ? r.host : r.gpu);
+		size_t &peak = (kind == Host ? r.host_peak : r.gpu_peak);
+		total = total - entry.bytes + bytes;
+		peak = std::max(peak, total);
+		entry.kind = kind;
+		entry.bytes = bytes;
+		entry.owner = owner;
+		entry.purpose = purpose;
+
+		if (kind != Host && r.gpu_budget != 0) {
+			if (r.gpu > r.gpu_budget && !r.over_budget) {
+				std::cerr << "WARNING: estimated GPU memory (" << megabytes(r.gpu) << ") is over budget (" << megabytes(r.gpu_budget)
+					<< ") after " << owner << " allocated " << purpose << " (" << megabytes(bytes) << ")." << std::endl;
+			}
+			r.over_budget = (r.gpu > r.gpu_budget);
+		}
+	}
+
+	void forget(Kind kind, uintptr_t key) {
+		Registry &r = registry();
+		std::unique_lock< std::mutex > lock(r.mutex);
+		auto f = r.entries.find(std::make_pair(kind, key));
+		if (f == r.entries.end()) return;
+		(kind == Host ? r.host : r.gpu) -= f->second.bytes;
+		r.entries.erase(f);
+		if (r.gpu <= r.gpu_budget) r.over_budget = false;
+	}
+}
+
+void Resources::track_texture(GLuint tex, std::string const &owner, std::string const &purpose) {
+	GLint old_binding = 0;
+	glGetIntegerv(GL_TEXTURE_BINDING_2D, &old_binding);
+	glBindTexture(GL_TEXTURE_2D, tex);
+
+	//sum every level the texture has (levels past the end report zero size):
+	size_t bytes = 0;
+	GLint width0 = 0, height0 = 0, levels = 0;
+	for (GLint level = 0; level < 32; ++level) {
+		GLint width = 0, height = 0;
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_WIDTH, &width);
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_HEIGHT, &height);
+		if (width == 0 || height == 0) break;
+		if (level == 0) {
+			width0 = width;
+			height0 = height;
+		}
+		levels += 1;
+
+		GLint compressed = GL_FALSE;
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_COMPRESSED, &compressed);
+		if (compressed) {
+			GLint size = 0;
+			glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &size);
+			bytes += size_t(size);
+			continue;
+		}
+		GLint bits = 0;
+		for (GLenum component : {GL_TEXTURE_RED_SIZE, GL_TEXTURE_GREEN_SIZE, GL_TEXTURE_BLUE_SIZE, GL_TEXTURE_ALPHA_SIZE,
+			GL_TEXTURE_DEPTH_SIZE, GL_TEXTURE_STENCIL_SIZE}) {
+			GLint size = 0;
+			glGetTexLevelParameteriv(GL_TEXTURE_2D, level, component, &size);
+			bits += size;
+		}
+		//(drivers store 3-byte texels as 4 bytes, and so on)
+		size_t texel = 1;
+		while (texel * 8 < size_t(bits)) texel *= 2;
+		bytes += size_t(width) * size_t(height) * texel;
+	}
+	glBindTexture(GL_TEXTURE_2D, GLuint(old_binding));
+
+	set(Texture, tex, bytes, owner, purpose + " " + std::to_string(width0) + "x" + std::to_string(height0)
+		+ (levels > 1 ? ", " + std::to_string(levels) + " levels" : ""));
+}
+
+void Resources::track_buffer(GLuint buffer, std::string const &owner, std::string const &purpose) {
+	glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+	GLint64 size = 0;
+	glGetBufferParameteri64v(GL_COPY_READ_BUFFER, GL_BUFFER_SIZE, &size);
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	set(Buffer, buffer, size_t(size), owner, purpose);
+}
+
+void Resources::track_host(void const *key, size_t bytes, std::string const &owner, std::string const &purpose) {
+	set(Host, reinterpret_cast< uintptr_t >(key), bytes, owner, purpose);
+}
+
+void Resources::forget_texture(GLuint tex) {
+	forget(Texture, tex);
+}
+
+void Resources::forget_buffer(GLuint buffer) {
+	forget(Buffer, buffer);
+}
+
+void Resources::forget_host(void const *key) {
+	forget(Host, reinterpret_cast< uintptr_t >(key));
+}
+
+size_t Resources::gpu_bytes() {
+	std::unique_lock< std::mutex > lock(registry().mutex);
+	return registry().gpu;
+}
+
+size_t Resources::gpu_peak_bytes() {
+	std::unique_lock< std::mutex > lock(registry().mutex);
+	return registry().gpu_peak;
+}
+
+size_t Resources::host_bytes() {
+	std::unique_lock< std::mutex > lock(registry().mutex);
+	return registry().host;
+}
+
+size_t Resources::host_peak_bytes() {
+	std::unique_lock< std::mutex > lock(registry().mutex);
+	return registry().host_peak;
+}
+
+void Resources::set_gpu_budget(size_t bytes) {
+	Registry &r = registry();
+	std::unique_lock< std::mutex > lock(r.mutex);
+	r.gpu_budget = bytes;
+	r.over_budget = false;
+}
+
+std::vector< std::string > Resources::overlay() {
+	Registry &r = registry();
+	std::unique_lock< std::mutex > lock(r.mutex);
+	size_t textures = 0, buffers = 0;
+	for (auto const &e : r.entries) {
+		if (e.second.kind == Texture) textures += e.second.bytes;
+		if (e.second.kind == Buffer) buffers += e.second.bytes;
+	}
+	//(the text font is upper-case only)
+	std::vector< std::string > lines;
+	lines.emplace_back("VRAM     " + megabytes(r.gpu) + " PEAK " + megabytes(r.gpu_peak)
+		+ (r.gpu_budget ? " BUDGET " + megabytes(r.gpu_budget) : ""));
+	lines.emplace_back("TEXTURES " + megabytes(textures) + " BUFFERS " + megabytes(buffers));
+	lines.emplace_back("HOST     " + megabytes(r.host) + " PEAK " + megabytes(r.host_peak));
+	return lines;
+}
+
+void Resources::report(std::ostream &out) {
+	Registry &r = registry();
+	std::unique_lock< std::mutex > lock(r.mutex);
+	if (r.entries.empty() && r.gpu_peak == 0 && r.host_peak == 0) return;
+
+	std::vector< Entry const * > sorted;
+	for (auto const &e : r.entries) sorted.emplace_back(&e.second);
+	std::stable_sort(sorted.begin(), sorted.end(), [](Entry const *a, Entry const *b) { return a->bytes > b->bytes; });
+
+	out << "Estimated memory: GPU " << megabytes(r.gpu) << " (peak " << megabytes(r.gpu_peak) << ")";
+	if (r.gpu_budget) out << ", budget " << megabytes(r.gpu_budget);
+	out << "; host " << megabytes(r.host) << " (peak " << megabytes(r.host_peak) << ")\n";
+	for (Entry const *e : sorted) {
+		char const *kind = (e->kind == Texture ? "texture" : e->kind == Buffer ? "buffer" : "host");
+		out << "  " << std::right << std::setw(10) << megabytes(e->bytes) << "  " << std::left << std::setw(8) << kind
+			<< std::setw(12) << e->owner << e->purpose << "\n";
+	}
+	out << std::right;
+	out.flush();
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "GL.hpp"
+
+#include <ostream>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+//"Resources" keeps a registry of every long-lived GL texture and buffer (and large host-side
+// allocations, like mapped asset packs) with its size, who made it, and what it is for, so the
+// totals can be shown (overlay(), report()) and checked against a budget.
+//Sizes are read back from GL when a resource is tracked (width x height x bits per texel, summed over
+// mip levels; buffer sizes), so they are estimates of driver memory: padding and alignment aren't known.
+// e.g.:
+//   glTexImage2D(...);
+//   Resources::track_texture(tex, "GameMode", "color");
+//   ...
+//   Resources::forget_texture(tex);
+//   glDeleteTextures(1, &tex);
+//Call track_*() again after respecifying a resource (e.g., resizing a texture) to update its size.
+// note: call from the thread with the GL context (host tracking is safe from any thread).
+
+namespace Resources {
+	void track_texture(GLuint tex, std::string const &owner, std::string const &purpose); //(GL_TEXTURE_2D only)
+	void track_buffer(GLuint buffer, std::string const &owner, std::string const &purpose);
+	void track_host(void const *key, size_t bytes, std::string const &owner, std::string const &purpose);
+	void forget_texture(GLuint tex);
+	void forget_buffer(GLuint buffer);
+	void forget_host(void const *key);
+
+	//estimated bytes in use now and at most, over textures and buffers ("gpu") or host allocations:
+	size_t gpu_bytes();
+	size_t gpu_peak_bytes();
+	size_t host_bytes();
+	size_t host_peak_bytes();
+
+	//warn (once each time it is crossed) when tracked GPU memory goes over 'bytes' (0 = no budget):
+	void set_gpu_budget(size_t bytes);
+
+	//a few upper-case lines of totals, for drawing on screen (see draw_text):
+	std::vector< std::string > overlay();
+	//totals, peaks, and every tracked resource, largest first:
+	void report(std::ostream &out);
+}
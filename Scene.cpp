@@ -1,11 +1,19 @@
 #include "Scene.hpp"
-#include "read_chunk.hpp"
+#include "ChunkFile.hpp"
+#include "Pack.hpp"
+#include "JobSystem.hpp"
+#include "gl_extensions.hpp"
+#include "Profiler.hpp"
+#include "Resources.hpp"
 
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
 #include <iostream>
 #include <fstream>
+#include <algorithm>
+#include <cstring>
+#include <atomic>
 
 glm::mat4 Scene::Transform::make_local_to_parent() const {
 	return glm::mat4( //translate
@@ -110,7 +118,16 @@ glm::mat4 Scene::Lamp::make_projection() const {
 //---------------------------
 
 glm::mat4 Scene::Camera::make_projection() const {
-	return glm::infinitePerspective( fovy, aspect, near );
+	glm::mat4 projection = glm::infinitePerspective( fovy, aspect, near );
+	if (window == glm::vec4(-1.0f, -1.0f, 1.0f, 1.0f)) return projection;
+	//scale and shift (in clip space) so the window covers [-1,1]x[-1,1]:
+	glm::vec2 lo(window.x, window.y), hi(window.z, window.w);
+	glm::mat4 window_to_ndc(1.0f);
+	window_to_ndc[0][0] = 2.0f / (hi.x - lo.x);
+	window_to_ndc[1][1] = 2.0f / (hi.y - lo.y);
+	window_to_ndc[3][0] = -(hi.x + lo.x) / (hi.x - lo.x);
+	window_to_ndc[3][1] = -(hi.y + lo.y) / (hi.y - lo.y);
+	return window_to_ndc * projection;
 }
 
 //---------------------------
@@ -197,64 +214,580 @@ void Scene::draw(Scene::Lamp const *lamp, Object::ProgramType program_type) cons
 }
 
 
+//sort key for a draw item, from high to low bits:
+//  program id, vao id, texture set id, mesh (start / count / index type) id,
+//  then depth, as an order-preserving integer (sign, exponent, and top of mantissa).
+// Ids are small numbers from Scene::SortIds, so items sharing a program sort together, within
+// those the ones sharing a vao, and so on; sorting on the key is much cheaper than comparing state.
+// Each id field is just wide enough for the ids the Scene has handed out (so different state never
+// shares bits), and depth gets the bits that are left.
+struct SortKeyLayout {
+	uint32_t id_bits[4] = {0, 0, 0, 0}; //program, vao, texture set, mesh
+	uint32_t depth_bits = 0;
+};
+
+//id of 'key' in 'ids', adding it if new:
+template< typename K >
+static uint32_t sort_id(std::map< K, uint32_t > &ids, K const &key) {
+	return ids.emplace(key, uint32_t(ids.size())).first->second;
+}
+
+//ids of the state of 'info': cached in 'info' until its state changes, otherwise handed out under 'mutex'
+// (so safe to call on several threads at once, as long as each has different infos):
+static std::array< uint32_t, 4 > const &state_ids(Scene::SortIds &ids, std::mutex &mutex, Scene::Object::ProgramInfo const &info) {
+	static_assert(Scene::Object::ProgramInfo::TextureCount == 4, "texture sets include all textures");
+	std::array< GLuint, 9 > state{{info.program, info.vao,
+		info.textures[0], info.textures[1], info.textures[2], info.textures[3],
+		info.start, info.count, info.index_type}};
+	if (info.sort_ids_generation == ids.generation && info.sort_state == state) return info.sort_ids;
+
+	std::array< GLuint, 4 > textures{{info.textures[0], info.textures[1], info.textures[2], info.textures[3]}};
+	std::array< GLuint, 3 > mesh{{info.start, info.count, info.index_type}};
+	std::unique_lock< std::mutex > lock(mutex);
+	info.sort_ids = std::array< uint32_t, 4 >{{sort_id(ids.programs, info.program), sort_id(ids.vaos, info.vao),
+		sort_id(ids.texture_sets, textures), sort_id(ids.meshes, mesh)}};
+	info.sort_state = state;
+	info.sort_ids_generation = ids.generation;
+	return info.sort_ids;
+}
+
+static SortKeyLayout make_sort_key_layout(Scene::SortIds const &ids) {
+	auto bits_for = [](size_t count) {
+		uint32_t bits = 0;
+		while (bits < 32 && (size_t(1) << bits) < count) ++bits;
+		return bits;
+	};
+	SortKeyLayout layout;
+	layout.id_bits[0] = bits_for(ids.programs.size());
+	layout.id_bits[1] = bits_for(ids.vaos.size());
+	layout.id_bits[2] = bits_for(ids.texture_sets.size());
+	layout.id_bits[3] = bits_for(ids.meshes.size());
+	uint32_t state_bits = layout.id_bits[0] + layout.id_bits[1] + layout.id_bits[2] + layout.id_bits[3];
+	if (state_bits > 64) {
+		//(would take tens of thousands of distinct programs, vaos, texture sets, *and* meshes)
+		static bool warned = false;
+		if (!warned) {
+			std::cerr << "WARNING: too many different states in one draw for exact sort keys; some will share ids (and batch less)." << std::endl;
+			warned = true;
+		}
+		for (int i = 3; state_bits > 64; --i) {
+			uint32_t cut = std::min(layout.id_bits[i], state_bits - 64);
+			layout.id_bits[i] -= cut;
+			state_bits -= cut;
+		}
+	}
+	layout.depth_bits = std::min(64 - state_bits, 32U);
+	return layout;
+}
+
+//state part of the sort key:
+static uint64_t make_state_key(SortKeyLayout const &layout, std::array< uint32_t, 4 > const &ids) {
+	uint64_t key = 0;
+	for (uint32_t i = 0; i < 4; ++i) {
+		uint32_t bits = layout.id_bits[i];
+		uint64_t max = (bits == 0 ? 0 : (uint64_t(1) << bits) - 1);
+		key = (bits == 0 ? key : (key << bits)) | std::min(uint64_t(ids[i]), max);
+	}
+	return (layout.depth_bits == 0 ? key : key << layout.depth_bits);
+}
+
+static uint64_t make_sort_key(SortKeyLayout const &layout, uint64_t state_key, float depth) {
+	if (layout.depth_bits == 0) return state_key;
+	uint32_t bits;
+	static_assert(sizeof(bits) == sizeof(depth), "float is 32 bits");
+	std::memcpy(&bits, &depth, sizeof(bits));
+	bits = (bits & 0x80000000U) ? ~bits : (bits | 0x80000000U);
+
+	return state_key | uint64_t(bits >> (32 - layout.depth_bits));
+}
+
+bool Scene::multi_draw_supported() {
+	static bool supported = gl_has_extension("GL_ARB_multi_draw_indirect")
+		&& gl_has_extension("GL_ARB_base_instance");
+	return supported;
+}
+
 void Scene::draw(glm::mat4 const &world_to_clip, Object::ProgramType program_type) const {
+	PROFILE_ZONE("Scene::draw");
 	assert(program_type < Object::ProgramTypes);
 
-	for (Scene::Object *object = first_object; object != nullptr; object = object->alloc_next) {
+	draw_stats = DrawStats();
 
-		//don't draw if no program of this type attached to object:
+	//gather objects that have a program of this type:
+	draw_objects.clear();
+	for (Scene::Object *object = first_object; object != nullptr; object = object->alloc_next) {
 		if (object->programs[program_type].program == 0) continue;
+		draw_objects.emplace_back(object);
+	}
+
+	//sort key ids persist between draws; start them over if stale state has piled up:
+	if (sort_ids.generation == 0 || sort_ids.size() > 8 * draw_objects.size() + 64) {
+		static std::atomic< uint32_t > generations(0);
+		sort_ids = SortIds();
+		sort_ids.generation = ++generations;
+	}
+	size_t known_ids = sort_ids.size();
+	SortKeyLayout layout = make_sort_key_layout(sort_ids);
 
-		glm::mat4 local_to_world = object->transform->make_local_to_world();
+	//build draw items (matrices + sort keys) for draw_objects[begin,end):
+	// (only reads the scene -- besides each item's own cached sort ids -- so it is safe to run on several threads at once)
+	auto build_items = [&](uint32_t begin, uint32_t end, std::vector< DrawItem > &out) {
+		for (uint32_t i = begin; i < end; ++i) {
+			Scene::Object *object = draw_objects[i];
 
-		//compute modelview+projection (object space to clip space) matrix for this object:
-		glm::mat4 mvp = world_to_clip * local_to_world;
+			DrawItem item;
+			item.info = &object->programs[program_type];
+			item.order = i;
 
-		//compute modelview (object space to camera local space) matrix for this object:
-		glm::mat4x3 mv = glm::mat4x3(local_to_world);
+			glm::mat4 local_to_world = object->transform->make_local_to_world();
 
-		//NOTE: inverse cancels out transpose unless there is scale involved
-		glm::mat3 itmv = glm::inverse(glm::transpose(glm::mat3(mv)));
+			//mesh positions may be quantized, so decode them as part of the position transform:
+			glm::mat4 mesh_to_world = local_to_world * glm::mat4(
+				glm::vec4(item.info->position_scale.x, 0.0f, 0.0f, 0.0f),
+				glm::vec4(0.0f, item.info->position_scale.y, 0.0f, 0.0f),
+				glm::vec4(0.0f, 0.0f, item.info->position_scale.z, 0.0f),
+				glm::vec4(item.info->position_offset, 1.0f)
+			);
 
-		//set up program uniforms:
-		Object::ProgramInfo const &info = object->programs[program_type];
-		glUseProgram(info.program);
-		if (info.mvp_mat4 != -1U) {
-			glUniformMatrix4fv(info.mvp_mat4, 1, GL_FALSE, glm::value_ptr(mvp));
+			//compute modelview+projection (object space to clip space) matrix for this object:
+			item.mvp = world_to_clip * mesh_to_world;
+
+			//compute modelview (object space to camera local space) matrix for this object:
+			item.mv = glm::mat4x3(mesh_to_world);
+
+			//NOTE: inverse cancels out transpose unless there is scale involved
+			// (normals aren't quantized to the mesh's box, so this uses the unscaled transform)
+			item.itmv = glm::inverse(glm::transpose(glm::mat3(local_to_world)));
+
+			//clip-space w of the object's origin is its distance along the view direction:
+			item.depth = item.mvp[3][3];
+
+			item.key = make_sort_key(layout, make_state_key(layout, state_ids(sort_ids, sort_ids_mutex, *item.info)), item.depth);
+
+			out.emplace_back(item);
 		}
-		if (info.mv_mat4x3 != -1U) {
-			glUniformMatrix4x3fv(info.mv_mat4x3, 1, GL_FALSE, glm::value_ptr(mv));
+	};
+
+	draw_queue.clear();
+	if (draw_objects.size() >= parallel_threshold) {
+		//each thread appends to its own list, which are then concatenated:
+		JobSystem &jobs = JobSystem::shared();
+		thread_queues.resize(jobs.thread_count());
+		for (auto &queue : thread_queues) {
+			queue.clear();
 		}
-		if (info.itmv_mat3 != -1U) {
-			glUniformMatrix3fv(info.itmv_mat3, 1, GL_FALSE, glm::value_ptr(itmv));
+		jobs.parallel_for(uint32_t(draw_objects.size()), 128, [&](uint32_t begin, uint32_t end) {
+			build_items(begin, end, thread_queues[JobSystem::thread_index()]);
+		});
+		for (auto const &queue : thread_queues) {
+			draw_queue.insert(draw_queue.end(), queue.begin(), queue.end());
 		}
+	} else {
+		build_items(0, uint32_t(draw_objects.size()), draw_queue);
+	}
+	if (sort_ids.size() != known_ids) {
+		//new state showed up, so the id fields may need to be wider; key again with the cached ids:
+		layout = make_sort_key_layout(sort_ids);
+		for (auto &item : draw_queue) {
+			item.key = make_sort_key(layout, make_state_key(layout, item.info->sort_ids), item.depth);
+		}
+	}
+
+	//sort so that objects sharing state (and mesh) are adjacent, front-to-back within a group:
+	std::sort(draw_queue.begin(), draw_queue.end(), [](DrawItem const &a, DrawItem const &b) {
+		if (a.key != b.key) return a.key < b.key;
+		return a.order < b.order;
+	});
+
+	//submit in batches small enough that every batch's instance transforms fit the buffer texture:
+	uint32_t batch = max_instance_batch();
+	for (uint32_t begin = 0; begin < draw_queue.size(); begin += batch) {
+		submit(begin, std::min(uint32_t(draw_queue.size()), begin + batch));
+	}
+}
+
+//the whole instance stream (every region) is one buffer texture, which GL 3.3 only promises can be
+// 65536 texels long; this is how many objects a region can hold without going past the real limit:
+uint32_t Scene::max_instance_batch() {
+	static uint32_t limit = [](){
+		GLint max_texels = 0;
+		glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &max_texels);
+		max_texels = std::max(max_texels, 65536);
+		const uint32_t Regions = 3; //(StreamBuffer's default, as used for instance_stream)
+		const uint32_t Texels = sizeof(InstanceTransforms) / (4 * 4); //RGBA32F texels per object
+		return uint32_t(max_texels) / Regions / Texels;
+	}();
+	return limit;
+}
+
+//draw draw_queue[queue_begin,queue_end), which must not need more than max_instance_batch() instance transforms:
+void Scene::submit(uint32_t queue_begin, uint32_t queue_end) const {
+	assert(queue_end - queue_begin <= max_instance_batch());
+
+	//split the queue into runs of objects that could be drawn with one instanced call:
+	auto same_batch = [](Object::ProgramInfo const &a, Object::ProgramInfo const &b) {
+		if (a.set_uniforms || b.set_uniforms) return false; //per-object uniforms can't be batched
+		if (a.program != b.program || a.vao != b.vao || a.start != b.start || a.count != b.count) return false;
+		if (a.index_type != b.index_type) return false;
+		for (uint32_t i = 0; i < Object::ProgramInfo::TextureCount; ++i) {
+			if (a.textures[i] != b.textures[i]) return false;
+		}
+		return true;
+	};
 
-		if (info.set_uniforms) info.set_uniforms();
+	draw_runs.clear();
+	uint32_t instance_count = 0; //entries needed in instance_transforms
+	for (uint32_t begin = queue_begin; begin < queue_end; /* later */) {
+		uint32_t end = begin + 1;
+		while (end < queue_end && same_batch(*draw_queue[begin].info, *draw_queue[end].info)) {
+			++end;
+		}
+		DrawRun run;
+		run.begin = begin;
+		run.end = end;
+		if (draw_queue[begin].info->instance_base_int != -1U) {
+			run.instance_base = GLint(instance_count);
+			run.instanced = (end - begin >= instancing_threshold);
+			for (uint32_t i = begin; i < end; ++i) {
+				draw_queue[i].instance = GLint(instance_count++);
+			}
+		}
+		draw_runs.emplace_back(run);
+		begin = end;
+	}
+
+	//merge runs that differ only in mesh into multi-draw batches, and write their commands:
+	uint32_t command_count = 0;
+	if (multi_draw && multi_draw_supported()) {
+		auto multi_drawable = [this](DrawRun const &run) {
+			Object::ProgramInfo const &info = *draw_queue[run.begin].info;
+			return run.instance_base >= 0 && info.object_index_attrib != -1U && !info.set_uniforms;
+		};
+		auto same_state = [](Object::ProgramInfo const &a, Object::ProgramInfo const &b) {
+			if (a.program != b.program || a.vao != b.vao || a.index_type != b.index_type) return false;
+			for (uint32_t i = 0; i < Object::ProgramInfo::TextureCount; ++i) {
+				if (a.textures[i] != b.textures[i]) return false;
+			}
+			return true;
+		};
+		for (uint32_t r = 0; r < draw_runs.size(); /* later */) {
+			uint32_t e = r + 1;
+			if (multi_drawable(draw_runs[r])) {
+				Object::ProgramInfo const &info = *draw_queue[draw_runs[r].begin].info;
+				while (e < draw_runs.size() && multi_drawable(draw_runs[e])
+					&& same_state(info, *draw_queue[draw_runs[e].begin].info)) {
+					++e;
+				}
+			}
+			//(a lone run is just as well off with the plain instanced/non-instanced path)
+			if (e - r >= 2) {
+				draw_runs[r].multi_count = e - r;
+				command_count += e - r;
+			}
+			r = e;
+		}
+	}
+	if (command_count) {
+		if (!indirect_stream) {
+			indirect_stream.reset(new StreamBuffer(GL_DRAW_INDIRECT_BUFFER, 256 * sizeof(DrawElementsIndirectCommand)));
+		}
+		//(commands are arrays- or elements-style depending on the batch, so size for the larger)
+		char *out = reinterpret_cast< char * >(
+			indirect_stream->map(command_count * sizeof(DrawElementsIndirectCommand))
+		);
+		GLintptr written = 0; //bytes
+		for (uint32_t r = 0; r < draw_runs.size(); ++r) {
+			DrawRun &run = draw_runs[r];
+			if (run.multi_count == 0) continue;
+			run.indirect = indirect_stream->offset + written;
+			for (uint32_t m = r; m < r + run.multi_count; ++m) {
+				DrawRun const &member = draw_runs[m];
+				Object::ProgramInfo const &info = *draw_queue[member.begin].info;
+				//ObjectIndex for each command's instances starts at the (region-relative) index of its first object:
+				if (info.index_type) {
+					DrawElementsIndirectCommand command;
+					command.count = info.count;
+					command.instance_count = member.end - member.begin;
+					command.first_index = info.start;
+					command.base_vertex = 0;
+					command.base_instance = GLuint(member.instance_base);
+					std::memcpy(out + written, &command, sizeof(command));
+					written += sizeof(command);
+				} else {
+					DrawArraysIndirectCommand command;
+					command.count = info.count;
+					command.instance_count = member.end - member.begin;
+					command.first = info.start;
+					command.base_instance = GLuint(member.instance_base);
+					std::memcpy(out + written, &command, sizeof(command));
+					written += sizeof(command);
+				}
+			}
+			r += run.multi_count - 1;
+		}
+		assert(written <= GLintptr(command_count * sizeof(DrawElementsIndirectCommand)));
+		indirect_stream->unmap();
+		draw_stats.uploads += 2;
+	}
+
+	//write per-object transforms into this frame's region of the instance stream:
+	GLint region_base = 0; //index of the region's first entry in instance_transforms
+	if (instance_count) {
+		if (!instance_stream) {
+			uint32_t limit = max_instance_batch();
+			instance_stream.reset(new StreamBuffer(GL_TEXTURE_BUFFER, std::min(256U, limit) * sizeof(InstanceTransforms)));
+			instance_stream->max_region_size = limit * sizeof(InstanceTransforms);
+		}
+		InstanceTransforms *out = reinterpret_cast< InstanceTransforms * >(
+			instance_stream->map(instance_count * sizeof(InstanceTransforms))
+		);
+		auto write_transforms = [&](uint32_t begin, uint32_t end) {
+			for (uint32_t i = begin; i < end; ++i) {
+				DrawItem const &item = draw_queue[i];
+				if (item.instance < 0) continue;
+				InstanceTransforms &it = out[item.instance];
+				it.mvp = item.mvp;
+				it.mv_rows = glm::transpose(item.mv);
+				it.itmv = glm::mat3x4(item.itmv);
+			}
+		};
+		if (queue_end - queue_begin >= parallel_threshold) {
+			JobSystem::shared().parallel_for(queue_end - queue_begin, 256, [&](uint32_t begin, uint32_t end) {
+				write_transforms(queue_begin + begin, queue_begin + end);
+			});
+		} else {
+			write_transforms(queue_begin, queue_end);
+		}
+		instance_stream->unmap();
+		draw_stats.uploads += 2;
+
+		//region offset, in entries, is added to every run's base:
+		assert(instance_stream->offset % sizeof(InstanceTransforms) == 0);
+		region_base = GLint(instance_stream->offset / sizeof(InstanceTransforms));
+		for (auto &run : draw_runs) {
+			if (run.instance_base >= 0) run.instance_base += region_base;
+		}
+
+		//(re)attach buffer texture if the stream was (re)allocated:
+		if (instance_tex == 0) glGenTextures(1, &instance_tex);
+		if (instance_tex_allocation != instance_stream->allocations) {
+			glBindTexture(GL_TEXTURE_BUFFER, instance_tex);
+			glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, instance_stream->buffer);
+			glBindTexture(GL_TEXTURE_BUFFER, 0);
+			instance_tex_allocation = instance_stream->allocations;
+		}
+
+		//grow the ObjectIndex identity buffer to cover every object drawn this frame:
+		// (re-specifying the same buffer name keeps vaos that already point at it valid)
+		if (object_index_count < instance_count) {
+			object_index_count = std::max(instance_count, std::max(2 * object_index_count, 256U));
+			std::vector< GLuint > indices(object_index_count);
+			for (uint32_t i = 0; i < object_index_count; ++i) {
+				indices[i] = i;
+			}
+			if (object_index_buffer == 0) glGenBuffers(1, &object_index_buffer);
+			glBindBuffer(GL_ARRAY_BUFFER, object_index_buffer);
+			glBufferData(GL_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
+			glBindBuffer(GL_ARRAY_BUFFER, 0);
+			Resources::track_buffer(object_index_buffer, "Scene", "ObjectIndex identity");
+		}
+	}
+
+	//submit, only sending state that differs from what is already bound:
+	// (-1U means "unknown", so the first use of each piece of state is always sent)
+	GLuint bound_program = -1U;
+	GLuint bound_vao = -1U;
+	GLuint active_unit = -1U;
+	GLuint bound_textures[Object::ProgramInfo::TextureCount];
+	for (uint32_t i = 0; i < Object::ProgramInfo::TextureCount; ++i) {
+		bound_textures[i] = -1U;
+	}
+	GLint bound_instance_base = -2; //value of the current program's instance_base uniform (-2 is "unknown")
+	bool bound_instance_tex = false;
+	bool bound_indirect = false;
+
+	auto set_active_unit = [&](GLuint unit) {
+		if (active_unit != unit) {
+			glActiveTexture(GL_TEXTURE0 + unit);
+			active_unit = unit;
+			draw_stats.active_textures += 1;
+		}
+	};
+
+	//byte offset of an indexed mesh's first index in the element buffer:
+	auto index_offset = [](Object::ProgramInfo const &info) {
+		return (GLbyte *)0 + info.start * (info.index_type == GL_UNSIGNED_SHORT ? 2 : 4);
+	};
+
+	for (uint32_t r = 0; r < draw_runs.size(); ++r) {
+		DrawRun const &run = draw_runs[r];
+		Object::ProgramInfo const &info = *draw_queue[run.begin].info;
+
+		if (info.program != bound_program) {
+			glUseProgram(info.program);
+			bound_program = info.program;
+			bound_instance_base = -2;
+			draw_stats.programs += 1;
+		}
 
 		//set up program textures:
 		for (uint32_t i = 0; i < Object::ProgramInfo::TextureCount; ++i) {
-			if (info.textures[i] != 0) {
-				glActiveTexture(GL_TEXTURE0 + i);
+			if (info.textures[i] != 0 && info.textures[i] != bound_textures[i]) {
+				set_active_unit(i);
 				glBindTexture(GL_TEXTURE_2D, info.textures[i]);
+				bound_textures[i] = info.textures[i];
+				draw_stats.textures += 1;
+			}
+		}
+
+		if (info.vao != bound_vao) {
+			glBindVertexArray(info.vao);
+			bound_vao = info.vao;
+			draw_stats.vaos += 1;
+
+			//first time this vao is drawn, point its ObjectIndex attribute at the identity buffer:
+			if (info.object_index_attrib != -1U && object_index_buffer != 0 && !object_index_vaos.count(info.vao)) {
+				glBindBuffer(GL_ARRAY_BUFFER, object_index_buffer);
+				glVertexAttribIPointer(info.object_index_attrib, 1, GL_UNSIGNED_INT, 0, (GLbyte *)0);
+				glVertexAttribDivisor(info.object_index_attrib, 1);
+				glEnableVertexAttribArray(info.object_index_attrib);
+				glBindBuffer(GL_ARRAY_BUFFER, 0);
+				object_index_vaos.insert(info.vao);
+			}
+		}
+
+		if (run.instance_base >= 0 && !bound_instance_tex) {
+			set_active_unit(Object::ProgramInfo::InstanceTextureUnit);
+			glBindTexture(GL_TEXTURE_BUFFER, instance_tex);
+			bound_instance_tex = true;
+			draw_stats.textures += 1;
+		}
+
+		if (run.multi_count) {
+			//draw this run and the next multi_count-1 with one call; each command's baseInstance
+			// offsets ObjectIndex, so instance_base only needs to hold the region's base:
+			if (!bound_indirect) {
+				glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirect_stream->buffer);
+				bound_indirect = true;
+			}
+			if (bound_instance_base != region_base) {
+				glUniform1i(info.instance_base_int, region_base);
+				bound_instance_base = region_base;
+				draw_stats.uniforms += 1;
+			}
+			if (info.index_type) {
+				glMultiDrawElementsIndirect(GL_TRIANGLES, info.index_type, (GLbyte *)0 + run.indirect, run.multi_count, 0);
+			} else {
+				glMultiDrawArraysIndirect(GL_TRIANGLES, (GLbyte *)0 + run.indirect, run.multi_count, 0);
+			}
+			for (uint32_t m = r; m < r + run.multi_count; ++m) {
+				draw_stats.objects += draw_runs[m].end - draw_runs[m].begin;
+				draw_stats.instanced += draw_runs[m].end - draw_runs[m].begin;
 			}
+			draw_stats.draws += 1;
+			draw_stats.multi_draws += 1;
+			r += run.multi_count - 1;
+			continue;
 		}
 
-		glBindVertexArray(info.vao);
+		if (run.instanced) {
+			//draw the whole run at once, transforms come from instance_transforms:
+			if (bound_instance_base != run.instance_base) {
+				glUniform1i(info.instance_base_int, run.instance_base);
+				bound_instance_base = run.instance_base;
+				draw_stats.uniforms += 1;
+			}
+			if (info.index_type) {
+				glDrawElementsInstanced(GL_TRIANGLES, info.count, info.index_type, index_offset(info), run.end - run.begin);
+			} else {
+				glDrawArraysInstanced(GL_TRIANGLES, info.start, info.count, run.end - run.begin);
+			}
+			draw_stats.objects += run.end - run.begin;
+			draw_stats.instanced += run.end - run.begin;
+			draw_stats.draws += 1;
+			continue;
+		}
+
+		//otherwise, draw objects one at a time:
+		for (uint32_t i = run.begin; i < run.end; ++i) {
+			DrawItem const &item = draw_queue[i];
+			if (run.instance_base >= 0) {
+				//transforms come from instance_transforms, indexed by instance_base:
+				GLint index = run.instance_base + GLint(i - run.begin);
+				if (bound_instance_base != index) {
+					glUniform1i(info.instance_base_int, index);
+					bound_instance_base = index;
+					draw_stats.uniforms += 1;
+				}
+			} else {
+				//transforms are sent as uniforms:
+				if (info.mvp_mat4 != -1U) {
+					glUniformMatrix4fv(info.mvp_mat4, 1, GL_FALSE, glm::value_ptr(item.mvp));
+					draw_stats.uniforms += 1;
+				}
+				if (info.mv_mat4x3 != -1U) {
+					glUniformMatrix4x3fv(info.mv_mat4x3, 1, GL_FALSE, glm::value_ptr(item.mv));
+					draw_stats.uniforms += 1;
+				}
+				if (info.itmv_mat3 != -1U) {
+					glUniformMatrix3fv(info.itmv_mat3, 1, GL_FALSE, glm::value_ptr(item.itmv));
+					draw_stats.uniforms += 1;
+				}
+			}
+
+			if (item.info->set_uniforms) item.info->set_uniforms();
 
-		//draw the object:
-		glDrawArrays(GL_TRIANGLES, info.start, info.count);
+			//draw the object:
+			if (info.index_type) {
+				glDrawElements(GL_TRIANGLES, info.count, info.index_type, index_offset(info));
+			} else {
+				glDrawArrays(GL_TRIANGLES, info.start, info.count);
+			}
+			draw_stats.objects += 1;
+			draw_stats.draws += 1;
+		}
+	}
+
+	//the instance stream region can be reused once the GPU is done with these draws:
+	if (instance_count) {
+		instance_stream->fence();
+	}
+	if (command_count) {
+		indirect_stream->fence();
+	}
+	if (bound_indirect) {
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
 	}
 
 	//unbind any still bound textures and go back to active texture unit zero:
 	for (uint32_t i = 0; i < Object::ProgramInfo::TextureCount; ++i) {
-		glActiveTexture(GL_TEXTURE0 + i);
+		if (bound_textures[i] == -1U) continue;
+		set_active_unit(i);
 		glBindTexture(GL_TEXTURE_2D, 0);
+		draw_stats.textures += 1;
+	}
+	if (bound_instance_tex) {
+		set_active_unit(Object::ProgramInfo::InstanceTextureUnit);
+		glBindTexture(GL_TEXTURE_BUFFER, 0);
+		draw_stats.textures += 1;
+	}
+	if (active_unit != -1U) {
+		set_active_unit(0);
 	}
-	glActiveTexture(GL_TEXTURE0);
 }
 
-
 Scene::~Scene() {
+	if (instance_tex != 0) {
+		glDeleteTextures(1, &instance_tex);
+		instance_tex = 0;
+	}
+	instance_stream.reset();
+	indirect_stream.reset();
+	if (object_index_buffer != 0) {
+		Resources::forget_buffer(object_index_buffer);
+		glDeleteBuffers(1, &object_index_buffer);
+		object_index_buffer = 0;
+	}
 	while (first_camera) {
 		delete_camera(first_camera);
 	}
@@ -268,11 +801,21 @@ Scene::~Scene() {
 
 void Scene::load(std::string const &filename,
 	std::function< void(Scene &, Transform *, std::string const &) > const &on_object) {
+	load(open_file_asset(filename), on_object);
+}
+
+void Scene::load(Asset const &asset,
+	std::function< void(Scene &, Transform *, std::string const &) > const &on_object) {
+	PROFILE_ZONE("Scene::load");
 
-	std::ifstream file(filename, std::ios::binary);
+	std::string const &filename = asset.name;
+
+	//chunks are copied out of the mapping (scene files are small and not aligned for in-place access):
+	// (chunks this version doesn't know about are skipped)
+	ChunkFile chunks(asset.begin(), asset.end(), filename);
 
 	std::vector< char > names;
-	read_chunk(file, "str0", &names);
+	chunks.read("str0", &names);
 
 	struct HierarchyEntry {
 		uint32_t parent;
@@ -284,7 +827,7 @@ void Scene::load(std::string const &filename,
 	};
 	static_assert(sizeof(HierarchyEntry) == 4 + 4 + 4 + 4*3 + 4*4 + 4*3, "HierarchyEntry is packed.");
 	std::vector< HierarchyEntry > hierarchy;
-	read_chunk(file, "xfh0", &hierarchy);
+	chunks.read("xfh0", &hierarchy);
 
 	struct MeshEntry {
 		uint32_t transform;
@@ -293,7 +836,7 @@ void Scene::load(std::string const &filename,
 	};
 	static_assert(sizeof(MeshEntry) == 4 + 4 + 4, "MeshEntry is packed.");
 	std::vector< MeshEntry > meshes;
-	read_chunk(file, "msh0", &meshes);
+	chunks.read("msh0", &meshes);
 
 	struct CameraEntry {
 		uint32_t transform;
@@ -303,7 +846,7 @@ void Scene::load(std::string const &filename,
 	};
 	static_assert(sizeof(CameraEntry) == 4 + 4 + 4 + 4 + 4, "CameraEntry is packed.");
 	std::vector< CameraEntry > cameras;
-	read_chunk(file, "cam0", &cameras);
+	chunks.read("cam0", &cameras);
 
 	struct LightEntry {
 		uint32_t transform;
@@ -315,11 +858,7 @@ void Scene::load(std::string const &filename,
 	};
 	static_assert(sizeof(LightEntry) == 4 + 1 + 3 + 4 + 4 + 4, "LightEntry is packed.");
 	std::vector< LightEntry > lamps;
-	read_chunk(file, "lmp0", &lamps);
-
-	if (file.peek() != EOF) {
-		std::cerr << "WARNING: trailing data in scene file '" << filename << "'" << std::endl;
-	}
+	chunks.read("lmp0", &lamps);
 
 	//--------------------------------
 	//Now that file is loaded, create transforms for hierarchy entries:
@@ -1,15 +1,23 @@
 #pragma once
 
 #include "GL.hpp"
+#include "StreamBuffer.hpp"
 
 #include <glm/glm.hpp>
 #include <glm/gtc/quaternion.hpp>
 
 #include <vector>
 #include <list>
+#include <map>
+#include <set>
+#include <array>
 #include <functional>
+#include <memory>
+#include <mutex>
 #include <string>
 
+struct Asset;
+
 //"Scene" manages a hierarchy of transformations with, potentially, attached information.
 struct Scene {
 
@@ -78,16 +86,29 @@ struct Scene {
 			GLuint vao = 0;
 			GLuint start = 0;
 			GLuint count = 0;
+			GLenum index_type = 0; //if nonzero (GL_UNSIGNED_SHORT / GL_UNSIGNED_INT), start/count are a range in the vao's element buffer
+			//quantized meshes store positions relative to their bounding box; this is folded into the position matrices (not the normal matrix):
+			glm::vec3 position_offset = glm::vec3(0.0f);
+			glm::vec3 position_scale = glm::vec3(1.0f);
+			GLuint object_index_attrib = -1U; //location of the (uint) per-instance 'ObjectIndex' attribute; Scene::draw points it at an identity buffer so that, combined with baseInstance, each multi-draw command can find its objects' transforms
 
 			//uniforms:
 			GLuint mvp_mat4 = -1U; //uniform index for object-to-clip matrix (mat4)
 			GLuint mv_mat4x3 = -1U; //uniform index for model-to-lighting-space matrix (mat4x3)
 			GLuint itmv_mat3 = -1U; //uniform index for normal-to-lighting-space matrix (mat3)
+			GLuint instance_base_int = -1U; //uniform index for first entry in Scene's instance_transforms (int); programs with this read transforms from there instead of the three matrix uniforms above, and can be drawn instanced
 			std::function< void() > set_uniforms; //(optional) function to set additional uniforms
 
 			//textures:
 			enum : uint32_t { TextureCount = 4 };
 			GLuint textures[TextureCount] = {0,0,0,0}; //textures to bind
+			//instance transforms are bound as a buffer texture on the unit after the above:
+			enum : uint32_t { InstanceTextureUnit = TextureCount };
+
+			//used by Scene::draw to cache this state's sort key ids (recomputed when the state changes):
+			mutable uint32_t sort_ids_generation = 0; //SortIds::generation the ids are from (0: none)
+			mutable std::array< uint32_t, 4 > sort_ids; //program, vao, texture set, mesh
+			mutable std::array< GLuint, 9 > sort_state; //program, vao, textures, start, count, index type the ids are for
 		} programs[ProgramTypes];
 
 		//used by Scene to manage allocation:
@@ -140,6 +161,9 @@ struct Scene {
 		float fovy = glm::radians(60.0f); //vertical fov (in radians)
 		float aspect = 1.0f; //x / y
 		float near = 0.01f; //near plane
+		//part of the view that fills the viewport, as (min.x, min.y, max.x, max.y) in normalized device coordinates:
+		// (all of it by default; a tile of a bigger picture is an off-center window into it)
+		glm::vec4 window = glm::vec4(-1.0f, -1.0f, 1.0f, 1.0f);
 		//computed from the above:
 		glm::mat4 make_projection() const;
 
@@ -189,10 +213,117 @@ struct Scene {
 	void draw(Lamp const *lamp, Object::ProgramType = Object::ProgramTypeDefault ) const;
 
 	//More general draw function. Will render with a specified projection transformation and use programs in the given slot of all objects:
+	// (objects are gathered into a queue, sorted by program / vao / textures / mesh / depth, and submitted with redundant state changes filtered out)
 	void draw(
 		glm::mat4 const &world_to_clip,
 		Object::ProgramType program_type) const;
 
+	//counts of OpenGL calls issued by the most recent draw():
+	struct DrawStats {
+		uint32_t objects = 0; //objects submitted
+		uint32_t instanced = 0; //objects drawn as part of an instanced draw
+		uint32_t draws = 0; //glDraw{Arrays,Elements}[Instanced] / glMultiDraw{Arrays,Elements}Indirect
+		uint32_t multi_draws = 0; //(of which glMultiDraw*Indirect)
+		uint32_t programs = 0; //glUseProgram
+		uint32_t active_textures = 0; //glActiveTexture
+		uint32_t textures = 0; //glBindTexture
+		uint32_t vaos = 0; //glBindVertexArray
+		uint32_t uniforms = 0; //glUniform*
+		uint32_t uploads = 0; //map / unmap of instance transforms and indirect commands
+		uint32_t calls() const {
+			return draws + programs + active_textures + textures + vaos + uniforms + uploads;
+		}
+	};
+	mutable DrawStats draw_stats;
+
+	//render queue entry built by draw():
+	struct DrawItem {
+		Object::ProgramInfo const *info = nullptr;
+		float depth = 0.0f; //clip-space w of object origin, used to sort front-to-back
+		uint64_t key = 0; //state ids (high bits) + depth (low bits); sorting on this groups batchable items
+		uint32_t order = 0; //position in object list, breaks ties so the sort doesn't depend on thread timing
+		GLint instance = -1; //entry in instance_transforms
+		glm::mat4 mvp;
+		glm::mat4x3 mv;
+		glm::mat3 itmv;
+	};
+	//adjacent queue entries that share mesh + state, drawn together:
+	struct DrawRun {
+		uint32_t begin = 0, end = 0; //range in draw_queue
+		GLint instance_base = -1; //index of first entry in instance_transforms, or -1 if program doesn't read them
+		bool instanced = false; //draw the whole run with one instanced call?
+		uint32_t multi_count = 0; //if nonzero, this and the following multi_count-1 runs are drawn with one glMultiDraw*Indirect call
+		GLintptr indirect = 0; //byte offset of the first command for that call in indirect_stream
+	};
+	//(kept around between frames to avoid reallocating)
+	mutable std::vector< DrawItem > draw_queue;
+	mutable std::vector< DrawRun > draw_runs;
+	mutable std::vector< Object * > draw_objects; //objects with a program of the type being drawn
+	mutable std::vector< std::vector< DrawItem > > thread_queues; //per-JobSystem-thread command lists
+	//small ids for the state in sort keys; kept between draws (ProgramInfos cache theirs), and
+	// started over, with a new generation, once they hold many more states than are being drawn:
+	struct SortIds {
+		std::map< GLuint, uint32_t > programs;
+		std::map< GLuint, uint32_t > vaos;
+		std::map< std::array< GLuint, 4 >, uint32_t > texture_sets;
+		std::map< std::array< GLuint, 3 >, uint32_t > meshes; //start, count, index type
+		uint32_t generation = 0; //unique across Scenes, so ids cached in a copied ProgramInfo aren't mistaken for this Scene's
+		size_t size() const { return programs.size() + vaos.size() + texture_sets.size() + meshes.size(); }
+	};
+	mutable SortIds sort_ids;
+	mutable std::mutex sort_ids_mutex; //(ids for new state are handed out while building draw items on several threads)
+
+	//Scenes with at least this many drawn objects build their draw items (matrices, sort keys)
+	// and write instance transforms on the JobSystem's threads; smaller scenes aren't worth the handoff:
+	uint32_t parallel_threshold = 512;
+
+	//Runs of at least this many objects sharing mesh, program, and textures are drawn with one
+	// glDraw{Arrays,Elements}Instanced call (if their program has an instance_base_int uniform):
+	uint32_t instancing_threshold = 4;
+
+	//Neighbouring runs that share program, vao, and textures but not mesh are drawn with one
+	// glMultiDraw{Arrays,Elements}Indirect call (if the context supports GL_ARB_multi_draw_indirect and
+	// GL_ARB_base_instance, and the program has an object_index_attrib):
+	bool multi_draw = true;
+	static bool multi_draw_supported();
+
+	//layouts of glMultiDrawArraysIndirect / glMultiDrawElementsIndirect commands:
+	struct DrawArraysIndirectCommand {
+		GLuint count;
+		GLuint instance_count;
+		GLuint first;
+		GLuint base_instance;
+	};
+	static_assert(sizeof(DrawArraysIndirectCommand) == 16, "DrawArraysIndirectCommand is packed.");
+	struct DrawElementsIndirectCommand {
+		GLuint count;
+		GLuint instance_count;
+		GLuint first_index;
+		GLint base_vertex;
+		GLuint base_instance;
+	};
+	static_assert(sizeof(DrawElementsIndirectCommand) == 20, "DrawElementsIndirectCommand is packed.");
+	mutable std::unique_ptr< StreamBuffer > indirect_stream;
+
+	//identity buffer (0, 1, 2, ...) sourced by 'ObjectIndex' attributes:
+	mutable GLuint object_index_buffer = 0;
+	mutable uint32_t object_index_count = 0;
+	mutable std::set< GLuint > object_index_vaos; //vaos that already have ObjectIndex set up
+
+	//per-object matrices, as read by shaders from the instance_transforms buffer texture:
+	// (ten RGBA32F texels per object; written straight into a ring-buffered StreamBuffer every frame)
+	struct InstanceTransforms {
+		glm::mat4 mvp; //object-to-clip
+		glm::mat3x4 mv_rows; //rows of the object-to-light mat4x3 (i.e., its transpose)
+		glm::mat3x4 itmv; //columns of the normal-to-light mat3 (w unused)
+	};
+	static_assert(sizeof(InstanceTransforms) == 10 * 4 * 4, "InstanceTransforms is packed.");
+	mutable std::unique_ptr< StreamBuffer > instance_stream;
+	static uint32_t max_instance_batch(); //most objects one submit() may draw, so instance_stream stays within GL_MAX_TEXTURE_BUFFER_SIZE
+	void submit(uint32_t queue_begin, uint32_t queue_end) const; //(second half of draw(): runs, uploads, and draws for part of draw_queue)
+	mutable GLuint instance_tex = 0; //GL_TEXTURE_BUFFER view of instance_stream
+	mutable uint32_t instance_tex_allocation = 0; //instance_stream->allocations when instance_tex was attached
+
 	~Scene(); //destructor deallocates transforms, objects, cameras
 
 	//add transforms/objects/cameras from a scene file:
@@ -200,4 +331,8 @@ struct Scene {
 	void load(std::string const &filename,
 		std::function< void(Scene &, Transform *, std::string const &) > const &on_object = nullptr
 	);
+	//...or from an asset, in a pack or not (see Pack.hpp):
+	void load(Asset const &asset,
+		std::function< void(Scene &, Transform *, std::string const &) > const &on_object = nullptr
+	);
 };
@@ -0,0 +1,128 @@
+#include "StreamBuffer.hpp"
+#include "gl_extensions.hpp"
+#include "Resources.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+#include <iostream>
+
+StreamBuffer::StreamBuffer(GLenum target_, GLsizeiptr region_size_, uint32_t regions_) : target(target_), regions(regions_) {
+	assert(regions >= 1 && regions <= sizeof(fences) / sizeof(fences[0]));
+	persistent = gl_has_extension("GL_ARB_buffer_storage");
+	allocate(region_size_);
+}
+
+StreamBuffer::~StreamBuffer() {
+	for (auto &f : fences) {
+		if (f) glDeleteSync(f);
+		f = 0;
+	}
+	if (buffer) {
+		if (persistent_ptr) {
+			glBindBuffer(target, buffer);
+			glUnmapBuffer(target);
+			glBindBuffer(target, 0);
+			persistent_ptr = nullptr;
+		}
+		Resources::forget_buffer(buffer);
+		glDeleteBuffers(1, &buffer);
+		buffer = 0;
+	}
+}
+
+void StreamBuffer::allocate(GLsizeiptr region_size_) {
+	//wait for the GPU to finish with the old buffer before throwing it away:
+	for (auto &f : fences) {
+		if (f) {
+			glClientWaitSync(f, GL_SYNC_FLUSH_COMMANDS_BIT, GLuint64(-1));
+			glDeleteSync(f);
+			f = 0;
+		}
+	}
+	if (buffer) {
+		if (persistent_ptr) {
+			glBindBuffer(target, buffer);
+			glUnmapBuffer(target);
+			glBindBuffer(target, 0);
+			persistent_ptr = nullptr;
+		}
+		Resources::forget_buffer(buffer);
+		glDeleteBuffers(1, &buffer);
+		buffer = 0;
+	}
+
+	region_size = region_size_;
+	GLsizeiptr total = region_size * regions;
+
+	glGenBuffers(1, &buffer);
+	glBindBuffer(target, buffer);
+	if (persistent) {
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(target, total, nullptr, flags);
+		persistent_ptr = glMapBufferRange(target, 0, total, flags);
+		if (!persistent_ptr) {
+			throw std::runtime_error("Failed to persistently map stream buffer.");
+		}
+	} else {
+		glBufferData(target, total, nullptr, GL_STREAM_DRAW);
+	}
+	glBindBuffer(target, 0);
+	Resources::track_buffer(buffer, "StreamBuffer", std::string(target == GL_DRAW_INDIRECT_BUFFER ? "indirect draws" : target == GL_TEXTURE_BUFFER ? "texture buffer" : "stream")
+		+ " x" + std::to_string(regions) + " regions");
+
+	region = regions - 1;
+	allocations += 1;
+}
+
+void *StreamBuffer::map(GLsizeiptr size) {
+	assert(max_region_size == 0 || size <= max_region_size);
+	if (size > region_size) {
+		GLsizeiptr new_size = region_size;
+		while (new_size < size) new_size *= 2;
+		if (max_region_size != 0) new_size = std::min(new_size, max_region_size);
+		allocate(new_size);
+	}
+
+	region = (region + 1) % regions;
+	offset = region * region_size;
+	mapped_size = size;
+
+	//make sure the GPU is done reading this region from a previous frame:
+	if (fences[region]) {
+		glClientWaitSync(fences[region], GL_SYNC_FLUSH_COMMANDS_BIT, GLuint64(-1));
+		glDeleteSync(fences[region]);
+		fences[region] = 0;
+	}
+
+	if (persistent) {
+		return reinterpret_cast< char * >(persistent_ptr) + offset;
+	} else {
+		glBindBuffer(target, buffer);
+		void *ptr = glMapBufferRange(target, offset, size,
+			GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+		if (!ptr) {
+			glBindBuffer(target, 0);
+			throw std::runtime_error("Failed to map stream buffer region.");
+		}
+		return ptr;
+	}
+}
+
+void StreamBuffer::unmap() {
+	if (!persistent) {
+		//(buffer is still bound from map())
+		if (glUnmapBuffer(target) != GL_TRUE) {
+			std::cerr << "WARNING: stream buffer contents were lost while mapped." << std::endl;
+		}
+		glBindBuffer(target, 0);
+	} else {
+		//(writes through the persistent mapping make no GL calls, so a capture has to be told about them)
+		GLCapture::mapped_write(buffer, offset, mapped_size);
+	}
+}
+
+void StreamBuffer::fence() {
+	assert(fences[region] == 0);
+	fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "GL.hpp"
+
+#include <cstdint>
+
+//"StreamBuffer" is a GL buffer that is rewritten every frame.
+// It is split into several regions used round-robin so that the CPU writes
+// one region while the GPU is still reading the others; a fence per region
+// keeps the CPU from overwriting data the GPU has not consumed yet.
+// When GL_ARB_buffer_storage is available the buffer is persistently mapped,
+// otherwise each region is mapped unsynchronized as it is written.
+
+struct StreamBuffer {
+	StreamBuffer(GLenum target, GLsizeiptr region_size, uint32_t regions = 3);
+	~StreamBuffer();
+	StreamBuffer(StreamBuffer const &) = delete;
+
+	//start writing the next region, growing the buffer if it is smaller than 'size':
+	// (regions grow by doubling, but never past max_region_size if that is set)
+	// returns a pointer to write to; byte offset of the region is in 'offset'.
+	void *map(GLsizeiptr size);
+	//done writing (unmaps if not persistently mapped):
+	void unmap();
+	//call after the draws that read the region have been submitted:
+	void fence();
+
+	GLenum target;
+	GLuint buffer = 0;
+	GLsizeiptr region_size = 0;
+	GLsizeiptr max_region_size = 0; //if nonzero, the most map() may ask for (e.g., to stay within GL_MAX_TEXTURE_BUFFER_SIZE)
+	uint32_t regions = 0;
+	uint32_t region = 0; //region most recently mapped
+	GLintptr offset = 0; //byte offset of 'region'
+	GLsizeiptr mapped_size = 0; //bytes asked for by the last map()
+	bool persistent = false;
+	uint32_t allocations = 0; //incremented whenever 'buffer' is (re)created
+
+	//internals:
+	void allocate(GLsizeiptr region_size);
+	void *persistent_ptr = nullptr;
+	GLsync fences[8] = {0,0,0,0,0,0,0,0};
+};
@@ -0,0 +1,115 @@
+//bake_texture converts a PNG into a baked texture (see load_texture.hpp): the full mip chain,
+// box-filtered the way glGenerateMipmap would, stored in the texture's internal format
+// (GL_RGB8 by default, matching what the game used to upload PNGs as; GL_RGBA8 with -rgba).
+//
+// usage: bake_texture [-rgba] <in.png> <out.tex>
+
+#include "load_texture.hpp"
+#include "load_save_png.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+template< typename T >
+void write_chunk(std::ostream &to, std::string const &magic, T const *data, size_t count) {
+	assert(magic.size() == 4);
+	uint32_t size = uint32_t(count * sizeof(T));
+	to.write(magic.data(), 4);
+	to.write(reinterpret_cast< char const * >(&size), 4);
+	to.write(reinterpret_cast< char const * >(data), size);
+}
+
+//average 2x2 blocks (clamped at odd edges) to make the next level down:
+std::vector< uint8_t > downsample(std::vector< uint8_t > const &src, uint32_t width, uint32_t height, uint32_t channels) {
+	uint32_t w = std::max(1U, width / 2);
+	uint32_t h = std::max(1U, height / 2);
+	std::vector< uint8_t > dst(size_t(w) * h * channels);
+	for (uint32_t y = 0; y < h; ++y) {
+		uint32_t y0 = std::min(2 * y, height - 1);
+		uint32_t y1 = std::min(2 * y + 1, height - 1);
+		for (uint32_t x = 0; x < w; ++x) {
+			uint32_t x0 = std::min(2 * x, width - 1);
+			uint32_t x1 = std::min(2 * x + 1, width - 1);
+			for (uint32_t c = 0; c < channels; ++c) {
+				uint32_t sum =
+					  src[(size_t(y0) * width + x0) * channels + c]
+					+ src[(size_t(y0) * width + x1) * channels + c]
+					+ src[(size_t(y1) * width + x0) * channels + c]
+					+ src[(size_t(y1) * width + x1) * channels + c];
+				dst[(size_t(y) * w + x) * channels + c] = uint8_t((sum + 2) / 4);
+			}
+		}
+	}
+	return dst;
+}
+
+} //namespace
+
+int main(int argc, char **argv) {
+	bool rgba = (argc == 4 && std::string(argv[1]) == "-rgba");
+	if (argc != 3 && !rgba) {
+		std::cerr << "usage:\n\t" << argv[0] << " [-rgba] <in.png> <out.tex>" << std::endl;
+		return 1;
+	}
+	std::string in_filename = argv[argc-2];
+	std::string out_filename = argv[argc-1];
+
+	try {
+		glm::uvec2 size;
+		std::vector< glm::u8vec4 > pixels;
+		load_png(in_filename, &size, &pixels, LowerLeftOrigin);
+		if (size.x == 0 || size.y == 0) throw std::runtime_error("'" + in_filename + "' is empty");
+
+		TextureHeader header;
+		header.width = size.x;
+		header.height = size.y;
+		header.internal_format = (rgba ? GL_RGBA8 : GL_RGB8);
+		header.format = (rgba ? GL_RGBA : GL_RGB);
+		header.type = GL_UNSIGNED_BYTE;
+		uint32_t channels = (rgba ? 4 : 3);
+
+		std::vector< uint8_t > level(size_t(size.x) * size.y * channels);
+		for (size_t i = 0; i < pixels.size(); ++i) {
+			for (uint32_t c = 0; c < channels; ++c) {
+				level[i * channels + c] = pixels[i][c];
+			}
+		}
+
+		std::vector< TextureLevel > levels;
+		std::vector< uint8_t > data;
+		uint32_t width = size.x, height = size.y;
+		while (true) {
+			TextureLevel info;
+			info.width = width;
+			info.height = height;
+			info.offset = uint32_t(data.size());
+			info.size = uint32_t(level.size());
+			levels.emplace_back(info);
+			data.insert(data.end(), level.begin(), level.end());
+			if (width == 1 && height == 1) break;
+			level = downsample(level, width, height, channels);
+			width = std::max(1U, width / 2);
+			height = std::max(1U, height / 2);
+		}
+		header.levels = uint32_t(levels.size());
+
+		std::ofstream out(out_filename, std::ios::binary);
+		write_chunk(out, "tex0", &header, 1);
+		write_chunk(out, "lvl0", levels.data(), levels.size());
+		write_chunk(out, "dat0", data.data(), data.size());
+		if (!out) throw std::runtime_error("failed to write '" + out_filename + "'");
+
+		std::cout << out_filename << ": " << header.width << "x" << header.height << ", " << header.levels << " levels, "
+			<< data.size() << " bytes of " << (rgba ? "RGBA8" : "RGB8") << "." << std::endl;
+	} catch (std::exception &e) {
+		std::cerr << "ERROR: " << e.what() << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,245 @@
+//bench renders the full pipeline (GameMode::draw) in a hidden window and reports how long it takes,
+// per frame and per pass (see PassTimers), as JSON:
+//   - every scene is run in its own process (loads happen once per process; see Load.hpp)
+//   - each scene is run at every size in -sizes and every blur_amount in -blurs
+//   - each of those runs 'warmup' untimed frames, then 'frames' timed frames (glFinish()'d, so the
+//     frame time is the whole pipeline, not just submission)
+// Renderers only matter relative to the same machine and driver, so runs are best compared against
+// earlier builds on the same box -- e.g., under a software driver (LIBGL_ALWAYS_SOFTWARE=1) on a build machine.
+// note: the final copy pass writes to the small hidden window, so its time is not representative.
+//
+// usage: bench [-out bench.json] [-frames 60] [-warmup 10] [-scenes test,cake,...]
+//              [-sizes 1280x720,...] [-blurs 0,3,10]
+
+#include "GameMode.hpp"
+#include "Load.hpp"
+#include "GL.hpp"
+#include "PassTimers.hpp"
+#include "HeadlessGL.hpp"
+#include "Resources.hpp"
+#include "parameters.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+extern std::string file; //scene loaded by GameMode (see GameMode.cpp)
+
+namespace {
+
+struct Options {
+	std::string out = "bench.json";
+	uint32_t frames = 60;
+	uint32_t warmup = 10;
+	std::vector< std::string > scenes = {"test", "cake", "opossum", "spheres"};
+	std::vector< std::string > sizes = {"1280x720", "1920x1080", "2560x1440", "3840x2160", "7680x4320"};
+	std::vector< std::string > blurs = {"0", "3", "10"};
+};
+
+std::vector< std::string > split(std::string const &list) {
+	std::vector< std::string > ret;
+	std::istringstream in(list);
+	std::string item;
+	while (std::getline(in, item, ',')) {
+		if (!item.empty()) ret.emplace_back(item);
+	}
+	return ret;
+}
+
+std::string join(std::vector< std::string > const &items) {
+	std::string ret;
+	for (auto const &item : items) ret += (ret.empty() ? "" : ",") + item;
+	return ret;
+}
+
+std::string json_string(std::string const &str) {
+	std::string ret = "\"";
+	for (char c : str) {
+		if (c == '"' || c == '\\') ret += '\\';
+		if (uint8_t(c) < 0x20) c = ' ';
+		ret += c;
+	}
+	return ret + "\"";
+}
+
+std::string json_summary(PassTimers::Summary const &s) {
+	std::ostringstream out;
+	out << "{\"min\":" << s.min << ",\"avg\":" << s.avg << ",\"median\":" << s.median << ",\"p99\":" << s.p99 << "}";
+	return out.str();
+}
+
+std::string quote_arg(std::string const &arg) {
+	return "\"" + arg + "\"";
+}
+
+//------ child: benchmark one scene in this process ------
+
+int run_scene(Options const &options, std::string const &scene, std::string const &out_file) {
+	std::ofstream out(out_file, std::ios::binary);
+	if (!out) {
+		std::cerr << "Can't write '" << out_file << "'." << std::endl;
+		return 1;
+	}
+
+	file = scene;
+
+	std::unique_ptr< HeadlessGL > gl;
+	std::shared_ptr< GameMode > game;
+	try {
+		gl.reset(new HeadlessGL);
+		call_load_functions();
+		game = std::make_shared< GameMode >();
+	} catch (std::exception const &e) {
+		out << "{\"scene\":" << json_string(scene) << ",\"error\":" << json_string(e.what()) << "}\n";
+		return 1;
+	}
+
+	GLint max_texture_size = 0;
+	glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_texture_size);
+
+	out << "{\"scene\":" << json_string(scene) << ",\"gl\":{"
+		<< "\"vendor\":" << json_string(reinterpret_cast< char const * >(glGetString(GL_VENDOR)))
+		<< ",\"renderer\":" << json_string(reinterpret_cast< char const * >(glGetString(GL_RENDERER)))
+		<< ",\"version\":" << json_string(reinterpret_cast< char const * >(glGetString(GL_VERSION)))
+		<< "},\"runs\":[";
+
+	bool first_run = true;
+	for (auto const &size_str : options.sizes) {
+		glm::uvec2 size(0);
+		if (std::sscanf(size_str.c_str(), "%ux%u", &size.x, &size.y) != 2 || size.x == 0 || size.y == 0) {
+			std::cerr << "Ignoring size '" << size_str << "' (expecting WIDTHxHEIGHT)." << std::endl;
+			continue;
+		}
+		for (auto const &blur_str : options.blurs) {
+			int blur = std::atoi(blur_str.c_str());
+			out << (first_run ? "\n" : ",\n") << "{\"width\":" << size.x << ",\"height\":" << size.y << ",\"blur_amount\":" << blur;
+			first_run = false;
+
+			if (size.x > uint32_t(max_texture_size) || size.y > uint32_t(max_texture_size)) {
+				out << ",\"skipped\":" << json_string("larger than GL_MAX_TEXTURE_SIZE (" + std::to_string(max_texture_size) + ")") << "}";
+				continue;
+			}
+			std::cerr << "  " << scene << " " << size.x << "x" << size.y << " blur " << blur << std::endl;
+
+			Parameters::blur_amount = blur;
+			Parameters::elapsed_time = 0.0f; //(so every run animates the same frames)
+			auto frame = [&]() {
+				game->update(1.0f / 60.0f);
+				game->draw(size);
+				glFinish();
+			};
+
+			for (uint32_t i = 0; i < options.warmup; ++i) {
+				frame();
+			}
+			game->timers.finish();
+			game->timers.clear();
+
+			std::vector< float > frame_ms;
+			frame_ms.reserve(options.frames);
+			for (uint32_t i = 0; i < options.frames; ++i) {
+				auto before = std::chrono::high_resolution_clock::now();
+				frame();
+				frame_ms.emplace_back(std::chrono::duration< float, std::milli >(std::chrono::high_resolution_clock::now() - before).count());
+			}
+			game->timers.finish();
+
+			out << ",\"frame_ms\":" << json_summary(PassTimers::summarize(frame_ms)) << ",\"passes\":{";
+			bool first_pass = true;
+			for (auto const &pass : game->timers.passes) {
+				if (pass.gpu_samples.empty()) continue; //(e.g., surface, which only runs after a resize)
+				out << (first_pass ? "" : ",") << json_string(pass.name) << ":{"
+					<< "\"frames\":" << pass.gpu_samples.size()
+					<< ",\"gpu_ms\":" << json_summary(PassTimers::summarize(pass.gpu_samples))
+					<< ",\"cpu_ms\":" << json_summary(PassTimers::summarize(pass.cpu_samples)) << "}";
+				first_pass = false;
+			}
+			out << "}}";
+		}
+	}
+	//(render targets are reallocated per size, so the peak is at the largest size that ran)
+	out << "\n],\"memory\":{\"gpu_peak_bytes\":" << Resources::gpu_peak_bytes()
+		<< ",\"host_peak_bytes\":" << Resources::host_peak_bytes() << "}}\n";
+
+	game.reset();
+	return 0;
+}
+
+} //namespace
+
+int main(int argc, char **argv) {
+	Options options;
+	std::string child_scene, child_out;
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		if (i + 1 >= argc) {
+			std::cerr << "Expecting a value after '" << arg << "'." << std::endl;
+			return 1;
+		}
+		std::string value = argv[++i];
+		if (arg == "-out") options.out = value;
+		else if (arg == "-frames") options.frames = uint32_t(std::atoi(value.c_str()));
+		else if (arg == "-warmup") options.warmup = uint32_t(std::atoi(value.c_str()));
+		else if (arg == "-scenes") options.scenes = split(value);
+		else if (arg == "-sizes") options.sizes = split(value);
+		else if (arg == "-blurs") options.blurs = split(value);
+		else if (arg == "-child" && i + 1 < argc) {
+			child_scene = value;
+			child_out = argv[++i];
+		} else {
+			std::cerr << "Unknown option '" << arg << "'." << std::endl;
+			return 1;
+		}
+	}
+
+	if (!child_scene.empty()) {
+		return run_scene(options, child_scene, child_out);
+	}
+
+	//------ parent: run each scene in a child process and gather the results ------
+	std::string results;
+	for (auto const &scene : options.scenes) {
+		std::cerr << "Benchmarking '" << scene << "':" << std::endl;
+		std::string scene_out = options.out + "." + scene + ".tmp";
+		std::remove(scene_out.c_str());
+		std::string command = quote_arg(argv[0])
+			+ " -frames " + std::to_string(options.frames)
+			+ " -warmup " + std::to_string(options.warmup)
+			+ " -sizes " + quote_arg(join(options.sizes))
+			+ " -blurs " + quote_arg(join(options.blurs))
+			+ " -child " + quote_arg(scene) + " " + quote_arg(scene_out);
+		int status = std::system(command.c_str());
+
+		std::ifstream in(scene_out, std::ios::binary);
+		std::string result((std::istreambuf_iterator< char >(in)), std::istreambuf_iterator< char >());
+		in.close();
+		std::remove(scene_out.c_str());
+		//(a child that crashed may have left partial output; complete output ends with "}\n")
+		if (result.size() < 2 || result.compare(result.size() - 2, 2, "}\n") != 0) {
+			result = "{\"scene\":" + json_string(scene) + ",\"error\":" + json_string("benchmark exited with status " + std::to_string(status)) + "}\n";
+		}
+		if (status != 0) std::cerr << "  (failed; see '" << options.out << "')" << std::endl;
+		results += (results.empty() ? "" : ",\n") + result.substr(0, result.size() - 1);
+	}
+
+	std::ofstream out(options.out, std::ios::binary);
+	out << "{\"build\":{\"date\":" << json_string(__DATE__ " " __TIME__)
+	#ifdef __VERSION__
+		<< ",\"compiler\":" << json_string(__VERSION__)
+	#endif
+		<< "},\"frames\":" << options.frames << ",\"warmup\":" << options.warmup
+		<< ",\"scenes\":[\n" << results << "\n]}\n";
+	if (!out) {
+		std::cerr << "Failed to write '" << options.out << "'." << std::endl;
+		return 1;
+	}
+	std::cerr << "Wrote '" << options.out << "'." << std::endl;
+	return 0;
+}
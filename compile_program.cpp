@@ -1,9 +1,25 @@
 #include "compile_program.hpp"
+#include "data_path.hpp"
+#include "gl_extensions.hpp"
+#include "read_chunk.hpp"
 
 #include <vector>
 #include <string>
 #include <stdexcept>
 #include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <cstdio>
+
+#ifdef _WIN32
+#include <direct.h>
+#include <process.h>
+static int process_id() { return _getpid(); }
+#else
+#include <sys/stat.h>
+#include <unistd.h>
+static int process_id() { return int(getpid()); }
+#endif
 
 static GLuint compile_shader(GLenum type, std::string const &source) {
 	GLuint shader = glCreateShader(type);
@@ -27,9 +43,10 @@ static GLuint compile_shader(GLenum type, std::string const &source) {
 	return shader;
 }
 
-GLuint compile_program(
+static GLuint link_program(
 	std::string const &vertex_shader_source,
-	std::string const &fragment_shader_source
+	std::string const &fragment_shader_source,
+	bool retrievable
 	) {
 
 	GLuint vertex_shader = compile_shader(GL_VERTEX_SHADER, vertex_shader_source);
@@ -43,6 +60,9 @@ GLuint compile_program(
 	glDeleteShader(vertex_shader);
 	glDeleteShader(fragment_shader);
 
+	//(if the binary will be saved to the cache, the driver needs to know before linking)
+	if (retrievable) glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+
 	//link the shader program and throw errors if linking fails:
 	glLinkProgram(program);
 	GLint link_status = GL_FALSE;
@@ -60,3 +80,178 @@ GLuint compile_program(
 
 	return program;
 }
+
+//---- program binary cache ----
+//Linked programs are saved (with glGetProgramBinary) as data_path("program-cache/<source hash>.bin")
+// and loaded with glProgramBinary on later runs. A cached binary is only tried if it came from the
+// same sources and the same driver; if the driver rejects it anyway, the program is compiled from
+// source and the cache entry is rewritten.
+//Cache file chunks:
+//  "pbc0": ProgramCacheHeader
+//  "drv0": driver string (vendor, renderer, version)
+//  "bin0": program binary
+
+struct ProgramCacheHeader {
+	uint64_t source_hash = 0;
+	uint32_t binary_format = 0;
+	uint32_t padding = 0;
+};
+static_assert(sizeof(ProgramCacheHeader) == 8 + 4 + 4, "ProgramCacheHeader is packed.");
+
+static bool program_cache_supported() {
+	static bool supported = [](){
+		#ifdef _WIN32
+		if (!glGetProgramBinary || !glProgramBinary || !glProgramParameteri) return false;
+		#endif
+		if (!gl_has_extension("GL_ARB_get_program_binary")) return false;
+		GLint formats = 0;
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+		return formats > 0; //(some drivers advertise the extension but can't save anything)
+	}();
+	return supported;
+}
+
+static bool is_program_binary_format(GLenum format) {
+	static std::vector< GLint > formats = [](){
+		GLint count = 0;
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &count);
+		std::vector< GLint > ret(std::max(count, 0));
+		if (!ret.empty()) glGetIntegerv(GL_PROGRAM_BINARY_FORMATS, ret.data());
+		return ret;
+	}();
+	return std::find(formats.begin(), formats.end(), GLint(format)) != formats.end();
+}
+
+static std::string const &driver_string() {
+	static std::string driver = [](){
+		std::string ret;
+		for (GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+			GLubyte const *str = glGetString(name);
+			ret += (str ? reinterpret_cast< char const * >(str) : "") + std::string("\n");
+		}
+		return ret;
+	}();
+	return driver;
+}
+
+static uint64_t hash_sources(std::string const &vertex_shader_source, std::string const &fragment_shader_source) {
+	uint64_t hash = 0xcbf29ce484222325ULL; //64-bit FNV-1a
+	auto add = [&hash](std::string const &str) {
+		for (char c : str) hash = (hash ^ uint8_t(c)) * 0x100000001b3ULL;
+		hash = (hash ^ 0xffU) * 0x100000001b3ULL; //(separator, so moving text between shaders changes the hash)
+	};
+	add(vertex_shader_source);
+	add(fragment_shader_source);
+	return hash;
+}
+
+static std::string program_cache_filename(uint64_t source_hash) {
+	char hex[17];
+	snprintf(hex, sizeof(hex), "%016llx", (unsigned long long)source_hash);
+	return data_path("program-cache/" + std::string(hex) + ".bin");
+}
+
+//returns 0 if there is no usable cached binary:
+static GLuint load_cached_program(uint64_t source_hash) {
+	std::string filename = program_cache_filename(source_hash);
+	std::ifstream file(filename, std::ios::binary);
+	if (!file) return 0;
+
+	std::vector< ProgramCacheHeader > header;
+	std::vector< char > driver;
+	std::vector< char > binary;
+	try {
+		read_chunk(file, "pbc0", &header);
+		read_chunk(file, "drv0", &driver);
+		read_chunk(file, "bin0", &binary);
+	} catch (std::exception &e) {
+		std::cerr << "WARNING: ignoring unreadable program cache file '" << filename << "' (" << e.what() << ")." << std::endl;
+		return 0;
+	}
+	if (header.size() != 1 || header[0].source_hash != source_hash) return 0;
+	if (std::string(driver.begin(), driver.end()) != driver_string()) return 0; //(driver changed; will be rewritten)
+	if (!is_program_binary_format(header[0].binary_format) || binary.empty()) return 0;
+
+	GLuint program = glCreateProgram();
+	glProgramBinary(program, header[0].binary_format, binary.data(), GLsizei(binary.size()));
+	GLint link_status = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &link_status);
+	if (link_status != GL_TRUE) {
+		std::cerr << "NOTE: driver rejected cached program '" << filename << "'; compiling from source." << std::endl;
+		glDeleteProgram(program);
+		return 0;
+	}
+	return program;
+}
+
+static void save_cached_program(GLuint program, uint64_t source_hash) {
+	GLint length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0) return;
+	std::vector< char > binary(length);
+	GLenum format = 0;
+	GLsizei got = 0;
+	glGetProgramBinary(program, length, &got, &format, binary.data());
+	if (got <= 0) return;
+	binary.resize(got);
+
+	#ifdef _WIN32
+	_mkdir(data_path("program-cache").c_str());
+	#else
+	mkdir(data_path("program-cache").c_str(), 0755);
+	#endif
+	//(if the directory couldn't be made, opening the file will fail below)
+
+	ProgramCacheHeader header;
+	header.source_hash = source_hash;
+	header.binary_format = format;
+	std::string const &driver = driver_string();
+
+	//write to a temporary file (named for this process, since render farm processes can share the cache)
+	// and rename it into place, so a reader never sees a half-written binary:
+	std::string filename = program_cache_filename(source_hash);
+	std::string temp_filename = filename + "." + std::to_string(process_id()) + ".tmp";
+	{
+		std::ofstream file(temp_filename, std::ios::binary);
+		auto write_chunk = [&file](char const *magic, void const *data, size_t size) {
+			uint32_t size32 = uint32_t(size);
+			file.write(magic, 4);
+			file.write(reinterpret_cast< char const * >(&size32), 4);
+			file.write(reinterpret_cast< char const * >(data), size);
+		};
+		write_chunk("pbc0", &header, sizeof(header));
+		write_chunk("drv0", driver.data(), driver.size());
+		write_chunk("bin0", binary.data(), binary.size());
+		file.close(); //(so errors flushing the last bytes are seen, too)
+		if (!file) {
+			std::cerr << "WARNING: failed to write program cache file '" << temp_filename << "'." << std::endl;
+			std::remove(temp_filename.c_str());
+			return;
+		}
+	}
+	#ifdef _WIN32
+	std::remove(filename.c_str()); //(rename won't replace an existing file on windows)
+	#endif
+	if (std::rename(temp_filename.c_str(), filename.c_str()) != 0) {
+		//(e.g., another process got there first on windows; its binary is just as good)
+		std::remove(temp_filename.c_str());
+	}
+}
+
+GLuint compile_program(
+	std::string const &vertex_shader_source,
+	std::string const &fragment_shader_source
+	) {
+	//(a capture records programs as source, so they have to be built from source while one is running)
+	if (!program_cache_supported() || GLCapture::recording()) {
+		return link_program(vertex_shader_source, fragment_shader_source, false);
+	}
+
+	uint64_t source_hash = hash_sources(vertex_shader_source, fragment_shader_source);
+	if (GLuint program = load_cached_program(source_hash)) {
+		return program;
+	}
+	GLuint program = link_program(vertex_shader_source, fragment_shader_source, true);
+	save_cached_program(program, source_hash);
+	return program;
+}
@@ -6,6 +6,8 @@
 
 //compiles+links an OpenGL shader program from source.
 // throws on compilation error.
+// linked programs are cached as binaries next to the executable (in "program-cache/") when the
+// driver supports GL_ARB_get_program_binary; see compile_program.cpp.
 GLuint compile_program(
 	std::string const &vertex_shader_source,
 	std::string const &fragment_shader_source);
@@ -26,6 +26,6 @@ DepthProgram::DepthProgram() {
 	object_to_clip_mat4 = glGetUniformLocation(program, "object_to_clip");
 }
 
-Load< DepthProgram > depth_program(LoadTagInit, [](){
+Load< DepthProgram > depth_program(LoadTagInit, "depth_program", {}, [](){
 	return new DepthProgram();
 });
@@ -0,0 +1,65 @@
+#include "downsample_program.hpp"
+
+#include "compile_program.hpp"
+#include "gl_errors.hpp"
+
+DownsampleProgram::DownsampleProgram() {
+	program = compile_program(
+		"#version 330\n"
+		"void main() {\n"
+        "   gl_Position = vec4(4*(gl_VertexID & 1) -1, 2 * (gl_VertexID &2) -1, 0.0, 1.0);"
+		"}\n"
+		,
+		"#version 330\n"
+		"uniform sampler2D tex;\n"
+        "uniform vec2 axis; //(1,0) shrinks x, (0,1) shrinks y\n"
+        "uniform float factor; //source pixels per output pixel along axis\n"
+        "uniform int source_size; //source pixels along axis that hold the image\n"
+        "uniform bool lanczos; //else box\n"
+        "layout(location=0) out vec4 downsampled_out;\n"
+
+        "float sinc(float x){ \n"
+        "   if(abs(x) < 1e-5) return 1.0; \n"
+        "   x *= 3.14159265; \n"
+        "   return sin(x)/x; \n"
+        "} \n"
+
+		"void main() {\n"
+        "   ivec2 a = ivec2(axis);\n"
+        "   ivec2 at = ivec2(gl_FragCoord.xy);\n"
+        "   ivec2 across = at*(ivec2(1)-a); //(coordinate that isn't shrunk)\n"
+        "   float center = (float(at.x*a.x + at.y*a.y)+0.5)*factor; //in source pixels\n"
+        "   float radius = (lanczos ? 3.0 : 0.5)*factor;\n"
+        "   int first = max(0, int(floor(center-radius)));\n"
+        "   int last = min(source_size-1, int(ceil(center+radius)));\n"
+        "   vec4 sum = vec4(0.0);\n"
+        "   float total = 0.0;\n"
+        "   for(int s = first; s<=last; ++s){\n"
+        "       float x = (float(s)+0.5-center)/factor; //in output pixels\n"
+        "       float w;\n"
+        "       if(lanczos) w = (abs(x) < 3.0 ? sinc(x)*sinc(x/3.0) : 0.0);\n"
+        "       else w = (x >= -0.5 && x < 0.5 ? 1.0 : 0.0);\n"
+        "       sum += texelFetch(tex, across+a*s, 0)*w;\n"
+        "       total += w;\n"
+        "   }\n"
+        //(weights are normalized, so pixels near the edge, with fewer taps, aren't darkened)
+        "   downsampled_out = sum/total;\n"
+		"}\n"
+	);
+	glUseProgram(program);
+
+    glUniform1i(glGetUniformLocation(program, "tex"), 0);
+
+    axis = glGetUniformLocation(program, "axis");
+    factor = glGetUniformLocation(program, "factor");
+    source_size = glGetUniformLocation(program, "source_size");
+    lanczos = glGetUniformLocation(program, "lanczos");
+
+	glUseProgram(0);
+
+	GL_ERRORS();
+}
+
+Load< DownsampleProgram > downsample_program(LoadTagInit, "downsample_program", {}, [](){
+	return new DownsampleProgram();
+});
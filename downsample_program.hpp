@@ -0,0 +1,18 @@
+#include "GL.hpp"
+#include "Load.hpp"
+
+//DownsampleProgram shrinks a supersampled render along one axis (run it once
+//per axis) with a box or Lanczos-3 filter; see GameMode::read_screen
+struct DownsampleProgram {
+	//opengl program object:
+	GLuint program = 0;
+
+	//uniform locations:
+	GLuint axis = -1U;
+	GLuint factor = -1U;
+	GLuint source_size = -1U;
+	GLuint lanczos = -1U;
+	DownsampleProgram();
+};
+
+extern Load< DownsampleProgram > downsample_program;
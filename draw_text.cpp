@@ -3,21 +3,31 @@
 #include "GL.hpp"
 #include "Load.hpp"
 #include "MeshBuffer.hpp"
-#include "data_path.hpp"
+#include "Pack.hpp"
 #include "compile_program.hpp"
+#include "Resources.hpp"
 
 #include <glm/gtc/type_ptr.hpp>
 
+#include <functional>
+#include <map>
+#include <vector>
+
 //------------ resources ------------
-Load< MeshBuffer > text_meshes(LoadTagInit, [](){
-	return new MeshBuffer(data_path("menu.p"));
+Load< MeshBuffer > text_meshes(LoadTagLazy, "text_meshes", {}, [](){
+	Asset asset = open_asset("menu.p");
+	asset.touch();
+	return asset;
+}, [](Asset &asset){
+	return new MeshBuffer(asset);
 });
 
 //font metrics for "text_meshes":
 const constexpr float char_height = 3.0f;
 
 inline float char_width(char a) {
-	if (a == 'I') return 1.0f;
+	if (a == 'I' || a == '.' || a == ':') return 1.0f;
+	else if ((a >= '0' && a <= '9') || a == '-') return 2.0f;
 	else if (a == 'L') return 2.0f;
 	else if (a == 'M' || a == 'W') return 4.0f;
 	else return 3.0f;
@@ -31,7 +41,7 @@ inline float char_spacing(char a, char b) {
 GLint text_program_mvp_mat4 = -1;
 GLint text_program_color_vec4 = -1;
 
-Load< GLuint > text_program(LoadTagInit, [](){
+Load< GLuint > text_program(LoadTagLazy, "text_program", {}, [](){
 	GLuint *ret = new GLuint(compile_program(
 		"#version 330\n"
 		"uniform mat4 mvp;\n"
@@ -55,10 +65,77 @@ Load< GLuint > text_program(LoadTagInit, [](){
 });
 
 //Binding for using text_program on text_meshes:
-Load< GLuint > text_meshes_for_text_program(LoadTagDefault, [](){
+Load< GLuint > text_meshes_for_text_program(LoadTagLazy, "text_meshes_for_text_program", {text_meshes, text_program}, [](){
 	return new GLuint(text_meshes->make_vao_for_program(*text_program));
 });
 
+//menu.p has no digits, so they (and '.', ':', '-') are drawn as seven-segment glyphs built here:
+struct SegmentGlyphs {
+	GLuint vbo = 0;
+	GLuint vao = 0; //for text_program
+	std::map< char, MeshBuffer::Mesh > meshes;
+};
+
+Load< SegmentGlyphs > segment_glyphs(LoadTagLazy, "segment_glyphs", {text_program}, [](){
+	//glyphs are 2 wide and 3 high (matching char_height), made of these rectangles:
+	const float t = 0.4f; //stroke thickness
+	struct Rect { float x0, y0, x1, y1; };
+	const Rect segments[7] = {
+		{0.0f, 3.0f - t, 2.0f, 3.0f}, //a: top
+		{2.0f - t, 1.5f, 2.0f, 3.0f}, //b: upper right
+		{2.0f - t, 0.0f, 2.0f, 1.5f}, //c: lower right
+		{0.0f, 0.0f, 2.0f, t}, //d: bottom
+		{0.0f, 0.0f, t, 1.5f}, //e: lower left
+		{0.0f, 1.5f, t, 3.0f}, //f: upper left
+		{0.0f, 1.5f - 0.5f * t, 2.0f, 1.5f + 0.5f * t}, //g: middle
+	};
+	const char *digits[10] = { "abcdef", "bc", "abdeg", "abcdg", "bcfg", "acdfg", "acdefg", "abc", "abcdefg", "abcdfg" };
+
+	std::vector< glm::vec3 > positions;
+	auto rect = [&positions](Rect const &r) {
+		positions.emplace_back(r.x0, r.y0, 0.0f);
+		positions.emplace_back(r.x1, r.y0, 0.0f);
+		positions.emplace_back(r.x1, r.y1, 0.0f);
+		positions.emplace_back(r.x0, r.y0, 0.0f);
+		positions.emplace_back(r.x1, r.y1, 0.0f);
+		positions.emplace_back(r.x0, r.y1, 0.0f);
+	};
+
+	SegmentGlyphs *ret = new SegmentGlyphs;
+	auto glyph = [&](char c, std::function< void() > const &build) {
+		MeshBuffer::Mesh &mesh = ret->meshes[c];
+		mesh.start = GLuint(positions.size());
+		build();
+		mesh.count = GLuint(positions.size()) - mesh.start;
+	};
+	for (char d = '0'; d <= '9'; ++d) {
+		glyph(d, [&](){
+			for (char const *s = digits[d - '0']; *s; ++s) rect(segments[*s - 'a']);
+		});
+	}
+	glyph('-', [&](){ rect(segments['g' - 'a']); });
+	glyph('.', [&](){ rect(Rect{0.5f - 0.5f * t, 0.0f, 0.5f + 0.5f * t, t}); });
+	glyph(':', [&](){
+		rect(Rect{0.5f - 0.5f * t, 0.5f, 0.5f + 0.5f * t, 0.5f + t});
+		rect(Rect{0.5f - 0.5f * t, 2.5f - t, 0.5f + 0.5f * t, 2.5f});
+	});
+
+	glGenBuffers(1, &ret->vbo);
+	glBindBuffer(GL_ARRAY_BUFFER, ret->vbo);
+	glBufferData(GL_ARRAY_BUFFER, positions.size() * sizeof(glm::vec3), positions.data(), GL_STATIC_DRAW);
+	Resources::track_buffer(ret->vbo, "draw_text", "segment glyphs");
+
+	glGenVertexArrays(1, &ret->vao);
+	glBindVertexArray(ret->vao);
+	GLint location = glGetAttribLocation(*text_program, "Position");
+	glVertexAttribPointer(location, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (GLbyte *)0);
+	glEnableVertexAttribArray(location);
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	return ret;
+});
+
 //----------------------
 
 
@@ -78,7 +155,8 @@ void draw_text(std::string const &text, glm::vec2 const &anchor, float height, g
 
 void draw_text(std::string const &text, glm::mat4 const &transform, glm::vec4 color) {
 	glUseProgram(*text_program);
-	glBindVertexArray(*text_meshes_for_text_program);
+	GLuint vao = *text_meshes_for_text_program;
+	glBindVertexArray(vao);
 
 	float x = 0.0f;
 	for (uint32_t i = 0; i < text.size(); ++i) {
@@ -94,7 +172,13 @@ void draw_text(std::string const &text, glm::mat4 const &transform, glm::vec4 co
 			glUniformMatrix4fv(text_program_mvp_mat4, 1, GL_FALSE, glm::value_ptr(mvp));
 			glUniform4fv(text_program_color_vec4, 1, glm::value_ptr(color));
 
-			MeshBuffer::Mesh const &mesh = text_meshes->lookup(text.substr(i,1));
+			auto f = segment_glyphs->meshes.find(text[i]);
+			GLuint want_vao = (f != segment_glyphs->meshes.end() ? segment_glyphs->vao : *text_meshes_for_text_program);
+			if (want_vao != vao) {
+				vao = want_vao;
+				glBindVertexArray(vao);
+			}
+			MeshBuffer::Mesh const &mesh = (f != segment_glyphs->meshes.end() ? f->second : text_meshes->lookup(text.substr(i,1)));
 			glDrawArrays(GL_TRIANGLES, mesh.start, mesh.count);
 		}
 
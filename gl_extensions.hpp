@@ -0,0 +1,22 @@
+#pragma once
+
+#include "GL.hpp"
+
+#include <set>
+#include <string>
+
+//gl_has_extension checks whether the current context advertises an extension:
+// (the extension list is read once, the first time this is called)
+inline bool gl_has_extension(std::string const &name) {
+	static std::set< std::string > extensions = [](){
+		std::set< std::string > ret;
+		GLint count = 0;
+		glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+		for (GLint i = 0; i < count; ++i) {
+			GLubyte const *ext = glGetStringi(GL_EXTENSIONS, i);
+			if (ext) ret.insert(reinterpret_cast< char const * >(ext));
+		}
+		return ret;
+	}();
+	return extensions.count(name) != 0;
+}
@@ -15,5 +15,8 @@ void init_gl_shims() {
 		if (!gl ## NAME) { \
 			throw std::runtime_error("Error binding "  "gl" #NAME); \
 		}
+	#undef DO_OPTIONAL
+	#define DO_OPTIONAL(TYPE, NAME) \
+		gl ## NAME = (PFNGL ## TYPE ## PROC)SDL_GL_GetProcAddress("gl" #NAME);
 #include "gl_shims.hpp"
 }
@@ -360,4 +360,20 @@ DO(TEXIMAGE3DMULTISAMPLE, TexImage3DMultisample)
 DO(GETMULTISAMPLEFV, GetMultisamplefv)
 DO(SAMPLEMASKI, SampleMaski)
 
+// GL_VERSION_3_3 extensions:
+DO(VERTEXATTRIBDIVISOR, VertexAttribDivisor)
+DO(GETQUERYOBJECTUI64V, GetQueryObjectui64v)
+
+// Functions from later versions / extensions; these are NULL if the driver doesn't provide them,
+// so check gl_has_extension() before calling:
+#ifndef DO_OPTIONAL
+#define DO_OPTIONAL(TYPE, NAME) DO(TYPE, NAME)
+#endif
+DO_OPTIONAL(BUFFERSTORAGE, BufferStorage)
+DO_OPTIONAL(MULTIDRAWARRAYSINDIRECT, MultiDrawArraysIndirect)
+DO_OPTIONAL(MULTIDRAWELEMENTSINDIRECT, MultiDrawElementsIndirect)
+DO_OPTIONAL(GETPROGRAMBINARY, GetProgramBinary)
+DO_OPTIONAL(PROGRAMBINARY, ProgramBinary)
+DO_OPTIONAL(PROGRAMPARAMETERI, ProgramParameteri)
+
 #endif //GL_SHIMS_HPP
@@ -0,0 +1,659 @@
+//glreplay plays back a GL capture (made with 'main -capture'; see GLCapture.hpp) in a hidden window and
+// times it, with no scene loading or game logic in the way -- so the time is the driver's (and the GPU's):
+//   - the first frame (which also holds all the loading: shader compiles, uploads) is replayed untimed
+//   - each frame is timed on the CPU up to its end (submission), then glFinish()'d and timed again (whole frame)
+//   - every call is timed individually too, and reported per call type
+// Run under a software driver (e.g., LIBGL_ALWAYS_SOFTWARE=1 for llvmpipe) to compare driver-side changes
+// on a build machine; compare captures against the same capture, since calls are replayed exactly.
+//
+// usage: glreplay <capture.glcap> [-warmup 1] [-loops 1] [-no-finish]
+//   -warmup = frames at the start not counted in the timings (the first frame never is)
+//   -loops = replay the whole capture this many times (each in a fresh context) and report them all together
+//   -no-finish = don't glFinish() after each frame (frame times are then submission only)
+
+//(the replayer makes real GL calls; recording them would be pointless)
+#define GL_CAPTURE_NO_WRAPPERS
+#include "GL.hpp"
+#include "GLCapture.hpp"
+#include "HeadlessGL.hpp"
+#include "PassTimers.hpp"
+#include "ChunkFile.hpp"
+#include "MappedFile.hpp"
+#include "gl_extensions.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::high_resolution_clock;
+
+struct Options {
+	std::string capture;
+	uint32_t warmup = 1;
+	uint32_t loops = 1;
+	bool finish = true;
+};
+
+struct Stats {
+	//per call type:
+	uint64_t setup_counts[size_t(GLCapture::Call::Count)] = {};
+	uint64_t counts[size_t(GLCapture::Call::Count)] = {}; //(timed frames only)
+	double ms[size_t(GLCapture::Call::Count)] = {};
+	//per timed frame:
+	std::vector< float > submit_ms;
+	std::vector< float > frame_ms;
+	uint32_t timed_frames = 0;
+};
+
+//reads the "cmd0" stream (values are unaligned, so they are copied out):
+struct Reader {
+	char const *at;
+	char const *end;
+	template< typename T >
+	T get() {
+		T ret;
+		need(sizeof(T));
+		std::memcpy(&ret, at, sizeof(T));
+		at += sizeof(T);
+		return ret;
+	}
+	char const *bytes(size_t size) {
+		need(size);
+		char const *ret = at;
+		at += size;
+		return ret;
+	}
+	struct Blob {
+		char const *data = nullptr; //nullptr for "no data"
+		size_t size = 0;
+	};
+	Blob blob() {
+		Blob ret;
+		if (get< uint8_t >()) {
+			ret.size = size_t(get< uint64_t >());
+			ret.data = bytes(ret.size);
+		}
+		return ret;
+	}
+	void need(size_t size) {
+		if (size_t(end - at) < size) throw std::runtime_error("Capture ends in the middle of a call.");
+	}
+};
+
+//recorded object names -> names in this context:
+struct Names {
+	std::unordered_map< GLuint, GLuint > map;
+	char const *kind;
+	explicit Names(char const *kind_) : kind(kind_) { }
+	GLuint operator()(GLuint recorded) {
+		if (recorded == 0) return 0;
+		auto f = map.find(recorded);
+		if (f == map.end()) throw std::runtime_error(std::string("Capture uses a ") + kind + " it never made (" + std::to_string(recorded) + ").");
+		return f->second;
+	}
+};
+
+void replay(Options const &options, ChunkFile const &file, Stats *stats) {
+	using GLCapture::Call;
+
+	ChunkFile::Chunk const &cmd0 = file.get("cmd0");
+	Reader r{cmd0.data, cmd0.data + cmd0.size};
+
+	Names buffers("buffer"), textures("texture"), framebuffers("framebuffer"), vertex_arrays("vertex array"),
+		queries("query"), programs("program"), shaders("shader");
+	std::unordered_map< uint32_t, GLsync > syncs;
+	std::map< std::pair< GLuint, GLint >, GLint > uniform_locations; //(program, recorded) -> location here
+	std::map< std::pair< GLuint, GLuint >, GLuint > block_indices; //(program, recorded) -> index here
+	std::map< GLenum, GLuint > bound_buffers;
+	struct Mapping {
+		char *ptr = nullptr;
+		int64_t offset = 0;
+	};
+	std::map< GLuint, Mapping > mappings;
+	GLuint current_program = 0;
+	std::vector< char > scratch; //(readbacks land here)
+
+	auto location = [&](GLint recorded) {
+		auto f = uniform_locations.find(std::make_pair(current_program, recorded));
+		return (f != uniform_locations.end() ? f->second : recorded);
+	};
+	auto gen = [&](Names &names, void (*gen_fn)(GLsizei, GLuint *)) {
+		GLsizei n = r.get< GLsizei >();
+		std::vector< GLuint > made(size_t(std::max(n, 0)));
+		gen_fn(n, made.data());
+		for (GLsizei i = 0; i < n; ++i) {
+			names.map[r.get< GLuint >()] = made[i];
+		}
+	};
+	auto del = [&](Names &names, void (*delete_fn)(GLsizei, GLuint const *)) {
+		GLsizei n = r.get< GLsizei >();
+		std::vector< GLuint > here;
+		for (GLsizei i = 0; i < n; ++i) {
+			GLuint recorded = r.get< GLuint >();
+			auto f = names.map.find(recorded);
+			if (f == names.map.end()) continue;
+			here.emplace_back(f->second);
+			names.map.erase(f);
+		}
+		delete_fn(GLsizei(here.size()), here.data());
+	};
+	auto offset_ptr = [](int64_t offset) {
+		return reinterpret_cast< void const * >(intptr_t(offset));
+	};
+
+	uint32_t frame = 0;
+	auto frame_start = Clock::now();
+	while (r.at < r.end) {
+		Call call = Call(r.get< uint16_t >());
+		if (call >= Call::Count) throw std::runtime_error("Capture has an unknown call (" + std::to_string(uint32_t(call)) + ").");
+		auto call_start = Clock::now();
+
+		switch (call) {
+			case Call::Frame: {
+				auto submitted = Clock::now();
+				if (options.finish) glFinish();
+				auto finished = Clock::now();
+				if (frame > 0 && frame >= options.warmup) {
+					stats->submit_ms.emplace_back(std::chrono::duration< float, std::milli >(submitted - frame_start).count());
+					stats->frame_ms.emplace_back(std::chrono::duration< float, std::milli >(finished - frame_start).count());
+					stats->timed_frames += 1;
+				}
+				frame += 1;
+				frame_start = Clock::now();
+				continue; //(not counted as a call)
+			}
+			case Call::MappedWrite: {
+				GLuint buffer = buffers(r.get< GLuint >());
+				int64_t offset = r.get< int64_t >();
+				Reader::Blob data = r.blob();
+				auto f = mappings.find(buffer);
+				if (f == mappings.end()) throw std::runtime_error("Capture writes to a buffer that isn't mapped.");
+				std::memcpy(f->second.ptr + (offset - f->second.offset), data.data, data.size);
+			} break;
+			case Call::ActiveTexture: glActiveTexture(r.get< GLenum >()); break;
+			case Call::AttachShader: {
+				GLuint program = programs(r.get< GLuint >());
+				glAttachShader(program, shaders(r.get< GLuint >()));
+			} break;
+			case Call::BeginQuery: {
+				GLenum target = r.get< GLenum >();
+				glBeginQuery(target, queries(r.get< GLuint >()));
+			} break;
+			case Call::BindBuffer: {
+				GLenum target = r.get< GLenum >();
+				GLuint buffer = buffers(r.get< GLuint >());
+				bound_buffers[target] = buffer;
+				glBindBuffer(target, buffer);
+			} break;
+			case Call::BindBufferBase: {
+				GLenum target = r.get< GLenum >();
+				GLuint index = r.get< GLuint >();
+				glBindBufferBase(target, index, buffers(r.get< GLuint >()));
+			} break;
+			case Call::BindFramebuffer: {
+				GLenum target = r.get< GLenum >();
+				glBindFramebuffer(target, framebuffers(r.get< GLuint >()));
+			} break;
+			case Call::BindTexture: {
+				GLenum target = r.get< GLenum >();
+				glBindTexture(target, textures(r.get< GLuint >()));
+			} break;
+			case Call::BindVertexArray: glBindVertexArray(vertex_arrays(r.get< GLuint >())); break;
+			case Call::BlendEquation: glBlendEquation(r.get< GLenum >()); break;
+			case Call::BlendFunc: {
+				GLenum sfactor = r.get< GLenum >();
+				glBlendFunc(sfactor, r.get< GLenum >());
+			} break;
+			case Call::BufferData: {
+				GLenum target = r.get< GLenum >();
+				int64_t size = r.get< int64_t >();
+				GLenum usage = r.get< GLenum >();
+				glBufferData(target, GLsizeiptr(size), r.blob().data, usage);
+			} break;
+			case Call::BufferStorage: {
+				GLenum target = r.get< GLenum >();
+				int64_t size = r.get< int64_t >();
+				GLbitfield flags = r.get< GLbitfield >();
+				Reader::Blob data = r.blob();
+				if (!gl_has_extension("GL_ARB_buffer_storage")) {
+					throw std::runtime_error("Capture uses glBufferStorage, but this driver doesn't support GL_ARB_buffer_storage.");
+				}
+				glBufferStorage(target, GLsizeiptr(size), data.data, flags);
+			} break;
+			case Call::BufferSubData: {
+				GLenum target = r.get< GLenum >();
+				int64_t offset = r.get< int64_t >();
+				int64_t size = r.get< int64_t >();
+				glBufferSubData(target, GLintptr(offset), GLsizeiptr(size), r.blob().data);
+			} break;
+			case Call::Clear: glClear(r.get< GLbitfield >()); break;
+			case Call::ClearBufferfv: {
+				GLenum buffer = r.get< GLenum >();
+				GLint drawbuffer = r.get< GLint >();
+				GLfloat value[4];
+				std::memcpy(value, r.bytes(sizeof(GLfloat) * (buffer == GL_COLOR ? 4 : 1)), sizeof(GLfloat) * (buffer == GL_COLOR ? 4 : 1));
+				glClearBufferfv(buffer, drawbuffer, value);
+			} break;
+			case Call::ClearColor: {
+				GLfloat c[4];
+				for (auto &v : c) v = r.get< GLfloat >();
+				glClearColor(c[0], c[1], c[2], c[3]);
+			} break;
+			case Call::ClientWaitSync: {
+				GLsync sync = syncs[r.get< uint32_t >()];
+				GLbitfield flags = r.get< GLbitfield >();
+				GLuint64 timeout = r.get< GLuint64 >();
+				if (sync) glClientWaitSync(sync, flags, timeout);
+			} break;
+			case Call::CompileShader: {
+				GLuint shader = shaders(r.get< GLuint >());
+				glCompileShader(shader);
+				GLint status = GL_FALSE;
+				glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+				if (status != GL_TRUE) throw std::runtime_error("A captured shader doesn't compile on this driver.");
+			} break;
+			case Call::CreateProgram: programs.map[r.get< GLuint >()] = glCreateProgram(); break;
+			case Call::CreateShader: {
+				GLenum type = r.get< GLenum >();
+				shaders.map[r.get< GLuint >()] = glCreateShader(type);
+			} break;
+			case Call::DeleteBuffers: del(buffers, [](GLsizei n, GLuint const *names){ glDeleteBuffers(n, names); }); break;
+			case Call::DeleteProgram: {
+				GLuint recorded = r.get< GLuint >();
+				glDeleteProgram(programs(recorded));
+				programs.map.erase(recorded);
+			} break;
+			case Call::DeleteQueries: del(queries, [](GLsizei n, GLuint const *names){ glDeleteQueries(n, names); }); break;
+			case Call::DeleteShader: {
+				//(shaders are deleted right after attaching, but stay in use until their program goes; keep the mapping)
+				glDeleteShader(shaders(r.get< GLuint >()));
+			} break;
+			case Call::DeleteSync: {
+				uint32_t id = r.get< uint32_t >();
+				auto f = syncs.find(id);
+				if (f != syncs.end()) {
+					glDeleteSync(f->second);
+					syncs.erase(f);
+				}
+			} break;
+			case Call::DeleteTextures: del(textures, [](GLsizei n, GLuint const *names){ glDeleteTextures(n, names); }); break;
+			case Call::Disable: glDisable(r.get< GLenum >()); break;
+			case Call::DrawArrays: {
+				GLenum mode = r.get< GLenum >();
+				GLint first = r.get< GLint >();
+				glDrawArrays(mode, first, r.get< GLsizei >());
+			} break;
+			case Call::DrawArraysInstanced: {
+				GLenum mode = r.get< GLenum >();
+				GLint first = r.get< GLint >();
+				GLsizei count = r.get< GLsizei >();
+				glDrawArraysInstanced(mode, first, count, r.get< GLsizei >());
+			} break;
+			case Call::DrawBuffers: {
+				GLsizei n = r.get< GLsizei >();
+				std::vector< GLenum > bufs(size_t(std::max(n, 0)));
+				for (auto &b : bufs) b = r.get< GLenum >();
+				glDrawBuffers(n, bufs.data());
+			} break;
+			case Call::DrawElements: {
+				GLenum mode = r.get< GLenum >();
+				GLsizei count = r.get< GLsizei >();
+				GLenum type = r.get< GLenum >();
+				glDrawElements(mode, count, type, offset_ptr(r.get< int64_t >()));
+			} break;
+			case Call::DrawElementsInstanced: {
+				GLenum mode = r.get< GLenum >();
+				GLsizei count = r.get< GLsizei >();
+				GLenum type = r.get< GLenum >();
+				void const *indices = offset_ptr(r.get< int64_t >());
+				glDrawElementsInstanced(mode, count, type, indices, r.get< GLsizei >());
+			} break;
+			case Call::Enable: glEnable(r.get< GLenum >()); break;
+			case Call::EnableVertexAttribArray: glEnableVertexAttribArray(r.get< GLuint >()); break;
+			case Call::EndQuery: glEndQuery(r.get< GLenum >()); break;
+			case Call::FenceSync: {
+				GLenum condition = r.get< GLenum >();
+				GLbitfield flags = r.get< GLbitfield >();
+				syncs[r.get< uint32_t >()] = glFenceSync(condition, flags);
+			} break;
+			case Call::Finish: glFinish(); break;
+			case Call::FramebufferTexture2D: {
+				GLenum target = r.get< GLenum >();
+				GLenum attachment = r.get< GLenum >();
+				GLenum textarget = r.get< GLenum >();
+				GLuint texture = textures(r.get< GLuint >());
+				glFramebufferTexture2D(target, attachment, textarget, texture, r.get< GLint >());
+			} break;
+			case Call::GenBuffers: gen(buffers, [](GLsizei n, GLuint *names){ glGenBuffers(n, names); }); break;
+			case Call::GenFramebuffers: gen(framebuffers, [](GLsizei n, GLuint *names){ glGenFramebuffers(n, names); }); break;
+			case Call::GenQueries: gen(queries, [](GLsizei n, GLuint *names){ glGenQueries(n, names); }); break;
+			case Call::GenTextures: gen(textures, [](GLsizei n, GLuint *names){ glGenTextures(n, names); }); break;
+			case Call::GenVertexArrays: gen(vertex_arrays, [](GLsizei n, GLuint *names){ glGenVertexArrays(n, names); }); break;
+			case Call::GenerateMipmap: glGenerateMipmap(r.get< GLenum >()); break;
+			case Call::GetBufferSubData: {
+				GLenum target = r.get< GLenum >();
+				int64_t offset = r.get< int64_t >();
+				int64_t size = r.get< int64_t >();
+				scratch.resize(size_t(size));
+				glGetBufferSubData(target, GLintptr(offset), GLsizeiptr(size), scratch.data());
+			} break;
+			case Call::GetQueryObjectiv: {
+				GLuint id = queries(r.get< GLuint >());
+				GLint result = 0;
+				glGetQueryObjectiv(id, r.get< GLenum >(), &result);
+			} break;
+			case Call::GetQueryObjectui64v: {
+				GLuint id = queries(r.get< GLuint >());
+				GLuint64 result = 0;
+				glGetQueryObjectui64v(id, r.get< GLenum >(), &result);
+			} break;
+			case Call::GetTexImage: {
+				GLenum target = r.get< GLenum >();
+				GLint level = r.get< GLint >();
+				GLenum format = r.get< GLenum >();
+				GLenum type = r.get< GLenum >();
+				scratch.resize(size_t(r.get< uint64_t >()));
+				glGetTexImage(target, level, format, type, scratch.data());
+			} break;
+			case Call::GetUniformBlockIndex: {
+				GLuint program = programs(r.get< GLuint >());
+				GLuint recorded = r.get< GLuint >();
+				Reader::Blob name = r.blob();
+				block_indices[std::make_pair(program, recorded)] = glGetUniformBlockIndex(program, name.data);
+			} break;
+			case Call::GetUniformLocation: {
+				GLuint program = programs(r.get< GLuint >());
+				GLint recorded = r.get< GLint >();
+				Reader::Blob name = r.blob();
+				uniform_locations[std::make_pair(program, recorded)] = glGetUniformLocation(program, name.data);
+			} break;
+			case Call::LinkProgram: {
+				GLuint program = programs(r.get< GLuint >());
+				uint32_t attribs = r.get< uint32_t >();
+				for (uint32_t i = 0; i < attribs; ++i) {
+					GLint location = r.get< GLint >();
+					Reader::Blob name = r.blob();
+					glBindAttribLocation(program, GLuint(location), std::string(name.data, name.size).c_str());
+				}
+				glLinkProgram(program);
+				GLint status = GL_FALSE;
+				glGetProgramiv(program, GL_LINK_STATUS, &status);
+				if (status != GL_TRUE) throw std::runtime_error("A captured program doesn't link on this driver.");
+			} break;
+			case Call::MapBufferRange: {
+				GLenum target = r.get< GLenum >();
+				int64_t offset = r.get< int64_t >();
+				int64_t length = r.get< int64_t >();
+				GLbitfield access = r.get< GLbitfield >();
+				void *ptr = glMapBufferRange(target, GLintptr(offset), GLsizeiptr(length), access);
+				if (!ptr) throw std::runtime_error("Failed to map a buffer the capture mapped.");
+				Mapping &m = mappings[bound_buffers[target]];
+				m.ptr = reinterpret_cast< char * >(ptr);
+				m.offset = offset;
+			} break;
+			case Call::MultiDrawArraysIndirect: {
+				GLenum mode = r.get< GLenum >();
+				void const *indirect = offset_ptr(r.get< int64_t >());
+				GLsizei drawcount = r.get< GLsizei >();
+				glMultiDrawArraysIndirect(mode, indirect, drawcount, r.get< GLsizei >());
+			} break;
+			case Call::MultiDrawElementsIndirect: {
+				GLenum mode = r.get< GLenum >();
+				GLenum type = r.get< GLenum >();
+				void const *indirect = offset_ptr(r.get< int64_t >());
+				GLsizei drawcount = r.get< GLsizei >();
+				glMultiDrawElementsIndirect(mode, type, indirect, drawcount, r.get< GLsizei >());
+			} break;
+			case Call::PixelStorei: {
+				GLenum pname = r.get< GLenum >();
+				glPixelStorei(pname, r.get< GLint >());
+			} break;
+			case Call::ReadPixels: {
+				GLint x = r.get< GLint >();
+				GLint y = r.get< GLint >();
+				GLsizei width = r.get< GLsizei >();
+				GLsizei height = r.get< GLsizei >();
+				GLenum format = r.get< GLenum >();
+				GLenum type = r.get< GLenum >();
+				bool packed = (r.get< uint8_t >() != 0);
+				uint64_t offset_or_size = r.get< uint64_t >();
+				if (packed) {
+					glReadPixels(x, y, width, height, format, type, const_cast< void * >(offset_ptr(int64_t(offset_or_size))));
+				} else {
+					scratch.resize(size_t(offset_or_size));
+					glReadPixels(x, y, width, height, format, type, scratch.data());
+				}
+			} break;
+			case Call::ShaderSource: {
+				GLuint shader = shaders(r.get< GLuint >());
+				Reader::Blob source = r.blob();
+				GLchar const *str = source.data;
+				GLint length = GLint(source.size);
+				glShaderSource(shader, 1, &str, &length);
+			} break;
+			case Call::TexBuffer: {
+				GLenum target = r.get< GLenum >();
+				GLenum internalformat = r.get< GLenum >();
+				glTexBuffer(target, internalformat, buffers(r.get< GLuint >()));
+			} break;
+			case Call::TexImage2D:
+			case Call::TexSubImage2D: {
+				GLenum target = r.get< GLenum >();
+				GLint level = r.get< GLint >();
+				GLint internalformat_or_x = r.get< GLint >();
+				GLint y_or_border = r.get< GLint >();
+				GLsizei width = r.get< GLsizei >();
+				GLsizei height = r.get< GLsizei >();
+				GLenum format = r.get< GLenum >();
+				GLenum type = r.get< GLenum >();
+				Reader::Blob pixels = r.blob();
+				if (call == Call::TexImage2D) {
+					glTexImage2D(target, level, internalformat_or_x, width, height, y_or_border, format, type, pixels.data);
+				} else {
+					glTexSubImage2D(target, level, internalformat_or_x, y_or_border, width, height, format, type, pixels.data);
+				}
+			} break;
+			case Call::TexParameteri: {
+				GLenum target = r.get< GLenum >();
+				GLenum pname = r.get< GLenum >();
+				glTexParameteri(target, pname, r.get< GLint >());
+			} break;
+			case Call::Uniform1f: {
+				GLint loc = location(r.get< GLint >());
+				glUniform1f(loc, r.get< GLfloat >());
+			} break;
+			case Call::Uniform2f: {
+				GLint loc = location(r.get< GLint >());
+				GLfloat v0 = r.get< GLfloat >();
+				glUniform2f(loc, v0, r.get< GLfloat >());
+			} break;
+			case Call::Uniform1i: {
+				GLint loc = location(r.get< GLint >());
+				glUniform1i(loc, r.get< GLint >());
+			} break;
+			case Call::Uniform1fv:
+			case Call::Uniform4fv: {
+				GLint loc = location(r.get< GLint >());
+				GLsizei count = r.get< GLsizei >();
+				size_t floats = size_t(count) * (call == Call::Uniform1fv ? 1 : 4);
+				std::vector< GLfloat > value(floats);
+				if (floats) std::memcpy(value.data(), r.bytes(sizeof(GLfloat) * floats), sizeof(GLfloat) * floats);
+				if (call == Call::Uniform1fv) glUniform1fv(loc, count, value.data());
+				else glUniform4fv(loc, count, value.data());
+			} break;
+			case Call::UniformBlockBinding: {
+				GLuint program = programs(r.get< GLuint >());
+				GLuint recorded = r.get< GLuint >();
+				GLuint binding = r.get< GLuint >();
+				auto f = block_indices.find(std::make_pair(program, recorded));
+				glUniformBlockBinding(program, (f != block_indices.end() ? f->second : recorded), binding);
+			} break;
+			case Call::UniformMatrix3fv:
+			case Call::UniformMatrix4fv:
+			case Call::UniformMatrix4x3fv: {
+				GLint loc = location(r.get< GLint >());
+				GLsizei count = r.get< GLsizei >();
+				GLboolean transpose = r.get< GLboolean >();
+				size_t floats = size_t(count) * (call == Call::UniformMatrix3fv ? 9 : call == Call::UniformMatrix4fv ? 16 : 12);
+				std::vector< GLfloat > value(floats);
+				if (floats) std::memcpy(value.data(), r.bytes(sizeof(GLfloat) * floats), sizeof(GLfloat) * floats);
+				if (call == Call::UniformMatrix3fv) glUniformMatrix3fv(loc, count, transpose, value.data());
+				else if (call == Call::UniformMatrix4fv) glUniformMatrix4fv(loc, count, transpose, value.data());
+				else glUniformMatrix4x3fv(loc, count, transpose, value.data());
+			} break;
+			case Call::UnmapBuffer: {
+				GLenum target = r.get< GLenum >();
+				Reader::Blob data = r.blob();
+				auto f = mappings.find(bound_buffers[target]);
+				if (f != mappings.end()) {
+					if (data.data) std::memcpy(f->second.ptr, data.data, data.size);
+					mappings.erase(f);
+				}
+				glUnmapBuffer(target);
+			} break;
+			case Call::UseProgram: {
+				current_program = programs(r.get< GLuint >());
+				glUseProgram(current_program);
+			} break;
+			case Call::VertexAttribDivisor: {
+				GLuint index = r.get< GLuint >();
+				glVertexAttribDivisor(index, r.get< GLuint >());
+			} break;
+			case Call::VertexAttribIPointer: {
+				GLuint index = r.get< GLuint >();
+				GLint size = r.get< GLint >();
+				GLenum type = r.get< GLenum >();
+				GLsizei stride = r.get< GLsizei >();
+				glVertexAttribIPointer(index, size, type, stride, offset_ptr(r.get< int64_t >()));
+			} break;
+			case Call::VertexAttribPointer: {
+				GLuint index = r.get< GLuint >();
+				GLint size = r.get< GLint >();
+				GLenum type = r.get< GLenum >();
+				GLboolean normalized = r.get< GLboolean >();
+				GLsizei stride = r.get< GLsizei >();
+				glVertexAttribPointer(index, size, type, normalized, stride, offset_ptr(r.get< int64_t >()));
+			} break;
+			case Call::Viewport: {
+				GLint x = r.get< GLint >();
+				GLint y = r.get< GLint >();
+				GLsizei width = r.get< GLsizei >();
+				glViewport(x, y, width, r.get< GLsizei >());
+			} break;
+			case Call::Count: break;
+		}
+
+		//'frame' is the index of the frame this call is part of; frame 0 is setup (loads, compiles, uploads):
+		size_t c = size_t(call);
+		if (frame == 0) {
+			stats->setup_counts[c] += 1;
+		}
+		if (frame >= options.warmup && frame > 0) {
+			stats->counts[c] += 1;
+			stats->ms[c] += std::chrono::duration< double, std::milli >(Clock::now() - call_start).count();
+		}
+	}
+	if (frame == 0) std::cerr << "WARNING: capture has no complete frames." << std::endl;
+
+	//(objects made by the capture go away with the context)
+}
+
+} //namespace
+
+int main(int argc, char **argv) {
+	Options options;
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		if (arg == "-no-finish") {
+			options.finish = false;
+		} else if (arg == "-warmup" && i + 1 < argc) {
+			options.warmup = uint32_t(std::atoi(argv[++i]));
+		} else if (arg == "-loops" && i + 1 < argc) {
+			options.loops = std::max(1, std::atoi(argv[++i]));
+		} else if (options.capture.empty() && arg[0] != '-') {
+			options.capture = arg;
+		} else {
+			std::cerr << "Unknown option '" << arg << "'." << std::endl;
+			options.capture.clear();
+			break;
+		}
+	}
+	if (options.capture.empty()) {
+		std::cerr << "usage: glreplay <capture.glcap> [-warmup 1] [-loops 1] [-no-finish]" << std::endl;
+		return 1;
+	}
+
+	try {
+		MappedFile mapped(options.capture);
+		ChunkFile file(mapped.begin(), mapped.end(), options.capture);
+		std::vector< uint32_t > header;
+		file.read("cap0", &header);
+		if (header.size() < 4 || header[0] != 1) throw std::runtime_error("'" + options.capture + "' isn't a version 1 capture.");
+		uint32_t frames = header[1];
+		//"str0" is vendor, renderer, version, each followed by '\0':
+		std::vector< char > str0;
+		file.read("str0", &str0);
+		std::vector< std::string > strings;
+		for (auto begin = str0.begin(); begin != str0.end(); ) {
+			auto end = std::find(begin, str0.end(), '\0');
+			strings.emplace_back(begin, end);
+			begin = (end == str0.end() ? end : end + 1);
+		}
+		strings.resize(3);
+
+		Stats stats;
+		for (uint32_t loop = 0; loop < options.loops; ++loop) {
+			//(a fresh context each loop, since the capture starts from nothing)
+			HeadlessGL gl(std::max(header[2], 1U), std::max(header[3], 1U));
+			if (loop == 0) {
+				std::cout << "Replaying " << frames << " frames captured on '" << strings[1] << "' on '"
+					<< reinterpret_cast< char const * >(glGetString(GL_RENDERER)) << "'." << std::endl;
+			}
+			replay(options, file, &stats);
+		}
+
+		//---- report ----
+		std::cout << std::fixed << std::setprecision(3);
+		auto summary = [](char const *what, std::vector< float > const &samples) {
+			PassTimers::Summary s = PassTimers::summarize(samples);
+			std::cout << "  " << std::left << std::setw(8) << what << std::right
+				<< " min " << std::setw(8) << s.min << "  avg " << std::setw(8) << s.avg
+				<< "  median " << std::setw(8) << s.median << "  p99 " << std::setw(8) << s.p99 << " ms\n";
+		};
+		std::cout << "Frame times over " << stats.timed_frames << " frames (after " << options.warmup << " warmup each loop):\n";
+		summary("submit", stats.submit_ms);
+		if (options.finish) summary("frame", stats.frame_ms);
+
+		std::vector< size_t > order;
+		for (size_t c = 0; c < size_t(GLCapture::Call::Count); ++c) {
+			if (stats.counts[c] || stats.setup_counts[c]) order.emplace_back(c);
+		}
+		std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return stats.ms[a] > stats.ms[b]; });
+		std::cout << "Calls (per frame counts and CPU time are over timed frames; setup is the first frame, with all the loading):\n";
+		std::cout << "  " << std::left << std::setw(28) << "call" << std::right << std::setw(10) << "setup"
+			<< std::setw(12) << "per frame" << std::setw(12) << "ms/frame" << std::setw(12) << "us/call" << "\n";
+		float per = (stats.timed_frames ? 1.0f / stats.timed_frames : 0.0f);
+		for (size_t c : order) {
+			std::cout << "  " << std::left << std::setw(28) << GLCapture::call_name(GLCapture::Call(c)) << std::right
+				<< std::setw(10) << stats.setup_counts[c] / options.loops
+				<< std::setw(12) << std::setprecision(1) << stats.counts[c] * per
+				<< std::setw(12) << std::setprecision(3) << stats.ms[c] * per
+				<< std::setw(12) << (stats.counts[c] ? 1000.0 * stats.ms[c] / stats.counts[c] : 0.0) << "\n";
+		}
+		std::cout.flush();
+	} catch (std::exception const &e) {
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+	return 0;
+}
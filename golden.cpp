@@ -0,0 +1,390 @@
+//golden renders test cases with the full pipeline (GameMode::draw) in a hidden window and compares
+// each one against a stored golden image, so shader and pipeline changes can't drift the look unnoticed.
+//
+//Cases are listed in renders/golden.txt, one per line:
+//   <name> [-scene <scene>] [-size <W>x<H>] [parameter flags, as for main: -blur 10 -show 4 ...]
+// and case <name> is compared against renders/<name>.png.
+//
+//A case fails if either:
+//   - more than -max-bad (fraction) of its pixels differ by more than -tolerance in any channel, or
+//   - the mean structural similarity (SSIM, on luma, 8x8 windows) is below -min-ssim
+// (the first catches localized breakage, the second broad shifts in tone or texture that small
+//  per-pixel tolerances let through).
+//Every rendered case is written to <out>/<name>.png, and cases that aren't identical to their golden
+// get a heatmap of the differences at <out>/<name>.diff.png (gray: same; blue through red to yellow: larger differences).
+//
+// usage: golden [-cases renders/golden.txt] [-out golden-out] [-only <substring>] [-update]
+//               [-tolerance 4] [-max-bad 0.001] [-min-ssim 0.99]
+//   -update rewrites the golden images from the current renders (after checking the change is intended!)
+// exits with status 1 if any case fails.
+
+#include "GameMode.hpp"
+#include "Load.hpp"
+#include "GL.hpp"
+#include "HeadlessGL.hpp"
+#include "load_save_png.hpp"
+#include "parameters.hpp"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+extern std::string file; //scene loaded by GameMode (see GameMode.cpp)
+
+namespace {
+
+struct Options {
+	std::string cases = "renders/golden.txt";
+	std::string out = "golden-out";
+	std::string only;
+	bool update = false;
+	int tolerance = 4;
+	double max_bad = 0.001;
+	double min_ssim = 0.99;
+};
+
+struct Case {
+	std::string name;
+	std::string scene = "test";
+	glm::uvec2 size = glm::uvec2(2420, 1311); //(main's default window size, which the stored renders use)
+	std::vector< std::pair< std::string, std::string > > parameters; //flag, value
+};
+
+std::vector< Case > read_cases(Options const &options) {
+	std::ifstream in(options.cases);
+	if (!in) throw std::runtime_error("Can't read cases from '" + options.cases + "'.");
+	std::vector< Case > cases;
+	std::string line;
+	uint32_t line_number = 0;
+	while (std::getline(in, line)) {
+		++line_number;
+		if (line.empty() || line[0] == '#') continue;
+		std::istringstream words(line);
+		Case c;
+		if (!(words >> c.name)) continue;
+		std::string flag, value;
+		while (words >> flag) {
+			if (!(words >> value)) {
+				throw std::runtime_error(options.cases + ":" + std::to_string(line_number) + ": expecting a value after '" + flag + "'.");
+			}
+			if (flag == "-scene") {
+				c.scene = value;
+			} else if (flag == "-size") {
+				if (std::sscanf(value.c_str(), "%ux%u", &c.size.x, &c.size.y) != 2) {
+					throw std::runtime_error(options.cases + ":" + std::to_string(line_number) + ": expecting -size WIDTHxHEIGHT.");
+				}
+			} else {
+				c.parameters.emplace_back(flag, value);
+			}
+		}
+		if (!options.only.empty() && c.name.find(options.only) == std::string::npos) continue;
+		cases.emplace_back(c);
+	}
+	return cases;
+}
+
+//make the directories leading up to 'path':
+void make_parent_directories(std::string const &path) {
+	for (size_t slash = path.find('/'); slash != std::string::npos; slash = path.find('/', slash + 1)) {
+		std::string dir = path.substr(0, slash);
+		if (dir.empty()) continue;
+		#ifdef _WIN32
+		_mkdir(dir.c_str());
+		#else
+		mkdir(dir.c_str(), 0755);
+		#endif
+	}
+}
+
+struct Comparison {
+	bool same_size = false;
+	uint32_t max_difference = 0; //largest per-channel difference
+	double bad_fraction = 0.0; //pixels with a channel differing by more than the tolerance
+	double ssim = 0.0;
+};
+
+//mean SSIM over 8x8 windows (stride 4) of luma:
+double mean_ssim(glm::uvec2 size, std::vector< glm::u8vec4 > const &a, std::vector< glm::u8vec4 > const &b) {
+	auto luma = [](std::vector< glm::u8vec4 > const &image) {
+		std::vector< float > ret(image.size());
+		for (size_t i = 0; i < image.size(); ++i) {
+			ret[i] = 0.299f * image[i].r + 0.587f * image[i].g + 0.114f * image[i].b;
+		}
+		return ret;
+	};
+	std::vector< float > la = luma(a), lb = luma(b);
+
+	const uint32_t Window = 8, Stride = 4;
+	const double C1 = (0.01 * 255.0) * (0.01 * 255.0);
+	const double C2 = (0.03 * 255.0) * (0.03 * 255.0);
+	double total = 0.0;
+	uint32_t windows = 0;
+	for (uint32_t y = 0; y + Window <= size.y; y += Stride) {
+		for (uint32_t x = 0; x + Window <= size.x; x += Stride) {
+			double sa = 0.0, sb = 0.0, saa = 0.0, sbb = 0.0, sab = 0.0;
+			for (uint32_t wy = 0; wy < Window; ++wy) {
+				for (uint32_t wx = 0; wx < Window; ++wx) {
+					size_t i = size_t(y + wy) * size.x + (x + wx);
+					sa += la[i]; sb += lb[i];
+					saa += la[i] * la[i]; sbb += lb[i] * lb[i]; sab += la[i] * lb[i];
+				}
+			}
+			const double n = Window * Window;
+			double ma = sa / n, mb = sb / n;
+			double va = saa / n - ma * ma, vb = sbb / n - mb * mb, cov = sab / n - ma * mb;
+			total += ((2.0 * ma * mb + C1) * (2.0 * cov + C2)) / ((ma * ma + mb * mb + C1) * (va + vb + C2));
+			windows += 1;
+		}
+	}
+	return (windows ? total / windows : 1.0);
+}
+
+Comparison compare(Options const &options,
+	glm::uvec2 size, std::vector< glm::u8vec4 > const &image,
+	glm::uvec2 golden_size, std::vector< glm::u8vec4 > const &golden,
+	std::vector< glm::u8vec4 > *heatmap) {
+	Comparison ret;
+	if (size != golden_size) return ret;
+	ret.same_size = true;
+
+	heatmap->resize(image.size());
+	size_t bad = 0;
+	for (size_t i = 0; i < image.size(); ++i) {
+		glm::ivec4 d = glm::abs(glm::ivec4(image[i]) - glm::ivec4(golden[i]));
+		uint32_t diff = uint32_t(std::max(std::max(d.r, d.g), std::max(d.b, d.a)));
+		ret.max_difference = std::max(ret.max_difference, diff);
+		if (diff > uint32_t(options.tolerance)) bad += 1;
+
+		if (diff == 0) {
+			//dim gray version of the golden, for context:
+			uint8_t l = uint8_t((golden[i].r + golden[i].g + golden[i].b) / 12);
+			(*heatmap)[i] = glm::u8vec4(l, l, l, 0xff);
+		} else {
+			//blue (1) -> red (32) -> yellow (64+):
+			float t = std::min(1.0f, diff / 64.0f);
+			glm::vec3 color = (t < 0.5f
+				? glm::mix(glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(1.0f, 0.0f, 0.0f), t * 2.0f)
+				: glm::mix(glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(1.0f, 1.0f, 0.0f), t * 2.0f - 1.0f));
+			(*heatmap)[i] = glm::u8vec4(glm::u8vec3(color * 255.0f), 0xff);
+		}
+	}
+	ret.bad_fraction = (image.empty() ? 0.0 : double(bad) / image.size());
+	ret.ssim = mean_ssim(size, image, golden);
+	return ret;
+}
+
+//------ child: render and check the cases for one scene ------
+
+int run_scene(Options const &options, std::string const &scene, std::string const &results_file) {
+	std::ofstream results(results_file, std::ios::binary);
+	file = scene;
+
+	std::unique_ptr< HeadlessGL > gl;
+	std::shared_ptr< GameMode > game;
+	try {
+		gl.reset(new HeadlessGL);
+		call_load_functions();
+		game = std::make_shared< GameMode >();
+	} catch (std::exception const &e) {
+		results << "FAIL (scene '" << scene << "') " << e.what() << "\n";
+		return 1;
+	}
+
+	bool failed = false;
+	for (auto const &c : read_cases(options)) {
+		if (c.scene != scene) continue;
+
+		//render the way 'main ... -save' does: parameters from defaults + flags, one frame at time zero:
+		Parameters::reset();
+		std::string unknown;
+		for (auto const &p : c.parameters) {
+			if (!Parameters::set_from_arg(p.first, p.second.c_str())) unknown = p.first;
+		}
+		if (!unknown.empty()) {
+			results << "FAIL " << c.name << ": unknown flag '" << unknown << "'\n";
+			failed = true;
+			continue;
+		}
+		game->update(0.0f);
+		//(same default state main sets before each draw)
+		glClearColor(0.5, 0.5, 0.5, 0.0);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		glEnable(GL_DEPTH_TEST);
+		glEnable(GL_BLEND);
+		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		game->draw(c.size);
+
+		glm::uvec2 size;
+		std::vector< glm::u8vec4 > image;
+		game->read_screen(&size, &image);
+
+		std::string out_png = options.out + "/" + c.name + ".png";
+		make_parent_directories(out_png);
+		save_png(out_png, size, image.data(), LowerLeftOrigin);
+
+		std::string golden_png = "renders/" + c.name + ".png";
+		if (options.update) {
+			make_parent_directories(golden_png);
+			save_png(golden_png, size, image.data(), LowerLeftOrigin);
+			results << "UPDATED " << c.name << "\n";
+			continue;
+		}
+
+		glm::uvec2 golden_size;
+		std::vector< glm::u8vec4 > golden;
+		try {
+			load_png(golden_png, &golden_size, &golden, LowerLeftOrigin);
+		} catch (std::exception const &e) {
+			results << "FAIL " << c.name << ": no golden image (" << e.what() << "); run with -update to make one\n";
+			failed = true;
+			continue;
+		}
+
+		std::vector< glm::u8vec4 > heatmap;
+		Comparison result = compare(options, size, image, golden_size, golden, &heatmap);
+		if (!result.same_size) {
+			results << "FAIL " << c.name << ": rendered " << size.x << "x" << size.y
+				<< " but golden is " << golden_size.x << "x" << golden_size.y << "\n";
+			failed = true;
+			continue;
+		}
+		if (result.max_difference != 0) {
+			save_png(options.out + "/" + c.name + ".diff.png", size, heatmap.data(), LowerLeftOrigin);
+		}
+		bool pass = (result.bad_fraction <= options.max_bad && result.ssim >= options.min_ssim);
+		char stats[128];
+		std::snprintf(stats, sizeof(stats), "max diff %u, %.4f%% over tolerance, ssim %.5f",
+			result.max_difference, 100.0 * result.bad_fraction, result.ssim);
+		results << (pass ? "PASS " : "FAIL ") << c.name << ": " << stats << "\n";
+		if (!pass) failed = true;
+	}
+
+	game.reset();
+	return (failed ? 1 : 0);
+}
+
+std::string quote_arg(std::string const &arg) {
+	return "\"" + arg + "\"";
+}
+
+} //namespace
+
+int main(int argc, char **argv) {
+	Options options;
+	std::string child_scene, child_results;
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		if (arg == "-update") {
+			options.update = true;
+			continue;
+		}
+		if (i + 1 >= argc) {
+			std::cerr << "Expecting a value after '" << arg << "'." << std::endl;
+			return 1;
+		}
+		std::string value = argv[++i];
+		if (arg == "-cases") options.cases = value;
+		else if (arg == "-out") options.out = value;
+		else if (arg == "-only") options.only = value;
+		else if (arg == "-tolerance") options.tolerance = std::atoi(value.c_str());
+		else if (arg == "-max-bad") options.max_bad = std::atof(value.c_str());
+		else if (arg == "-min-ssim") options.min_ssim = std::atof(value.c_str());
+		else if (arg == "-child" && i + 1 < argc) {
+			child_scene = value;
+			child_results = argv[++i];
+		} else {
+			std::cerr << "Unknown option '" << arg << "'." << std::endl;
+			return 1;
+		}
+	}
+
+	try {
+		if (!child_scene.empty()) {
+			return run_scene(options, child_scene, child_results);
+		}
+
+		//------ parent: one child process per scene (loads happen once per process; see Load.hpp) ------
+		std::vector< std::string > scenes;
+		std::map< std::string, std::vector< std::string > > scene_cases; //scene -> case names, to spot missing results
+		uint32_t total = 0;
+		for (auto const &c : read_cases(options)) {
+			if (std::find(scenes.begin(), scenes.end(), c.scene) == scenes.end()) scenes.emplace_back(c.scene);
+			scene_cases[c.scene].emplace_back(c.name);
+			total += 1;
+		}
+		if (total == 0) {
+			std::cerr << "No cases to run." << std::endl;
+			return 1;
+		}
+
+		make_parent_directories(options.out + "/");
+		std::vector< std::string > lines;
+		for (auto const &scene : scenes) {
+			std::string results_file = options.out + "/" + scene + ".results";
+			std::remove(results_file.c_str());
+			char tolerance[128];
+			std::snprintf(tolerance, sizeof(tolerance), " -tolerance %d -max-bad %g -min-ssim %g",
+				options.tolerance, options.max_bad, options.min_ssim);
+			std::string command = quote_arg(argv[0])
+				+ " -cases " + quote_arg(options.cases)
+				+ " -out " + quote_arg(options.out)
+				+ (options.only.empty() ? "" : " -only " + quote_arg(options.only))
+				+ (options.update ? " -update" : "")
+				+ tolerance
+				+ " -child " + quote_arg(scene) + " " + quote_arg(results_file);
+			int status = std::system(command.c_str());
+
+			//"<PASS|FAIL|UPDATED> <name>[: ...]" per case; a child that died mid-scene leaves cases without a line:
+			std::ifstream in(results_file, std::ios::binary);
+			std::string line;
+			std::vector< std::string > reported;
+			bool any_failed = false;
+			while (std::getline(in, line)) {
+				if (in.eof()) break; //(unterminated: the child died while writing it)
+				lines.emplace_back(line);
+				std::istringstream words(line);
+				std::string verdict, name;
+				words >> verdict >> name;
+				if (!name.empty() && name.back() == ':') name.pop_back();
+				reported.emplace_back(name);
+				if (verdict == "FAIL") any_failed = true;
+			}
+			for (auto const &name : scene_cases[scene]) {
+				if (std::find(reported.begin(), reported.end(), name) != reported.end()) continue;
+				lines.emplace_back("FAIL " + name + ": no result (renderer exited with status " + std::to_string(status) + ")");
+				any_failed = true;
+			}
+			if (status != 0 && !any_failed) {
+				lines.emplace_back("FAIL (scene '" + scene + "') renderer exited with status " + std::to_string(status));
+			}
+		}
+
+		uint32_t failed = 0;
+		std::cout << "\n";
+		for (auto const &line : lines) {
+			std::cout << line << "\n";
+			if (line.compare(0, 4, "FAIL") == 0) failed += 1;
+		}
+		std::cout << "\n" << (lines.size() - failed) << " of " << lines.size() << " golden checks passed"
+			<< " (renders and difference heatmaps are in '" << options.out << "')." << std::endl;
+		return (failed ? 1 : 0);
+	} catch (std::exception const &e) {
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+}
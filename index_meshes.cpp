@@ -0,0 +1,479 @@
+//index_meshes converts a non-indexed mesh file (as written by meshes/export-meshes.py) into
+// the indexed layout that MeshBuffer also loads:
+//   vertex chunk ("pgct", etc; duplicate vertices removed)
+//   "i16." or "i32." index chunk (absolute vertex indices)
+//   "str0" names
+//   "idx1" entries: name_begin, name_end, index_begin, index_end
+//   "crc0" CRC-32 of each chunk before it (see ChunkFile.hpp)
+// Each mesh's triangles are reordered for the post-transform vertex cache (Forsyth's
+// "Linear-Speed Vertex Cache Optimisation"), and its vertices are then laid out in
+// order of first use.
+//
+// With -quantize, "pgct" vertices are also quantized to the 28-byte "pgcq" layout:
+//   Position as snorm16x4 relative to the mesh's bounding box (listed in an extra "box0" chunk),
+//   GeoNormal/Normal octahedral-encoded as snorm16x2, colors as-is, and TexCoord as half floats.
+//
+// usage: index_meshes [-quantize] <in> <out>    (in and out may be the same file; already-indexed files are passed
+//   through, except that -quantize expands an indexed "pgct" file through its indices and quantizes it)
+
+#include "ChunkFile.hpp"
+#include "MappedFile.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+struct IndexEntry {
+	uint32_t name_begin, name_end;
+	uint32_t begin, end; //vertex range (idx0) or index range (idx1)
+};
+static_assert(sizeof(IndexEntry) == 16, "Index entry should be packed");
+
+//vertex sizes of the formats MeshBuffer knows:
+uint32_t vertex_size_for(std::string const &magic) {
+	if (magic == "p...") return 3*4;
+	if (magic == "pn..") return 3*4+3*4;
+	if (magic == "pnc.") return 3*4+3*4+4*1;
+	if (magic == "pnct") return 3*4+3*4+4*2+2*4;
+	if (magic == "pgct") return 3*4+3*4+3*4+4*2+2*4;
+	throw std::runtime_error("Unknown vertex chunk '" + magic + "'");
+}
+
+//---- quantization ----
+struct SourceVertex { //"pgct"
+	float Position[3];
+	float GeoNormal[3];
+	float Normal[3];
+	uint8_t Color[4];
+	uint8_t ControlColor[4];
+	float TexCoord[2];
+};
+static_assert(sizeof(SourceVertex) == 52, "SourceVertex is packed.");
+
+struct QuantizedVertex { //"pgcq" (must match MeshBuffer.cpp)
+	int16_t Position[4];
+	int16_t GeoNormal[2];
+	int16_t Normal[2];
+	uint8_t Color[4];
+	uint8_t ControlColor[4];
+	uint16_t TexCoord[2];
+};
+static_assert(sizeof(QuantizedVertex) == 28, "QuantizedVertex is packed.");
+
+struct Box {
+	float min[3], max[3];
+};
+static_assert(sizeof(Box) == 24, "Box should be packed");
+
+int16_t to_snorm16(float f) {
+	f = std::max(-1.0f, std::min(1.0f, f));
+	return int16_t(std::round(f * 32767.0f));
+}
+
+//octahedral encoding of a unit vector (decoded by oct_decode in scene_program.cpp):
+void oct_encode(float const n[3], int16_t out[2]) {
+	float l1 = std::abs(n[0]) + std::abs(n[1]) + std::abs(n[2]);
+	if (l1 == 0.0f) {
+		out[0] = out[1] = 0;
+		return;
+	}
+	float x = n[0] / l1, y = n[1] / l1;
+	if (n[2] < 0.0f) {
+		float fx = (1.0f - std::abs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+		float fy = (1.0f - std::abs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+		x = fx;
+		y = fy;
+	}
+	out[0] = to_snorm16(x);
+	out[1] = to_snorm16(y);
+}
+
+//float to IEEE half, rounding to nearest even:
+uint16_t to_half(float f) {
+	uint32_t x;
+	std::memcpy(&x, &f, sizeof(x));
+	uint32_t sign = (x >> 16) & 0x8000;
+	uint32_t exponent = (x >> 23) & 0xff;
+	uint32_t mantissa = x & 0x7fffff;
+	if (exponent == 0xff) return uint16_t(sign | 0x7c00 | (mantissa ? 0x200 : 0)); //inf / nan
+	int32_t e = int32_t(exponent) - 127 + 15;
+	if (e >= 0x1f) return uint16_t(sign | 0x7c00); //too big: inf
+	uint32_t h, rest, halfway;
+	if (e <= 0) { //subnormal (or zero)
+		if (e < -10) return uint16_t(sign);
+		mantissa |= 0x800000;
+		uint32_t shift = uint32_t(14 - e);
+		h = mantissa >> shift;
+		rest = mantissa & ((1U << shift) - 1);
+		halfway = 1U << (shift - 1);
+	} else {
+		h = (uint32_t(e) << 10) | (mantissa >> 13);
+		rest = mantissa & 0x1fff;
+		halfway = 0x1000;
+	}
+	if (rest > halfway || (rest == halfway && (h & 1))) h += 1; //(may carry into exponent, which is correct)
+	return uint16_t(sign | h);
+}
+
+//quantize vertices [begin,end) of 'source' relative to their bounding box, which is returned in *box:
+std::vector< char > quantize(SourceVertex const *source, uint32_t begin, uint32_t end, Box *box) {
+	for (uint32_t c = 0; c < 3; ++c) {
+		box->min[c] = std::numeric_limits< float >::infinity();
+		box->max[c] = -std::numeric_limits< float >::infinity();
+	}
+	for (uint32_t v = begin; v < end; ++v) {
+		for (uint32_t c = 0; c < 3; ++c) {
+			box->min[c] = std::min(box->min[c], source[v].Position[c]);
+			box->max[c] = std::max(box->max[c], source[v].Position[c]);
+		}
+	}
+	if (begin == end) *box = Box{{0.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 0.0f}};
+
+	//same arithmetic as MeshBuffer uses to decode:
+	float offset[3], scale[3];
+	for (uint32_t c = 0; c < 3; ++c) {
+		offset[c] = 0.5f * (box->max[c] + box->min[c]);
+		scale[c] = 0.5f * (box->max[c] - box->min[c]);
+	}
+
+	std::vector< char > ret((end - begin) * sizeof(QuantizedVertex));
+	for (uint32_t v = begin; v < end; ++v) {
+		SourceVertex const &s = source[v];
+		QuantizedVertex q;
+		for (uint32_t c = 0; c < 3; ++c) {
+			q.Position[c] = (scale[c] > 0.0f ? to_snorm16((s.Position[c] - offset[c]) / scale[c]) : 0);
+		}
+		q.Position[3] = 32767;
+		oct_encode(s.GeoNormal, q.GeoNormal);
+		oct_encode(s.Normal, q.Normal);
+		std::memcpy(q.Color, s.Color, 4);
+		std::memcpy(q.ControlColor, s.ControlColor, 4);
+		q.TexCoord[0] = to_half(s.TexCoord[0]);
+		q.TexCoord[1] = to_half(s.TexCoord[1]);
+		std::memcpy(&ret[(v - begin) * sizeof(QuantizedVertex)], &q, sizeof(q));
+	}
+	return ret;
+}
+
+//---- Forsyth vertex cache optimization ----
+const uint32_t CacheSize = 32;
+
+float vertex_score(int32_t cache_position, uint32_t remaining_triangles) {
+	if (remaining_triangles == 0) return -1.0f; //not needed by any more triangles
+	float score = 0.0f;
+	if (cache_position >= 0) {
+		if (cache_position < 3) {
+			//used by the last triangle; fixed score so that it isn't re-picked right away:
+			score = 0.75f;
+		} else {
+			float scale = 1.0f / float(CacheSize - 3);
+			score = std::pow(1.0f - float(cache_position - 3) * scale, 1.5f);
+		}
+	}
+	//boost vertices with few triangles left, so that lone triangles don't get stranded:
+	score += 2.0f * std::pow(float(remaining_triangles), -0.5f);
+	return score;
+}
+
+//reorder 'indices' (a triangle list over vertices [0,vertex_count)) in place:
+void optimize_triangle_order(std::vector< uint32_t > &indices, uint32_t vertex_count) {
+	uint32_t triangle_count = uint32_t(indices.size() / 3);
+	if (triangle_count == 0) return;
+
+	//vertex -> triangles adjacency:
+	std::vector< uint32_t > adjacency_begin(vertex_count + 1, 0);
+	for (uint32_t i : indices) adjacency_begin[i + 1] += 1;
+	for (uint32_t v = 0; v < vertex_count; ++v) adjacency_begin[v + 1] += adjacency_begin[v];
+	std::vector< uint32_t > adjacency(indices.size());
+	{
+		std::vector< uint32_t > fill(adjacency_begin.begin(), adjacency_begin.end() - 1);
+		for (uint32_t t = 0; t < triangle_count; ++t) {
+			for (uint32_t c = 0; c < 3; ++c) {
+				adjacency[fill[indices[3*t+c]]++] = t;
+			}
+		}
+	}
+
+	std::vector< uint32_t > remaining(vertex_count);
+	std::vector< int32_t > cache_position(vertex_count, -1);
+	std::vector< float > score(vertex_count);
+	for (uint32_t v = 0; v < vertex_count; ++v) {
+		remaining[v] = adjacency_begin[v + 1] - adjacency_begin[v];
+		score[v] = vertex_score(-1, remaining[v]);
+	}
+
+	std::vector< bool > emitted(triangle_count, false);
+	std::vector< float > triangle_score(triangle_count);
+	for (uint32_t t = 0; t < triangle_count; ++t) {
+		triangle_score[t] = score[indices[3*t+0]] + score[indices[3*t+1]] + score[indices[3*t+2]];
+	}
+
+	std::vector< uint32_t > cache; //most recently used first
+	cache.reserve(CacheSize + 3);
+	std::vector< uint32_t > output;
+	output.reserve(indices.size());
+
+	uint32_t best = 0;
+	for (uint32_t t = 1; t < triangle_count; ++t) {
+		if (triangle_score[t] > triangle_score[best]) best = t;
+	}
+	uint32_t scan = 0; //for finding a fresh start when nothing in the cache has triangles left
+
+	for (uint32_t done = 0; done < triangle_count; ++done) {
+		if (best == -1U) {
+			while (emitted[scan]) ++scan;
+			best = scan;
+			for (uint32_t t = scan + 1; t < triangle_count; ++t) {
+				if (!emitted[t] && triangle_score[t] > triangle_score[best]) best = t;
+			}
+		}
+
+		//emit triangle:
+		emitted[best] = true;
+		for (uint32_t c = 0; c < 3; ++c) {
+			uint32_t v = indices[3*best+c];
+			output.emplace_back(v);
+			remaining[v] -= 1;
+			//remove triangle from the vertex's list of remaining triangles:
+			uint32_t *list = &adjacency[adjacency_begin[v]];
+			uint32_t *list_end = list + remaining[v] + 1;
+			*std::find(list, list_end, best) = list_end[-1];
+		}
+
+		//move its vertices to the front of the cache:
+		std::vector< uint32_t > next_cache;
+		next_cache.reserve(CacheSize + 3);
+		for (uint32_t c = 0; c < 3; ++c) next_cache.emplace_back(indices[3*best+c]);
+		for (uint32_t v : cache) {
+			if (v != next_cache[0] && v != next_cache[1] && v != next_cache[2]) next_cache.emplace_back(v);
+		}
+		//vertices that fell out of the cache:
+		for (uint32_t i = CacheSize; i < next_cache.size(); ++i) {
+			cache_position[next_cache[i]] = -1;
+			score[next_cache[i]] = vertex_score(-1, remaining[next_cache[i]]);
+		}
+		if (next_cache.size() > CacheSize) next_cache.resize(CacheSize);
+		cache.swap(next_cache);
+
+		//rescore vertices in the cache and the triangles they touch, picking the next best:
+		for (uint32_t i = 0; i < cache.size(); ++i) {
+			cache_position[cache[i]] = int32_t(i);
+			score[cache[i]] = vertex_score(int32_t(i), remaining[cache[i]]);
+		}
+		best = -1U;
+		float best_score = -1.0f;
+		for (uint32_t v : cache) {
+			for (uint32_t a = adjacency_begin[v]; a < adjacency_begin[v] + remaining[v]; ++a) {
+				uint32_t t = adjacency[a];
+				triangle_score[t] = score[indices[3*t+0]] + score[indices[3*t+1]] + score[indices[3*t+2]];
+				if (triangle_score[t] > best_score) {
+					best_score = triangle_score[t];
+					best = t;
+				}
+			}
+		}
+	}
+
+	indices.swap(output);
+}
+
+//average cache miss ratio (vertex shader runs per triangle) with a FIFO cache of 'size' entries:
+float acmr(std::vector< uint32_t > const &indices, uint32_t size) {
+	if (indices.empty()) return 0.0f;
+	std::vector< uint32_t > fifo;
+	uint32_t misses = 0;
+	for (uint32_t i : indices) {
+		if (std::find(fifo.begin(), fifo.end(), i) != fifo.end()) continue;
+		misses += 1;
+		fifo.insert(fifo.begin(), i);
+		if (fifo.size() > size) fifo.pop_back();
+	}
+	return float(misses) / float(indices.size() / 3);
+}
+
+//(also appends the chunk's CRC-32 to *crcs, if given, for the final "crc0" chunk)
+template< typename T >
+void write_chunk(std::ostream &to, std::string const &magic, T const *data, size_t count, std::vector< uint32_t > *crcs) {
+	assert(magic.size() == 4);
+	uint32_t size = uint32_t(count * sizeof(T));
+	to.write(magic.data(), 4);
+	to.write(reinterpret_cast< char const * >(&size), 4);
+	to.write(reinterpret_cast< char const * >(data), size);
+	if (crcs) crcs->emplace_back(chunk_crc32(reinterpret_cast< char const * >(data), size));
+}
+
+} //namespace
+
+int main(int argc, char **argv) {
+	bool quantize_vertices = (argc == 4 && std::string(argv[1]) == "-quantize");
+	if (argc != 3 && !quantize_vertices) {
+		std::cerr << "usage:\n\t" << argv[0] << " [-quantize] <in> <out>" << std::endl;
+		return 1;
+	}
+	std::string in_filename = argv[argc-2];
+	std::string out_filename = argv[argc-1];
+
+	try {
+		//read everything first so that 'in' and 'out' can be the same file:
+		std::string magic;
+		std::vector< char > vertex_data;
+		std::vector< char > strings;
+		std::vector< IndexEntry > index;
+		{
+			MappedFile file(in_filename);
+			ChunkFile chunks(file.begin(), file.end(), in_filename);
+			chunks.verify(); //(if the file has checksums)
+			if (chunks.chunks.empty()) throw std::runtime_error("'" + in_filename + "' is empty");
+			magic = chunks.chunks[0].get_magic();
+			chunks.read(magic, &vertex_data);
+			bool indexed = (chunks.has("i16.") || chunks.has("i32."));
+			if (indexed && !(quantize_vertices && magic == "pgct")) {
+				std::cout << in_filename << ": already " << (magic == "pgcq" ? "quantized" : "indexed") << "." << std::endl;
+				if (in_filename != out_filename) {
+					std::ofstream out(out_filename, std::ios::binary);
+					out.write(file.data, file.size);
+				}
+				return 0;
+			}
+			chunks.read("str0", &strings);
+			if (indexed) {
+				//quantizing an already-indexed file: expand it back through its indices (and index it again, below):
+				std::vector< uint32_t > indices;
+				if (chunks.has("i16.")) {
+					std::vector< uint16_t > short_indices;
+					chunks.read("i16.", &short_indices);
+					indices.assign(short_indices.begin(), short_indices.end());
+				} else {
+					chunks.read("i32.", &indices);
+				}
+				std::vector< IndexEntry > indexed_entries;
+				chunks.read("idx1", &indexed_entries);
+				uint32_t vertex_size = vertex_size_for(magic);
+				uint32_t vertex_count = uint32_t(vertex_data.size() / vertex_size);
+				std::vector< char > expanded;
+				for (auto const &entry : indexed_entries) {
+					if (!(entry.begin <= entry.end && entry.end <= indices.size())) {
+						throw std::runtime_error("index entry has out-of-range index start/count");
+					}
+					IndexEntry out_entry = entry;
+					out_entry.begin = uint32_t(expanded.size() / vertex_size);
+					for (uint32_t i = entry.begin; i < entry.end; ++i) {
+						if (indices[i] >= vertex_count) throw std::runtime_error("index out of range");
+						char const *src = &vertex_data[size_t(indices[i]) * vertex_size];
+						expanded.insert(expanded.end(), src, src + vertex_size);
+					}
+					out_entry.end = uint32_t(expanded.size() / vertex_size);
+					index.emplace_back(out_entry);
+				}
+				vertex_data = std::move(expanded);
+			} else {
+				chunks.read("idx0", &index);
+			}
+		}
+		uint32_t vertex_size = vertex_size_for(magic);
+		if (vertex_data.size() % vertex_size != 0) throw std::runtime_error("vertex chunk size is not a multiple of vertex size");
+		uint32_t total = uint32_t(vertex_data.size() / vertex_size);
+		if (quantize_vertices && magic != "pgct") {
+			throw std::runtime_error("only pgct meshes can be quantized");
+		}
+		std::string out_magic = (quantize_vertices ? "pgcq" : magic);
+		uint32_t out_vertex_size = (quantize_vertices ? uint32_t(sizeof(QuantizedVertex)) : vertex_size);
+
+		std::vector< char > out_vertices;
+		std::vector< Box > out_boxes;
+		std::vector< uint32_t > out_indices;
+		std::vector< IndexEntry > out_index;
+		uint32_t before_misses = 0, after_misses = 0;
+
+		for (auto const &entry : index) {
+			if (!(entry.begin <= entry.end && entry.end <= total)) {
+				throw std::runtime_error("index entry has out-of-range vertex start/count");
+			}
+			if ((entry.end - entry.begin) % 3 != 0) {
+				throw std::runtime_error("mesh vertex count is not a multiple of three");
+			}
+
+			//this mesh's vertices, in the output format:
+			std::vector< char > mesh_data;
+			if (quantize_vertices) {
+				Box box;
+				mesh_data = quantize(reinterpret_cast< SourceVertex const * >(vertex_data.data()), entry.begin, entry.end, &box);
+				out_boxes.emplace_back(box);
+			} else {
+				mesh_data.assign(vertex_data.begin() + entry.begin * vertex_size, vertex_data.begin() + entry.end * vertex_size);
+			}
+
+			//de-duplicate this mesh's vertices (exact byte match, so after quantization):
+			std::unordered_map< std::string, uint32_t > lookup;
+			std::vector< uint32_t > first_vertex; //local index -> vertex in mesh_data
+			std::vector< uint32_t > indices;
+			indices.reserve(entry.end - entry.begin);
+			for (uint32_t v = 0; v < entry.end - entry.begin; ++v) {
+				std::string key(&mesh_data[v * out_vertex_size], out_vertex_size);
+				auto f = lookup.insert(std::make_pair(key, uint32_t(first_vertex.size())));
+				if (f.second) first_vertex.emplace_back(v);
+				indices.emplace_back(f.first->second);
+			}
+
+			//(unoptimized order is just the original triangle order)
+			before_misses += uint32_t(acmr(indices, 16) * (indices.size() / 3) + 0.5f);
+			optimize_triangle_order(indices, uint32_t(first_vertex.size()));
+			after_misses += uint32_t(acmr(indices, 16) * (indices.size() / 3) + 0.5f);
+
+			//lay out vertices in order of first use and write absolute indices:
+			uint32_t vertex_base = uint32_t(out_vertices.size() / out_vertex_size);
+			std::vector< uint32_t > remap(first_vertex.size(), -1U);
+			uint32_t next = 0;
+			IndexEntry out_entry = entry;
+			out_entry.begin = uint32_t(out_indices.size());
+			for (uint32_t i : indices) {
+				if (remap[i] == -1U) {
+					remap[i] = next++;
+					char const *src = &mesh_data[first_vertex[i] * out_vertex_size];
+					out_vertices.insert(out_vertices.end(), src, src + out_vertex_size);
+				}
+				out_indices.emplace_back(vertex_base + remap[i]);
+			}
+			out_entry.end = uint32_t(out_indices.size());
+			out_index.emplace_back(out_entry);
+		}
+
+		uint32_t out_total = uint32_t(out_vertices.size() / out_vertex_size);
+		std::ofstream out(out_filename, std::ios::binary);
+		std::vector< uint32_t > crcs;
+		write_chunk(out, out_magic, out_vertices.data(), out_vertices.size(), &crcs);
+		if (out_total <= 0xffff) {
+			std::vector< uint16_t > short_indices(out_indices.begin(), out_indices.end());
+			write_chunk(out, "i16.", short_indices.data(), short_indices.size(), &crcs);
+		} else {
+			write_chunk(out, "i32.", out_indices.data(), out_indices.size(), &crcs);
+		}
+		write_chunk(out, "str0", strings.data(), strings.size(), &crcs);
+		write_chunk(out, "idx1", out_index.data(), out_index.size(), &crcs);
+		if (quantize_vertices) {
+			write_chunk(out, "box0", out_boxes.data(), out_boxes.size(), &crcs);
+		}
+		write_chunk(out, "crc0", crcs.data(), crcs.size(), nullptr);
+		if (!out) throw std::runtime_error("failed to write '" + out_filename + "'");
+
+		uint32_t triangles = total / 3;
+		std::cout << in_filename << ": " << index.size() << " meshes, " << triangles << " triangles, "
+			<< total << " -> " << out_total << " vertices; ACMR (16-entry FIFO) "
+			<< (triangles ? float(before_misses) / triangles : 0.0f) << " -> "
+			<< (triangles ? float(after_misses) / triangles : 0.0f) << "; "
+			<< vertex_data.size() << " -> " << out_vertices.size() << " bytes of vertices" << std::endl;
+	} catch (std::exception &e) {
+		std::cerr << "ERROR: " << e.what() << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
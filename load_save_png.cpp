@@ -1,10 +1,12 @@
 #include "load_save_png.hpp"
+#include "Pack.hpp"
 
 #include <png.h>
 
 #include <iostream>
 #include <fstream>
 #include <cassert>
+#include <cstring>
 #include <vector>
 
 #define LOG_ERROR( X ) std::cerr << X << std::endl
@@ -30,11 +32,49 @@ void load_png(std::string filename, glm::uvec2 *size, std::vector< glm::u8vec4 >
 	}
 }
 
+void load_png(Asset const &asset, glm::uvec2 *size, std::vector< glm::u8vec4 > *data, OriginLocation origin) {
+	assert(size);
+	assert(data);
+
+	if (asset.type == PackEntry::Image) {
+		//already decoded by pack_assets, stored with lower-left origin (and sizes checked by Pack):
+		PackImage image;
+		std::memcpy(&image, asset.data, sizeof(image));
+		*size = glm::uvec2(image.width, image.height);
+		data->resize(size_t(image.width) * image.height);
+		if (data->empty()) return;
+		char const *pixels = asset.data + sizeof(image);
+		if (origin == LowerLeftOrigin) {
+			std::memcpy(data->data(), pixels, data->size() * 4);
+		} else {
+			for (uint32_t y = 0; y < image.height; ++y) {
+				std::memcpy(&(*data)[size_t(image.height - 1 - y) * image.width], pixels + size_t(y) * image.width * 4, image.width * 4);
+			}
+		}
+		return;
+	}
+
+	//decode straight out of the mapped memory:
+	struct MemoryBuf : std::streambuf {
+		MemoryBuf(char const *begin, char const *end) {
+			setg(const_cast< char * >(begin), const_cast< char * >(begin), const_cast< char * >(end));
+		}
+	} buf(asset.begin(), asset.end());
+	std::istream from(&buf);
+	if (!load_png(from, &size->x, &size->y, data, origin)) {
+		throw std::runtime_error("Failed to read PNG image from '" + asset.name + "'.");
+	}
+}
+
 void save_png(std::string filename, unsigned int width, unsigned int height, glm::u8vec4 const *data, OriginLocation origin) {
 	std::ofstream file(filename.c_str(), std::ios::binary);
 	save_png(file, width, height, data, origin);
 }
 
+void save_png(std::string filename, glm::uvec2 size, glm::u8vec4 const *data, OriginLocation origin) {
+	save_png(filename, size.x, size.y, data, origin);
+}
+
 
 static void user_read_data(png_structp png_ptr, png_bytep data, png_size_t length) {
 	std::istream *from = reinterpret_cast< std::istream * >(png_get_io_ptr(png_ptr));
@@ -177,3 +217,74 @@ void save_png(std::ostream &to, unsigned int width, unsigned int height, glm::u8
 
 	return;
 }
+
+PNGWriter::PNGWriter(std::string const &filename_, glm::uvec2 size_) : filename(filename_), size(size_) {
+	file.open(filename.c_str(), std::ios::binary);
+	if (!file) {
+		throw std::runtime_error("Failed to open '" + filename + "' for writing.");
+	}
+
+	png_structp png_ptr = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+	if (png_ptr == NULL) {
+		throw std::runtime_error("Can't create PNG write struct for '" + filename + "'.");
+	}
+	png_infop info_ptr = png_create_info_struct(png_ptr);
+	if (info_ptr == NULL) {
+		png_destroy_write_struct(&png_ptr, NULL);
+		throw std::runtime_error("Can't create PNG info struct for '" + filename + "'.");
+	}
+	png = png_ptr;
+	info = info_ptr;
+
+	png_set_write_fn(png_ptr, &file, user_write_data, user_flush_data);
+	if (setjmp(png_jmpbuf(png_ptr))) {
+		png_destroy_write_struct(&png_ptr, &info_ptr);
+		png = info = nullptr;
+		throw std::runtime_error("Error writing PNG header to '" + filename + "'.");
+	}
+	png_set_IHDR(png_ptr, info_ptr, size.x, size.y, 8, PNG_COLOR_TYPE_RGB_ALPHA, PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_BASE, PNG_FILTER_TYPE_BASE);
+	png_write_info(png_ptr, info_ptr);
+}
+
+PNGWriter::~PNGWriter() {
+	if (png) {
+		png_structp png_ptr = reinterpret_cast< png_structp >(png);
+		png_infop info_ptr = reinterpret_cast< png_infop >(info);
+		png_destroy_write_struct(&png_ptr, &info_ptr);
+	}
+}
+
+void PNGWriter::write_rows(glm::u8vec4 const *data, uint32_t count, OriginLocation origin) {
+	assert(png);
+	if (rows_written + count > size.y) {
+		throw std::runtime_error("Too many rows written to '" + filename + "'.");
+	}
+	png_structp png_ptr = reinterpret_cast< png_structp >(png);
+	if (setjmp(png_jmpbuf(png_ptr))) {
+		throw std::runtime_error("Error writing PNG rows to '" + filename + "'.");
+	}
+	for (uint32_t i = 0; i < count; ++i) {
+		uint32_t row = (origin == UpperLeftOrigin ? i : count - 1 - i);
+		png_write_row(png_ptr, (png_bytep)&(data[size_t(row) * size.x]));
+	}
+	rows_written += count;
+}
+
+void PNGWriter::finish() {
+	assert(png);
+	if (rows_written != size.y) {
+		throw std::runtime_error("Only " + std::to_string(rows_written) + " of " + std::to_string(size.y) + " rows written to '" + filename + "'.");
+	}
+	png_structp png_ptr = reinterpret_cast< png_structp >(png);
+	png_infop info_ptr = reinterpret_cast< png_infop >(info);
+	if (setjmp(png_jmpbuf(png_ptr))) {
+		throw std::runtime_error("Error finishing PNG '" + filename + "'.");
+	}
+	png_write_end(png_ptr, info_ptr);
+	png_destroy_write_struct(&png_ptr, &info_ptr);
+	png = info = nullptr;
+	file.close();
+	if (!file) {
+		throw std::runtime_error("Error closing '" + filename + "'.");
+	}
+}
@@ -2,6 +2,7 @@
 
 #include <glm/glm.hpp>
 
+#include <fstream>
 #include <string>
 #include <vector>
 #include <stdint.h>
@@ -17,4 +18,32 @@ enum OriginLocation {
 
 //NOTE: load_png will throw on error
 void load_png(std::string filename, glm::uvec2 *size, std::vector< glm::u8vec4 > *data, OriginLocation origin);
+//load from an asset (see Pack.hpp); pre-decoded images from a pack are copied without decoding:
+struct Asset;
+void load_png(Asset const &asset, glm::uvec2 *size, std::vector< glm::u8vec4 > *data, OriginLocation origin);
 void save_png(std::string filename, glm::uvec2 size, glm::u8vec4 const *data, OriginLocation origin);
+
+//"PNGWriter" writes a PNG a band of rows at a time, so the whole image never has to be in memory
+// (e.g., posters rendered in tiles; see GameMode::write_tiled_png).
+//Rows go into the file top to bottom; each call to write_rows() adds the next 'count' of them.
+// note: will throw if the file can't be opened or written.
+struct PNGWriter {
+	PNGWriter(std::string const &filename, glm::uvec2 size);
+	~PNGWriter();
+	PNGWriter(PNGWriter const &) = delete;
+	PNGWriter &operator=(PNGWriter const &) = delete;
+
+	//'count' rows of size.x pixels; with LowerLeftOrigin the last row in 'data' is the first written:
+	void write_rows(glm::u8vec4 const *data, uint32_t count, OriginLocation origin);
+	//after all size.y rows are written:
+	void finish();
+
+	std::string filename;
+	glm::uvec2 size;
+	uint32_t rows_written = 0;
+
+	//internals:
+	std::ofstream file;
+	void *png = nullptr; //png_structp
+	void *info = nullptr; //png_infop
+};
@@ -0,0 +1,179 @@
+#include "load_texture.hpp"
+#include "load_save_png.hpp"
+#include "ChunkFile.hpp"
+#include "gl_errors.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <cstring>
+#include <cassert>
+
+//bytes per pixel of the level data, for the format combinations bake_texture writes (0 for anything else):
+static size_t baked_pixel_size(TextureHeader const &header) {
+	if (header.type != GL_UNSIGNED_BYTE) return 0;
+	if (header.internal_format == GL_RGBA8 && header.format == GL_RGBA) return 4;
+	if (header.internal_format == GL_RGB8 && header.format == GL_RGB) return 3;
+	return 0;
+}
+
+//bytes glTexImage2D reads for a level (rows tightly packed, GL_UNPACK_ALIGNMENT 1):
+static size_t baked_level_size(TextureHeader const &header, TextureLevel const &level) {
+	return size_t(level.width) * size_t(level.height) * baked_pixel_size(header);
+}
+
+//check everything about baked data that GL would otherwise trust (so a bad file can't make it read past "dat0"):
+// note: throws on a problem.
+static void check_baked(TextureData const &texture, size_t data_size, std::string const &filename) {
+	if (baked_pixel_size(texture.header) == 0) {
+		throw std::runtime_error("Texture file '" + filename + "' has an unsupported format.");
+	}
+	if (texture.levels.size() != texture.header.levels || texture.levels.empty() || texture.levels.size() > 32) {
+		throw std::runtime_error("Texture file '" + filename + "' has the wrong number of levels.");
+	}
+	if (texture.header.width == 0 || texture.header.height == 0) {
+		throw std::runtime_error("Texture file '" + filename + "' is empty.");
+	}
+	for (uint32_t l = 0; l < texture.levels.size(); ++l) {
+		TextureLevel const &level = texture.levels[l];
+		//(each level halves, down to 1x1)
+		if (level.width != std::max(texture.header.width >> l, 1U) || level.height != std::max(texture.header.height >> l, 1U)) {
+			throw std::runtime_error("Texture file '" + filename + "' has a level " + std::to_string(l) + " of the wrong size.");
+		}
+		if (level.offset > data_size || level.size > data_size - level.offset) {
+			throw std::runtime_error("Texture file '" + filename + "' has a level outside its data.");
+		}
+		if (level.size < baked_level_size(texture.header, level)) {
+			throw std::runtime_error("Texture file '" + filename + "' has a level " + std::to_string(l) + " with too little data.");
+		}
+	}
+}
+
+TextureData load_texture_data(std::string const &name) {
+	if (!has_asset(name + ".tex")) {
+		return load_texture_data(open_asset(name + ".png"));
+	}
+	return load_texture_data(open_asset(name + ".tex"));
+}
+
+TextureData load_texture_data(Asset const &asset) {
+	TextureData ret;
+
+	if (!(asset.name.size() >= 4 && asset.name.substr(asset.name.size()-4) == ".tex")) {
+		load_png(asset, &ret.size, &ret.data, LowerLeftOrigin);
+		return ret;
+	}
+
+	ret.baked = asset;
+	std::string const &filename = ret.baked.name;
+	ChunkFile chunks(ret.baked.begin(), ret.baked.end(), filename);
+
+	std::vector< TextureHeader > header;
+	chunks.read("tex0", &header);
+	if (header.size() != 1) {
+		throw std::runtime_error("Texture file '" + filename + "' should have exactly one header.");
+	}
+	ret.header = header[0];
+	chunks.read("lvl0", &ret.levels);
+
+	ChunkView< char > level_data;
+	chunks.view("dat0", &level_data);
+	ret.level_data = level_data.data();
+	ret.level_data_size = level_data.size();
+	check_baked(ret, ret.level_data_size, filename);
+
+	//read the level data now, so the upload doesn't wait on the disk:
+	ret.baked.touch();
+
+	return ret;
+}
+
+GLuint upload_texture(TextureData const &texture) {
+	GLuint tex = 0;
+	glGenTextures(1, &tex);
+	glBindTexture(GL_TEXTURE_2D, tex);
+	if (!texture.levels.empty()) {
+		check_baked(texture, texture.level_data_size, texture.baked.name);
+		//level data is tightly packed:
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		for (GLint l = 0; l < GLint(texture.levels.size()); ++l) {
+			TextureLevel const &level = texture.levels[l];
+			glTexImage2D(GL_TEXTURE_2D, l, texture.header.internal_format, level.width, level.height, 0,
+				texture.header.format, texture.header.type, texture.level_data + level.offset);
+		}
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, GLint(texture.levels.size()) - 1);
+	} else {
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, texture.size.x, texture.size.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, texture.data.data());
+		glGenerateMipmap(GL_TEXTURE_2D);
+	}
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	GL_ERRORS();
+
+	return tex;
+}
+
+size_t reload_texture(GLuint tex, TextureData const &texture, std::vector< char > *shadow) {
+	assert(shadow);
+	size_t uploaded = 0;
+	glBindTexture(GL_TEXTURE_2D, tex);
+	if (!texture.levels.empty()) {
+		check_baked(texture, texture.level_data_size, texture.baked.name);
+		//if every level is the same size as before, only levels whose contents changed are uploaded:
+		GLint max_level = 0;
+		glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, &max_level);
+		bool same_shape = (max_level + 1 == GLint(texture.levels.size()));
+		for (GLint l = 0; same_shape && l < GLint(texture.levels.size()); ++l) {
+			GLint width = 0, height = 0, internal_format = 0;
+			glGetTexLevelParameteriv(GL_TEXTURE_2D, l, GL_TEXTURE_WIDTH, &width);
+			glGetTexLevelParameteriv(GL_TEXTURE_2D, l, GL_TEXTURE_HEIGHT, &height);
+			glGetTexLevelParameteriv(GL_TEXTURE_2D, l, GL_TEXTURE_INTERNAL_FORMAT, &internal_format);
+			same_shape = (GLuint(width) == texture.levels[l].width && GLuint(height) == texture.levels[l].height
+				&& GLuint(internal_format) == texture.header.internal_format);
+		}
+
+		//level contents are compared against the copy kept from the last reload (not read back from the GPU):
+		std::vector< char > levels;
+		for (auto const &level : texture.levels) {
+			char const *data = texture.level_data + level.offset;
+			levels.insert(levels.end(), data, data + baked_level_size(texture.header, level));
+		}
+		bool compare = (same_shape && shadow->size() == levels.size());
+
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		size_t at = 0;
+		for (GLint l = 0; l < GLint(texture.levels.size()); ++l) {
+			TextureLevel const &level = texture.levels[l];
+			char const *data = texture.level_data + level.offset;
+			size_t size = baked_level_size(texture.header, level);
+			if (!same_shape) {
+				glTexImage2D(GL_TEXTURE_2D, l, texture.header.internal_format, level.width, level.height, 0,
+					texture.header.format, texture.header.type, data);
+				uploaded += size;
+			} else if (!compare || std::memcmp(shadow->data() + at, data, size) != 0) {
+				glTexSubImage2D(GL_TEXTURE_2D, l, 0, 0, level.width, level.height,
+					texture.header.format, texture.header.type, data);
+				uploaded += size;
+			}
+			at += size;
+		}
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, GLint(texture.levels.size()) - 1);
+		*shadow = std::move(levels);
+	} else {
+		//PNGs have no stored mip chain to compare against, so the whole thing is redone:
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, texture.size.x, texture.size.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, texture.data.data());
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 1000);
+		glGenerateMipmap(GL_TEXTURE_2D);
+		uploaded = texture.data.size() * sizeof(texture.data[0]);
+		shadow->clear();
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+	GL_ERRORS();
+
+	return uploaded;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "GL.hpp"
+#include "Pack.hpp"
+
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+//Baked textures (".tex", written by bake_texture.cpp) store the whole mip chain already in the
+// texture's internal format, so loading one is a mapping and a glTexImage2D per level:
+//  "tex0" chunk: TextureHeader
+//  "lvl0" chunk: TextureLevel[levels] (level 0 first)
+//  "dat0" chunk: level data, rows tightly packed, lower-left origin
+
+struct TextureHeader {
+	uint32_t width = 0;
+	uint32_t height = 0;
+	uint32_t levels = 0;
+	uint32_t internal_format = GL_RGB8;
+	uint32_t format = GL_RGB; //glTexImage2D's format/type for the level data
+	uint32_t type = GL_UNSIGNED_BYTE;
+};
+static_assert(sizeof(TextureHeader) == 6 * 4, "TextureHeader is packed.");
+
+struct TextureLevel {
+	uint32_t width = 0;
+	uint32_t height = 0;
+	uint32_t offset = 0; //within "dat0"
+	uint32_t size = 0;
+};
+static_assert(sizeof(TextureLevel) == 4 * 4, "TextureLevel is packed.");
+
+//textures are read (CPU stage of a load) and then uploaded (GL stage):
+struct TextureData {
+	//baked texture, if there was one:
+	Asset baked;
+	TextureHeader header;
+	std::vector< TextureLevel > levels;
+	char const *level_data = nullptr; //start of "dat0", inside 'baked'
+	size_t level_data_size = 0; //size of "dat0"
+
+	//...otherwise, a decoded PNG (mipmaps are generated on upload):
+	glm::uvec2 size = glm::uvec2(0);
+	std::vector< glm::u8vec4 > data;
+};
+
+//read 'name' + ".tex" if it exists (in the pack or not), otherwise decode 'name' + ".png":
+// e.g., load_texture_data("textures/paper")
+// note: will throw if neither can be read.
+TextureData load_texture_data(std::string const &name);
+//read a particular file (baked if its name ends in ".tex", otherwise PNG):
+TextureData load_texture_data(Asset const &asset);
+
+//make a GL_TEXTURE_2D (mipmapped, repeating) from loaded data:
+GLuint upload_texture(TextureData const &texture);
+
+//replace the contents of a texture made by upload_texture() (e.g., when its file changes):
+// baked levels that are the same size as before are compared against 'shadow' -- the level data
+// of the previous reload, kept by the caller (empty at first) and updated here -- and only
+// uploaded if different; returns the number of bytes uploaded.
+size_t reload_texture(GLuint tex, TextureData const &texture, std::vector< char > *shadow);
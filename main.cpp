@@ -1,7 +1,7 @@
 //Mode.hpp declares the "Mode::current" static member variable, which is used to decide where event-handling, updating, and drawing events go:
 #include "Mode.hpp"
 
-//Load.hpp is included because of the call_load_functions() call:
+//Load.hpp is included because of the call_load_functions() and report_unused_loads() calls:
 #include "Load.hpp"
 
 //The 'GameMode' mode plays the game:
@@ -29,11 +29,29 @@
 #include <memory>
 #include <algorithm>
 #include <string>
+#include <cstdio>
+#ifdef _WIN32
+#include <io.h> //_setmode
+#include <fcntl.h>
+#endif
 
 #include "parameters.hpp"
+#include "Profiler.hpp"
+#include "Resources.hpp"
+#include "GLCapture.hpp"
 
 extern std::string file;
 extern bool pic_mode;
+extern std::string timers_csv;
+extern std::string trace_json;
+extern float frame_budget_ms;
+extern uint32_t ssaa;
+extern bool ssaa_lanczos;
+extern glm::uvec2 poster_size;
+extern uint32_t poster_tile;
+extern glm::vec2 sequence_range;
+extern float sequence_fps;
+extern std::string sequence_out;
 int main(int argc, char **argv) {
 #ifdef _WIN32
 	try {
@@ -62,39 +80,74 @@ int main(int argc, char **argv) {
     //-show = show
     //-file = filename
     //-save = turns on pic_mode and sets filename
+    //-timings = log per-pass GPU/CPU times to this CSV file
+    //-trace = record profiler zones from startup and write them to this JSON file at exit
+    //-vram-budget = warn when estimated GPU memory goes over this many megabytes (see Resources.hpp)
+    //-frame-budget = lower the render resolution to keep GPU time per frame under this many ms (see DynamicResolution.hpp)
+    //-ssaa = render at this multiple (1-4) of the window size, and filter saved pictures down to it
+    //-ssaa-filter = filter for that: box (default) or lanczos
+    //-poster = with -save, render the picture at this size (e.g., 20000x14000) in tiles, whatever the texture limits
+    //-poster-tile = size of those tiles (default 1024)
+    //-sequence = render frames over this range of elapsed time (e.g., 0:10), write them out, then quit
+    //-sequence-fps = frames per second of elapsed time (default 24)
+    //-sequence-out = where: '-' for Y4M on stdout, a .y4m file, or a name for numbered PNGs (default renders/<file name>)
+    //-capture = record every GL call to this file for glreplay (see GLCapture.hpp), then quit
+    //-capture-frames = frames to capture (default 60)
+    std::string capture_file;
+    uint32_t capture_frames = 60;
     int start = (argc%2==0 ? 2 : 1);
     for(int i = start; i<argc-1; i+=2){
-        if(strcmp(argv[i], "-time")==0){
-            Parameters::elapsed_time = atof(argv[i+1]);
-        }else if(strcmp(argv[i], "-speed")==0){
-            Parameters::speed = atof(argv[i+1]);
-        }else if(strcmp(argv[i], "-frequency")==0){
-            Parameters::frequency = atof(argv[i+1]);
-        }else if(strcmp(argv[i], "-dA") == 0){
-            Parameters::dA = atof(argv[i+1]);
-        }else if(strcmp(argv[i],"-cangiante") == 0){
-            Parameters::cangiante_variable = atof(argv[i+1]);
-        }else if(strcmp(argv[i],"-dilution") == 0){
-            Parameters::dilution_variable = atof(argv[i+1]);
-        }else if(strcmp(argv[i],"-density") == 0){
-            Parameters::density_amount = atof(argv[i+1]);
-        }else if(strcmp(argv[i],"-depth") == 0){
-            Parameters::depth_threshold = atof(argv[i+1]);
-        }else if(strcmp(argv[i],"-blur") == 0){
-            Parameters::blur_amount = atof(argv[i+1]);
-        }else if(strcmp(argv[i],"-bleed") == 0){
-            Parameters::bleed = atoi(argv[i+1]);
-        }else if(strcmp(argv[i],"-distortion") == 0){
-            Parameters::distortion = atoi(argv[i+1]);
-        }else if(strcmp(argv[i],"-show") == 0){
-            Parameters::show = atoi(argv[i+1]);
+        if(Parameters::set_from_arg(argv[i], argv[i+1])){
+            //(art-directable parameter; see parameters.cpp)
         }else if(strcmp(argv[i], "-file") == 0){
             Parameters::filename = argv[i+1];
         }else if(strcmp(argv[i], "-save") == 0){
             Parameters::filename = argv[i+1];
             pic_mode = true;
+        }else if(strcmp(argv[i], "-timings") == 0){
+            timers_csv = argv[i+1];
+        }else if(strcmp(argv[i], "-trace") == 0){
+            trace_json = argv[i+1];
+            Profiler::set_recording(true);
+        }else if(strcmp(argv[i], "-vram-budget") == 0){
+            Resources::set_gpu_budget(size_t(atof(argv[i+1]) * 1024.0 * 1024.0));
+        }else if(strcmp(argv[i], "-frame-budget") == 0){
+            frame_budget_ms = float(atof(argv[i+1]));
+        }else if(strcmp(argv[i], "-ssaa") == 0){
+            ssaa = uint32_t(std::max(1, atoi(argv[i+1])));
+        }else if(strcmp(argv[i], "-ssaa-filter") == 0){
+            if(strcmp(argv[i+1], "lanczos") == 0) ssaa_lanczos = true;
+            else if(strcmp(argv[i+1], "box") == 0) ssaa_lanczos = false;
+            else std::cerr << "WARNING: unknown -ssaa-filter '" << argv[i+1] << "' (expected box or lanczos)." << std::endl;
+        }else if(strcmp(argv[i], "-poster") == 0){
+            if(sscanf(argv[i+1], "%ux%u", &poster_size.x, &poster_size.y) != 2 || poster_size.x == 0 || poster_size.y == 0){
+                std::cerr << "WARNING: ignoring -poster '" << argv[i+1] << "' (expected WIDTHxHEIGHT)." << std::endl;
+                poster_size = glm::uvec2(0,0);
+            }
+        }else if(strcmp(argv[i], "-poster-tile") == 0){
+            poster_tile = uint32_t(std::max(16, atoi(argv[i+1])));
+        }else if(strcmp(argv[i], "-sequence") == 0){
+            if(sscanf(argv[i+1], "%f:%f", &sequence_range.x, &sequence_range.y) != 2 || !(sequence_range.y > sequence_range.x)){
+                std::cerr << "WARNING: ignoring -sequence '" << argv[i+1] << "' (expected START:END, in seconds)." << std::endl;
+                sequence_range = glm::vec2(0.0f);
+            }
+        }else if(strcmp(argv[i], "-sequence-fps") == 0){
+            sequence_fps = std::max(0.001f, float(atof(argv[i+1])));
+        }else if(strcmp(argv[i], "-sequence-out") == 0){
+            sequence_out = argv[i+1];
+        }else if(strcmp(argv[i], "-capture") == 0){
+            capture_file = argv[i+1];
+        }else if(strcmp(argv[i], "-capture-frames") == 0){
+            capture_frames = uint32_t(std::max(1, atoi(argv[i+1])));
         }
 
+    }
+    //a Y4M stream on stdout mustn't have log messages mixed in, so those go to stderr:
+    if(sequence_out == "-"){
+        std::cout.rdbuf(std::cerr.rdbuf());
+        #ifdef _WIN32
+        _setmode(_fileno(stdout), _O_BINARY);
+        #endif
     }
 	/*
 	//----- start connection to server ----
@@ -155,6 +208,13 @@ int main(int argc, char **argv) {
 	init_gl_shims();
 	#endif
 
+	//A capture has to start before any GL object is made (it is replayed from an empty context):
+	if (!capture_file.empty()) {
+		int w,h;
+		SDL_GL_GetDrawableSize(window, &w, &h);
+		GLCapture::start(uint32_t(w), uint32_t(h));
+	}
+
 	//Set VSYNC + Late Swap (prevents crazy FPS):
 	if (SDL_GL_SetSwapInterval(-1) != 0) {
 		std::cerr << "NOTE: couldn't set vsync + late swap tearing (" << SDL_GetError() << ")." << std::endl;
@@ -171,6 +231,10 @@ int main(int argc, char **argv) {
 
 	//------------ load assets --------------
 
+	#if PROFILER
+	Profiler::set_thread_name("main");
+	#endif
+
 	call_load_functions();
 
 	//------------ create game mode + make current --------------
@@ -201,6 +265,7 @@ int main(int argc, char **argv) {
 		//  by performing three steps:
 
 		{ //(1) process any events that are pending
+			PROFILE_ZONE("events");
 			static SDL_Event evt;
 			while (SDL_PollEvent(&evt) == 1) {
 				//handle resizing:
@@ -219,6 +284,7 @@ int main(int argc, char **argv) {
 		}
 
 		{ //(2) call the current mode's "update" function to deal with elapsed time:
+			PROFILE_ZONE("update");
 			auto current_time = std::chrono::high_resolution_clock::now();
 			static auto previous_time = current_time;
 			float elapsed = std::chrono::duration< float >(current_time - previous_time).count();
@@ -233,6 +299,7 @@ int main(int argc, char **argv) {
 		}
 
 		{ //(3) call the current mode's "draw" function to produce output:
+			PROFILE_ZONE("draw");
 			//clear the depth+color buffers and set some default state:
 			glClearColor(0.5, 0.5, 0.5, 0.0);
 			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -240,16 +307,40 @@ int main(int argc, char **argv) {
 			glEnable(GL_BLEND);
 			glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-			Mode::current->draw(drawable_size);
+			//(the mode may clear Mode::current while drawing, e.g. after saving a picture; keep it alive until it returns)
+			std::shared_ptr< Mode > drawing = Mode::current;
+			drawing->draw(drawable_size);
 		}
 
 		//Finally, wait until the recently-drawn frame is shown before doing it all again:
-		SDL_GL_SwapWindow(window);
+		{
+			PROFILE_ZONE("SDL_GL_SwapWindow");
+			SDL_GL_SwapWindow(window);
+		}
+
+		if (GLCapture::recording()) {
+			GLCapture::end_frame();
+			if (GLCapture::frames() >= capture_frames) {
+				GLCapture::stop(capture_file);
+				Mode::set_current(nullptr);
+			}
+		}
 	}
 
 
 	//------------  teardown ------------
 
+	report_unused_loads();
+
+	//(quit before enough frames were captured; keep what there is)
+	if (GLCapture::recording()) {
+		GLCapture::stop(capture_file);
+	}
+
+	if (Profiler::recording()) {
+		Profiler::write_trace(trace_json);
+	}
+
 	SDL_GL_DeleteContext(context);
 	context = 0;
 
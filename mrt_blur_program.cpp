@@ -13,7 +13,8 @@
         "uniform sampler2D depth_tex;\n" \
         "uniform float depth_threshold;\n" \
         "uniform int blur_amount; \n" \
-        "uniform float weights[20];\n"\
+        "uniform int bleed_radius; //20 at full resolution (see DynamicResolution)\n" \
+        "uniform float weights[80]; //(GameMode::MaxBlurTaps)\n"\
         "layout(location=0) out vec4 blurred_out;\n"\
         "layout(location=1) out vec4 bleeded_out;\n"\
         "layout(location=2) out vec4 control_out;\n"\
@@ -37,7 +38,10 @@
         "   float zx = texelFetch(depth_tex, ivec2(gl_FragCoord.xy), 0).r;\n"\
         "   zx = 1.0/zx; //because of weird z value weirdness with 1/z things\n"\
         "   bool blurred = false; //to decide if control_tex needs updating\n" \
-		"   for(int i = -20; i<=20; i++){\n"\
+        "   //(the 41 weights are stretched over fewer taps at a smaller radius, and rescaled to the same total)\n"\
+        "   float bleed_scale = 41.0/float(2*bleed_radius+1);\n"\
+		"   for(int i = -bleed_radius; i<=bleed_radius; i++){\n"\
+        "       float w = weight41[20 + abs(i)*20/bleed_radius]*bleed_scale; //(weights are symmetric)\n"\
         "       bool bleed;\n"\
         "       float ctrlxi = texelFetch(control_tex, ivec2(gl_FragCoord.xy)+OFFSET, 0).b;\n"\
         "       if (ctrlx>0 || ctrlxi>0) {\n"\
@@ -50,13 +54,13 @@
         "               if(ctrlx>0) bleed = true; \n" \
         "           }\n" \
         "           if (bleed) {\n"\
-        "               bleeded_out = bleeded_out+texelFetch(bleed_color_tex, ivec2(gl_FragCoord.xy)+OFFSET, 0)*weight41[i+20];\n"\
+        "               bleeded_out = bleeded_out+texelFetch(bleed_color_tex, ivec2(gl_FragCoord.xy)+OFFSET, 0)*w;\n"\
                 "       blurred = true;\n" \
         "           } else {\n"\
-        "               bleeded_out = bleeded_out+texelFetch(bleed_color_tex, ivec2(gl_FragCoord.xy), 0)*weight41[i+20];\n"\
+        "               bleeded_out = bleeded_out+texelFetch(bleed_color_tex, ivec2(gl_FragCoord.xy), 0)*w;\n"\
         "           } \n"\
         "       } else {\n"\
-        "           bleeded_out = bleeded_out+texelFetch(bleed_color_tex, ivec2(gl_FragCoord.xy), 0)*weight41[i+20];\n"\
+        "           bleeded_out = bleeded_out+texelFetch(bleed_color_tex, ivec2(gl_FragCoord.xy), 0)*w;\n"\
         "       }\n"\
         "   }\n"\
         "   control_out = control_in;\n"\
@@ -77,7 +81,9 @@ MRTBlurHProgram::MRTBlurHProgram() {
 
     depth_threshold = glGetUniformLocation(program, "depth_threshold");
     blur_amount = glGetUniformLocation(program, "blur_amount");
+    bleed_radius = glGetUniformLocation(program, "bleed_radius");
     weights = glGetUniformLocation(program, "weights");
+    glUniform1i(bleed_radius, 20);
     glUniform1i(glGetUniformLocation(program, "blur_color_tex"), 0);
     glUniform1i(glGetUniformLocation(program, "bleed_color_tex"), 1);
     glUniform1i(glGetUniformLocation(program, "control_tex"), 2);
@@ -101,7 +107,9 @@ MRTBlurVProgram::MRTBlurVProgram() {
 
     depth_threshold = glGetUniformLocation(program, "depth_threshold");
     blur_amount = glGetUniformLocation(program, "blur_amount");
+    bleed_radius = glGetUniformLocation(program, "bleed_radius");
     weights = glGetUniformLocation(program, "weights");
+    glUniform1i(bleed_radius, 20);
 
     glUniform1i(glGetUniformLocation(program, "blur_color_tex"), 0);
     glUniform1i(glGetUniformLocation(program, "bleed_color_tex"), 1);
@@ -113,9 +121,9 @@ MRTBlurVProgram::MRTBlurVProgram() {
 	GL_ERRORS();
 }
 
-Load< MRTBlurVProgram > mrt_blurV_program(LoadTagInit, [](){
+Load< MRTBlurVProgram > mrt_blurV_program(LoadTagInit, "mrt_blurV_program", {}, [](){
 	return new MRTBlurVProgram();
 });
-Load< MRTBlurHProgram > mrt_blurH_program(LoadTagInit, [](){
+Load< MRTBlurHProgram > mrt_blurH_program(LoadTagInit, "mrt_blurH_program", {}, [](){
 	return new MRTBlurHProgram();
 });
@@ -10,6 +10,7 @@ struct MRTBlurHProgram {
 	//uniform locations:
     GLuint weights = -1U;
     GLuint blur_amount = -1U;
+    GLuint bleed_radius = -1U;
     GLuint depth_threshold = -1U;
 	MRTBlurHProgram();
 };
@@ -21,6 +22,7 @@ struct MRTBlurVProgram {
 	//uniform locations:
     GLuint weights = -1U;
     GLuint blur_amount = -1U;
+    GLuint bleed_radius = -1U;
     GLuint depth_threshold = -1U;
 	MRTBlurVProgram();
 };
@@ -0,0 +1,141 @@
+//pack_assets gathers data files into a single pack (see Pack.hpp), so that the game can find
+// all of its assets with one open and one mmap:
+//   - PNG files are stored pre-decoded (PackEntry::Image, RGBA8, lower-left origin)
+//   - everything else (chunked meshes, scenes, ...) is stored as-is (PackEntry::Raw)
+// Entries are named by their path relative to <dir>, which is what open_asset() looks up.
+//
+// usage: pack_assets <out.pack> <dir> <name> [<name> ...]
+//   e.g.: pack_assets dist/assets.pack dist test.pgct test.scene menu.p textures/grid.png
+
+#include "Pack.hpp"
+#include "MappedFile.hpp"
+#include "load_save_png.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+template< typename T >
+void write_chunk(std::ostream &to, std::string const &magic, T const *data, size_t count) {
+	assert(magic.size() == 4);
+	uint32_t size = uint32_t(count * sizeof(T));
+	to.write(magic.data(), 4);
+	to.write(reinterpret_cast< char const * >(&size), 4);
+	to.write(reinterpret_cast< char const * >(data), size);
+}
+
+struct Input {
+	std::string name;
+	uint32_t type = PackEntry::Raw;
+	std::vector< char > data;
+};
+
+Input read_input(std::string const &dir, std::string const &name) {
+	Input input;
+	input.name = name;
+	std::string path = dir + "/" + name;
+	if (name.size() >= 4 && name.substr(name.size()-4) == ".png") {
+		glm::uvec2 size;
+		std::vector< glm::u8vec4 > pixels;
+		load_png(path, &size, &pixels, LowerLeftOrigin);
+		PackImage image;
+		image.width = size.x;
+		image.height = size.y;
+		input.type = PackEntry::Image;
+		input.data.resize(sizeof(image) + pixels.size() * sizeof(glm::u8vec4));
+		std::memcpy(input.data.data(), &image, sizeof(image));
+		if (!pixels.empty()) std::memcpy(input.data.data() + sizeof(image), pixels.data(), pixels.size() * sizeof(glm::u8vec4));
+	} else {
+		MappedFile file(path);
+		input.data.assign(file.begin(), file.end());
+	}
+	return input;
+}
+
+} //namespace
+
+int main(int argc, char **argv) {
+	if (argc < 4) {
+		std::cerr << "usage:\n\t" << argv[0] << " <out.pack> <dir> <name> [<name> ...]" << std::endl;
+		return 1;
+	}
+	std::string out_filename = argv[1];
+	std::string dir = argv[2];
+
+	try {
+		std::vector< Input > inputs;
+		for (int i = 3; i < argc; ++i) {
+			inputs.emplace_back(read_input(dir, argv[i]));
+		}
+		//Pack::find() binary-searches by name:
+		std::sort(inputs.begin(), inputs.end(), [](Input const &a, Input const &b){
+			return a.name < b.name;
+		});
+		for (size_t i = 1; i < inputs.size(); ++i) {
+			if (inputs[i-1].name == inputs[i].name) {
+				throw std::runtime_error("'" + inputs[i].name + "' is listed twice");
+			}
+		}
+
+		PackHeader header;
+		std::vector< PackEntry > entries;
+		std::vector< char > names;
+		for (auto const &input : inputs) {
+			PackEntry entry;
+			entry.name_begin = uint32_t(names.size());
+			names.insert(names.end(), input.name.begin(), input.name.end());
+			entry.name_end = uint32_t(names.size());
+			entry.type = input.type;
+			entry.size = input.data.size();
+			entry.hash = pack_hash(input.data.data(), input.data.size());
+			entries.emplace_back(entry);
+		}
+
+		//data starts after the table of contents, with every entry aligned:
+		uint64_t offset = 3 * 8 + sizeof(header) + entries.size() * sizeof(PackEntry) + names.size(); //(8 is the size of a chunk header)
+		for (auto &entry : entries) {
+			offset = (offset + header.alignment - 1) / header.alignment * header.alignment;
+			entry.offset = offset;
+			offset += entry.size;
+		}
+
+		//write to a temporary file first, so a running game never maps a half-written pack:
+		std::string temp_filename = out_filename + ".tmp";
+		{
+			std::ofstream out(temp_filename, std::ios::binary);
+			write_chunk(out, "pak0", &header, 1);
+			write_chunk(out, "toc0", entries.data(), entries.size());
+			write_chunk(out, "str0", names.data(), names.size());
+			for (size_t i = 0; i < entries.size(); ++i) {
+				std::vector< char > padding(size_t(entries[i].offset - uint64_t(out.tellp())), '\0');
+				out.write(padding.data(), padding.size());
+				out.write(inputs[i].data.data(), inputs[i].data.size());
+			}
+			if (!out) throw std::runtime_error("failed to write '" + temp_filename + "'");
+		}
+		std::remove(out_filename.c_str()); //(rename won't replace an existing file on windows)
+		if (std::rename(temp_filename.c_str(), out_filename.c_str()) != 0) {
+			throw std::runtime_error("failed to rename '" + temp_filename + "' to '" + out_filename + "'");
+		}
+
+		//read it back the way the game will:
+		Pack pack(out_filename);
+		for (auto const &entry : pack.entries) {
+			if (!pack.verify(entry)) throw std::runtime_error("entry '" + pack.name(entry) + "' failed to verify");
+			std::cout << "  " << pack.name(entry) << ": " << entry.size << " bytes"
+				<< (entry.type == PackEntry::Image ? " (decoded image)" : "") << std::endl;
+		}
+		std::cout << out_filename << ": " << pack.entries.size() << " entries, " << pack.file->size << " bytes." << std::endl;
+	} catch (std::exception &e) {
+		std::cerr << "ERROR: " << e.what() << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
@@ -1,9 +1,49 @@
 #include "parameters.hpp"
 
+#include <cstdlib>
+
 namespace Parameters{
 //Art-directable parameters
     #define DO_PARAMETER(type, name, value, hint) \
         type name = value
     #include "do_parameters.hpp"
     #undef DO_PARAMETER
+
+    bool set_from_arg(std::string const &flag, char const *value){
+        if(flag == "-time"){
+            elapsed_time = atof(value);
+        }else if(flag == "-speed"){
+            speed = atof(value);
+        }else if(flag == "-frequency"){
+            frequency = atof(value);
+        }else if(flag == "-dA"){
+            dA = atof(value);
+        }else if(flag == "-cangiante"){
+            cangiante_variable = atof(value);
+        }else if(flag == "-dilution"){
+            dilution_variable = atof(value);
+        }else if(flag == "-density"){
+            density_amount = atof(value);
+        }else if(flag == "-depth"){
+            depth_threshold = atof(value);
+        }else if(flag == "-blur"){
+            blur_amount = atof(value);
+        }else if(flag == "-bleed"){
+            bleed = atoi(value);
+        }else if(flag == "-distortion"){
+            distortion = atoi(value);
+        }else if(flag == "-show"){
+            show = atoi(value);
+        }else{
+            return false;
+        }
+        return true;
+    }
+
+    void reset(){
+        #define DO_PARAMETER(type, name, value, hint) \
+            name = value
+        #include "do_parameters.hpp"
+        #undef DO_PARAMETER
+    }
 }
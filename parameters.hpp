@@ -6,4 +6,10 @@ namespace Parameters{
         extern type name
     #include "do_parameters.hpp"
     #undef DO_PARAMETER
+
+    //set a parameter from a command-line flag and its value (e.g., "-blur", "10"):
+    // returns false if 'flag' isn't a parameter flag.
+    bool set_from_arg(std::string const &flag, char const *value);
+    //put every parameter back to its default value:
+    void reset();
 }
@@ -4,6 +4,9 @@
 #include <vector>
 #include <stdexcept>
 #include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <string>
 
 template< typename T >
 void read_chunk(std::istream &from, std::string const &magic, std::vector< T > *_to) {
@@ -32,3 +35,80 @@ void read_chunk(std::istream &from, std::string const &magic, std::vector< T > *
 		throw std::runtime_error("Failed to read chunk data.");
 	}
 }
+
+//read_chunk can also read straight from memory (e.g., a MappedFile), advancing *at past the chunk.
+
+//ChunkView is a read-only view of a chunk's elements, valid as long as the memory it points into:
+template< typename T >
+struct ChunkView {
+	T const *ptr = nullptr;
+	size_t count = 0;
+
+	T const *data() const { return ptr; }
+	size_t size() const { return count; }
+	bool empty() const { return count == 0; }
+	T const *begin() const { return ptr; }
+	T const *end() const { return ptr + count; }
+	T const &operator[](size_t i) const { assert(i < count); return ptr[i]; }
+};
+
+//check the header at *at and return a pointer to the chunk's data; sets *size to its size in bytes:
+inline char const *read_chunk_header(char const **at, char const *end, std::string const &magic, size_t element_size, uint32_t *size) {
+	assert(at && *at <= end);
+	assert(size);
+
+	struct ChunkHeader {
+		char magic[4];
+		uint32_t size;
+	};
+	static_assert(sizeof(ChunkHeader) == 8, "header is packed");
+
+	ChunkHeader header;
+	if (size_t(end - *at) < sizeof(header)) {
+		throw std::runtime_error("Failed to read chunk header");
+	}
+	std::memcpy(&header, *at, sizeof(header));
+	if (std::string(header.magic,4) != magic) {
+		throw std::runtime_error("Unexpected magic number in chunk");
+	}
+	if (header.size % element_size != 0) {
+		throw std::runtime_error("Size of chunk not divisible by element size");
+	}
+	if (size_t(end - *at) - sizeof(header) < header.size) {
+		throw std::runtime_error("Failed to read chunk data.");
+	}
+	char const *data = *at + sizeof(header);
+	*at = data + header.size;
+	*size = header.size;
+	return data;
+}
+
+//check whether the chunk at 'at' has the given magic (without advancing):
+inline bool peek_chunk(char const *at, char const *end, std::string const &magic) {
+	assert(magic.size() == 4);
+	return size_t(end - at) >= 8 && std::string(at, 4) == magic;
+}
+
+//view a chunk in place (no copy):
+// note: throws if the chunk isn't suitably aligned for T in memory; read into a vector in that case.
+template< typename T >
+void read_chunk(char const **at, char const *end, std::string const &magic, ChunkView< T > *_to) {
+	assert(_to);
+	uint32_t size = 0;
+	char const *data = read_chunk_header(at, end, magic, sizeof(T), &size);
+	if (reinterpret_cast< uintptr_t >(data) % alignof(T) != 0) {
+		throw std::runtime_error("Chunk '" + magic + "' is not aligned for in-place access");
+	}
+	_to->ptr = reinterpret_cast< T const * >(data);
+	_to->count = size / sizeof(T);
+}
+
+//copy a chunk out of memory:
+template< typename T >
+void read_chunk(char const **at, char const *end, std::string const &magic, std::vector< T > *_to) {
+	assert(_to);
+	uint32_t size = 0;
+	char const *data = read_chunk_header(at, end, magic, sizeof(T), &size);
+	_to->resize(size / sizeof(T));
+	if (size) std::memcpy(_to->data(), data, size);
+}
@@ -1,20 +1,46 @@
 #include "scene_program.hpp"
 
 #include "compile_program.hpp"
+#include "Scene.hpp"
 #include "gl_errors.hpp"
+#include "Resources.hpp"
+
+//per-frame uniform block; layout must match SceneProgram::Frame:
+#define FRAME_BLOCK \
+		"layout(std140) uniform Frame {\n" \
+		"	vec3 sun_direction;\n" \
+		"	float time;\n" \
+		"	vec3 sun_color;\n" \
+		"	float speed;\n" \
+		"	vec3 sky_direction;\n" \
+		"	float frequency;\n" \
+		"	vec3 sky_color;\n" \
+		"	float tremor_amount;\n" \
+		"	vec3 viewPos;\n" \
+		"	float dA;\n" \
+		"	vec2 clip_units_per_pixel;\n" \
+		"	float cangiante_variable;\n" \
+		"	float dilution_variable;\n" \
+		"	vec2 window_scale;\n" \
+		"	vec2 window_offset;\n" \
+		"};\n"
 
 SceneProgram::SceneProgram() {
 	program = compile_program(
 		"#version 330\n"
-		"uniform mat4 object_to_clip;\n"
-		"uniform mat4x3 object_to_light;\n"
-		"uniform mat3 normal_to_light;\n"
-        "uniform float time;\n"
-        "uniform float speed;\n"
-        "uniform float frequency;\n"
-        "uniform float tremor_amount;\n"
-        "uniform vec2 clip_units_per_pixel;\n"
-        "uniform vec3 viewPos;\n"
+		FRAME_BLOCK
+        //per-object matrices are read from instance_transforms (see Scene::InstanceTransforms)
+        //at instance_base + ObjectIndex, where ObjectIndex is gl_InstanceID offset by the draw's baseInstance:
+        "uniform int instance_base;\n"
+        "uniform samplerBuffer instance_transforms;\n"
+        "in uint ObjectIndex;\n"
+        //quantized meshes store normals octahedral-encoded in .xy (see index_meshes.cpp):
+        "uniform bool octahedral_normals;\n"
+        "vec3 oct_decode(vec2 e) {\n"
+        "   vec3 v = vec3(e, 1.0 - abs(e.x) - abs(e.y));\n"
+        "   if (v.z < 0.0) v.xy = (1.0 - abs(v.yx)) * vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);\n"
+        "   return normalize(v);\n"
+        "}\n"
 		"layout(location=0) in vec4 Position;\n"
         //note: layout keyword used to make sure that the location-0 attribute is always bound to something
         "in vec3 GeoNormal;\n"
@@ -29,31 +55,34 @@ SceneProgram::SceneProgram() {
         "out vec4 controlColor;\n"
 		"out vec2 texCoord;\n"
 		"void main() {\n"
+        "   int t = (instance_base + int(ObjectIndex)) * 10;\n"
+        "   mat4 object_to_clip = mat4(texelFetch(instance_transforms, t+0), texelFetch(instance_transforms, t+1),\n"
+        "       texelFetch(instance_transforms, t+2), texelFetch(instance_transforms, t+3));\n"
+        "   mat4x3 object_to_light = transpose(mat3x4(texelFetch(instance_transforms, t+4),\n"
+        "       texelFetch(instance_transforms, t+5), texelFetch(instance_transforms, t+6)));\n"
+        "   mat3 normal_to_light = mat3(texelFetch(instance_transforms, t+7).xyz,\n"
+        "       texelFetch(instance_transforms, t+8).xyz, texelFetch(instance_transforms, t+9).xyz);\n"
 		"	gl_Position = object_to_clip * Position;\n"
 		"	position = object_to_light * Position;\n"
-		"	shadingNormal = normal_to_light * Normal;\n"
-        "   geoNormal = GeoNormal;\n"
+		"	shadingNormal = normal_to_light * (octahedral_normals ? oct_decode(Normal.xy) : Normal);\n"
+        "   geoNormal = (octahedral_normals ? oct_decode(GeoNormal.xy) : GeoNormal);\n"
 		"	color = Color;\n"
         "   controlColor = ControlColor;\n"
 		"	texCoord = TexCoord;\n"
         //calculate vertex positions after some hand tremor
         //which occurs along the normals of the vertex and also is dependent on
         //distance from viewer so that it is visible for farther things
-        "   vec2 pixel_size = clip_units_per_pixel * gl_Position.w;\n"
-        "   vec2 voffset = sin(time*speed+(gl_Position.x+gl_Position.y+gl_Position.z)*frequency)*tremor_amount*pixel_size;\n"
+        //(worked out in the clip space of the whole view, so tiles of a picture shake alike; see Scene::Camera::window)
+        "   vec4 view_position = vec4((gl_Position.xy - window_offset*gl_Position.w)/window_scale, gl_Position.zw);\n"
+        "   vec2 pixel_size = clip_units_per_pixel * view_position.w;\n"
+        "   vec2 voffset = sin(time*speed+(view_position.x+view_position.y+view_position.z)*frequency)*tremor_amount*pixel_size*window_scale;\n"
         "   float a = 0.8f;\n" //this may or may not need changing
         "   vec3 viewDir = normalize(viewPos-position);\n"
         "   gl_Position = gl_Position+vec4(voffset,0, 0)*(1.0f-a*dot(viewDir,geoNormal));\n"
 		"}\n"
 		,
 		"#version 330\n"
-		"uniform vec3 sun_direction;\n"
-		"uniform vec3 sun_color;\n"
-		"uniform vec3 sky_direction;\n"
-		"uniform vec3 sky_color;\n"
-        "uniform float dA;\n"
-        "uniform float cangiante_variable;\n"
-		"uniform float dilution_variable;\n"
+		FRAME_BLOCK
         "uniform sampler2D tex;\n"
 		"in vec3 position;\n"
         "in vec3 geoNormal;\n"
@@ -98,35 +127,38 @@ SceneProgram::SceneProgram() {
         "   }\n"
 		"}\n"
 	);
-    object_to_clip_mat4 = glGetUniformLocation(program, "object_to_clip");
-	object_to_light_mat4x3 = glGetUniformLocation(program, "object_to_light");
-	normal_to_light_mat3 = glGetUniformLocation(program, "normal_to_light");
+	instance_base_int = glGetUniformLocation(program, "instance_base");
+	object_index_attrib = glGetAttribLocation(program, "ObjectIndex");
+	octahedral_normals_bool = glGetUniformLocation(program, "octahedral_normals");
 
-	time = glGetUniformLocation(program, "time");
-	speed = glGetUniformLocation(program, "speed");
-	frequency = glGetUniformLocation(program, "frequency");
-    tremor_amount = glGetUniformLocation(program, "tremor_amount");
-	clip_units_per_pixel =glGetUniformLocation(program, "clip_units_per_pixel");
-	viewPos = glGetUniformLocation(program, "viewPos");
-    dA = glGetUniformLocation(program, "dA");
-    cangiante_variable = glGetUniformLocation(program, "cangiante_variable");
-    dilution_variable = glGetUniformLocation(program, "dilution_variable");
+	glUniformBlockBinding(program, glGetUniformBlockIndex(program, "Frame"), FrameBinding);
 
-	sun_direction_vec3 = glGetUniformLocation(program, "sun_direction");
-	sun_color_vec3 = glGetUniformLocation(program, "sun_color");
-	sky_direction_vec3 = glGetUniformLocation(program, "sky_direction");
-	sky_color_vec3 = glGetUniformLocation(program, "sky_color");
+	glGenBuffers(1, &frame_ubo);
+	glBindBuffer(GL_UNIFORM_BUFFER, frame_ubo);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(Frame), nullptr, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	Resources::track_buffer(frame_ubo, "SceneProgram", "Frame uniforms");
 
 	glUseProgram(program);
 
 	GLuint tex_sampler2D = glGetUniformLocation(program, "tex");
 	glUniform1i(tex_sampler2D, 0);
 
+	GLuint instance_transforms_samplerBuffer = glGetUniformLocation(program, "instance_transforms");
+	glUniform1i(instance_transforms_samplerBuffer, Scene::Object::ProgramInfo::InstanceTextureUnit);
+
 	glUseProgram(0);
 
 	GL_ERRORS();
 }
 
-Load< SceneProgram > scene_program(LoadTagInit, [](){
+void SceneProgram::set_frame(Frame const &frame) const {
+	glBindBuffer(GL_UNIFORM_BUFFER, frame_ubo);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(Frame), &frame);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	glBindBufferBase(GL_UNIFORM_BUFFER, FrameBinding, frame_ubo);
+}
+
+Load< SceneProgram > scene_program(LoadTagInit, "scene_program", {}, [](){
 	return new SceneProgram();
 });
@@ -1,6 +1,8 @@
 #include "GL.hpp"
 #include "Load.hpp"
 
+#include <glm/glm.hpp>
+
 //SceneProgram draw the scene lit by the lights specified in GameMode.cpp,
 //as well as the control masks, and a depth buffer. The scene lit by lights is
 //in color_tex, and it is also changed by hand tremors and some dilution/
@@ -9,28 +11,44 @@ struct SceneProgram {
 	//opengl program object:
 	GLuint program = 0;
 
+	//attribute locations:
+	GLuint object_index_attrib = -1U; //per-instance object index (bound by Scene::draw, not MeshBuffer)
+
 	//uniform locations:
-	GLuint object_to_clip_mat4 = -1U;
-	GLuint object_to_light_mat4x3 = -1U;
-	GLuint normal_to_light_mat3 = -1U;
-    GLuint time = -1U;
-    GLuint speed = -1U;
-    GLuint frequency = -1U;
-    GLuint tremor_amount = -1U;
-    GLuint clip_units_per_pixel = -1U;
-    GLuint viewPos = -1U;
-    GLuint dA = -1U;
-    GLuint cangiante_variable = -1U;
-    GLuint dilution_variable = -1U;
-
-	GLuint sun_direction_vec3 = -1U; //direction *to* sun
-	GLuint sun_color_vec3 = -1U;
-	GLuint sky_direction_vec3 = -1U; //direction *to* sky
-	GLuint sky_color_vec3 = -1U;
+	GLuint instance_base_int = -1U; //index of (first) object in instance_transforms
+	GLuint octahedral_normals_bool = -1U; //set if the mesh buffer is quantized (see MeshBuffer::quantized)
+
+	//per-frame parameters, uploaded once per frame to a std140 uniform block:
+	// (layout must match FRAME_BLOCK in scene_program.cpp)
+	struct Frame {
+		glm::vec3 sun_direction; //direction *to* sun
+		float time;
+		glm::vec3 sun_color;
+		float speed;
+		glm::vec3 sky_direction; //direction *to* sky
+		float frequency;
+		glm::vec3 sky_color;
+		float tremor_amount;
+		glm::vec3 viewPos;
+		float dA;
+		glm::vec2 clip_units_per_pixel;
+		float cangiante_variable;
+		float dilution_variable;
+		//clip-space scale and offset from the whole view to the drawn window (see Scene::Camera::window):
+		glm::vec2 window_scale = glm::vec2(1.0f);
+		glm::vec2 window_offset = glm::vec2(0.0f);
+	};
+	static_assert(sizeof(Frame) == 112, "Frame matches std140 layout.");
+	enum : GLuint { FrameBinding = 0 }; //uniform buffer binding point for Frame
+	GLuint frame_ubo = 0;
+
+	//upload 'frame' and bind it for drawing:
+	void set_frame(Frame const &frame) const;
 
 	//textures:
 	//texture0 - texture for the surface
 	//texture1 - texture for spot light shadow map
+	//texture4 - instance transforms (buffer texture, bound by Scene::draw)
 
 	SceneProgram();
 };
@@ -85,6 +85,6 @@ StylizeProgram::StylizeProgram() {
 	GL_ERRORS();
 }
 
-Load< StylizeProgram > stylize_program(LoadTagInit, [](){
+Load< StylizeProgram > stylize_program(LoadTagInit, "stylize_program", {}, [](){
 	return new StylizeProgram();
 });
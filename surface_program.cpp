@@ -12,13 +12,16 @@ SurfaceProgram::SurfaceProgram() {
 		,
 		"#version 330\n"
 		"uniform sampler2D paper_tex;\n"
+        "uniform vec2 render_scale; //render pixels per output pixel (see DynamicResolution)\n"
+        "uniform vec2 paper_offset; //output pixel of the picture at the lower left (non-zero for tiles)\n"
         "layout(location=0) out vec4 surface_out;\n"
 		"void main() {\n"
-        "   vec2 texCoord = gl_FragCoord.xy/textureSize(paper_tex, 0); \n"
+        //(paper texels stay the same size on screen at any render scale)
+        "   vec2 texCoord = (gl_FragCoord.xy/render_scale + paper_offset)/textureSize(paper_tex, 0); \n"
 		"	vec4 paperColor = texture(paper_tex, texCoord);\n"
         "   float paperHeight = paperColor.r; \n"
-        "   vec3 xdirection = normalize(vec3(1.0 ,0.0, dFdx(paperHeight)));\n"
-        "   vec3 ydirection = normalize(vec3(0.0, 1.0, dFdy(paperHeight)));\n"
+        "   vec3 xdirection = normalize(vec3(1.0 ,0.0, dFdx(paperHeight)*render_scale.x));\n"
+        "   vec3 ydirection = normalize(vec3(0.0, 1.0, dFdy(paperHeight)*render_scale.y));\n"
         "   vec3 n = normalize(cross(xdirection, ydirection));\n"
         "   vec3 l = normalize(vec3(1.0, 1.0, 1.0));"
         "   float nl = (dot(n,l)+1.0)/2.0;\n"
@@ -29,12 +32,16 @@ SurfaceProgram::SurfaceProgram() {
 	glUseProgram(program);
 
     glUniform1i(glGetUniformLocation(program, "paper_tex"), 0);
+    render_scale = glGetUniformLocation(program, "render_scale");
+    glUniform2f(render_scale, 1.0f, 1.0f);
+    paper_offset = glGetUniformLocation(program, "paper_offset");
+    glUniform2f(paper_offset, 0.0f, 0.0f);
 
 	glUseProgram(0);
 
 	GL_ERRORS();
 }
 
-Load< SurfaceProgram > surface_program(LoadTagInit, [](){
+Load< SurfaceProgram > surface_program(LoadTagInit, "surface_program", {}, [](){
 	return new SurfaceProgram();
 });
@@ -10,6 +10,8 @@ struct SurfaceProgram {
 	GLuint program = 0;
 
 	//uniform locations:
+	GLuint render_scale = -1U;
+	GLuint paper_offset = -1U;
 	SurfaceProgram();
 };
 
@@ -57,6 +57,6 @@ VertexColorProgram::VertexColorProgram() {
 	sky_color_vec3 = glGetUniformLocation(program, "sky_color");
 }
 
-Load< VertexColorProgram > vertex_color_program(LoadTagInit, [](){
+Load< VertexColorProgram > vertex_color_program(LoadTagLazy, "vertex_color_program", {}, [](){
 	return new VertexColorProgram();
 });